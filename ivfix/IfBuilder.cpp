@@ -36,24 +36,54 @@
 
 #define DEBUG_WRITE 0
 
+#include <math.h>
+
+#include <Inventor/SbString.h>
+#include <Inventor/actions/SoGetPrimitiveCountAction.h>
 #include <Inventor/actions/SoSearchAction.h>
 #include <Inventor/elements/SoLazyElement.h>
 #include <Inventor/elements/SoTextureImageElement.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedShape.h>
+#include <Inventor/nodes/SoInfo.h>
+#include <Inventor/nodes/SoLOD.h>
 #include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoNormal.h>
 #include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/threads/SbThread.h>
 
+#include "../make/Common.h"
 #include "IfAssert.h"
 #include "IfBuilder.h"
+#include "IfCache.h"
+#include "IfCacheOptimizer.h"
 #include "IfCondenser.h"
 #include "IfFlattener.h"
 #include "IfHolder.h"
+#include "IfPartitioner.h"
 #include "IfReporter.h"
 #include "IfShape.h"
+#include "IfSimplifier.h"
+#include "IfSpiller.h"
 #include "IfStripper.h"
 
 // All roots at Level 5 have this name so we can find them easily:
 #define LEVEL_5_ROOT_NAME	"__level5Root"
 
+// Subgraphs with fewer triangles than this are not given levels of
+// detail, since they cost little to draw anyway
+#define MIN_LOD_TRIANGLES	256
+
+// A level of detail with the given fraction of the triangles is used
+// beyond this many times the size of the subgraph's bounding box
+// divided by the square root of the fraction. The triangles' edges
+// are then about as long on the screen as those of the full detail
+// at this many times the size.
+#define LOD_DISTANCE_SCALE	4.0
+
 #if DEBUG_WRITE
 #include <Inventor/actions/SoWriteAction.h>
 #endif
@@ -66,6 +96,25 @@
 
 IfBuilder::IfBuilder()
 {
+    numThreads = 1;
+    weldTolerance = 0.0;
+    stripMethod = IfStripper::GREEDY;
+    cacheSize = 16;
+    optimizeTris = FALSE;
+    maxBatchVertices = 0;
+    maxChunkTris = 0;
+    numLODLevels = 0;
+    lodRatios = NULL;
+    packVP = FALSE;
+    cache = NULL;
+    lowMemory = FALSE;
+    maxResidentBytes = 0;
+    spiller = NULL;
+
+    jobHolders = NULL;
+    numJobs    = 0;
+    nextJob    = 0;
+    jobMutex   = NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -94,6 +143,28 @@ IfBuilder::build(const IfShapeList &shapeList, SbBool _doStrips, SbBool _doVP,
     doAnyNormals   = _doAnyNormals;
     doAnyTexCoords = _doAnyTexCoords;
 
+    peakFlattenBytes     = 0;
+    doublingFlattenBytes = 0;
+    numWeldedCoords   = 0;
+    numDegenerateTris = 0;
+    numStrips         = 0;
+    numOutputTris     = 0;
+    numCacheMissesBefore = 0;
+    numCacheMisses    = 0;
+    numBatches        = 0;
+    numBudgetSplits   = 0;
+    numChunkedGroups  = 0;
+    numTotalChunks    = 0;
+    numLODGroups      = 0;
+    numLODSourceTris  = 0;
+    numLODTris        = 0;
+    maxNormalError    = 0.0;
+    maxTexCoordError  = 0.0;
+    numPackedBytesSaved = 0;
+    numEarlyFlattened = 0;
+    residentBytes     = 0;
+    numResident       = 0;
+
     //////////////////////////////////////////////////////////////////
     //
     // We are going to build a 5-level scene graph. The top level (0)
@@ -114,10 +185,26 @@ IfBuilder::build(const IfShapeList &shapeList, SbBool _doStrips, SbBool _doVP,
     IfShape *shape = shapeList[0];
     buildRoots(1, shape, useSoTransform);
 
+    // Number of vertices in the shapes under the current level-5
+    // root, used only when there is a vertex budget
+    int batchVertices =
+	(maxBatchVertices > 0 ? countVertices(shape) : 0);
+
+    // The nodes of each shape are released once they are in the
+    // graph, so they can be freed when their subgraph is flattened
+    shape->clearNodes();
+
     // Run through the sorted list of shapes. Every time we hit a
     // shape that differs from the previous shape at Level 1, 2, 3, or
     // 4, we create a new root at the appropriate level and add the
     // nodes at that level to it.
+    //
+    // Shapes that differ only at Level 5 (typically in transform and
+    // coordinates) all go under the same level-5 root, so they are
+    // pre-transformed by flattening and end up in the same vertex
+    // buffers. With a vertex budget, a new level-5 root is started
+    // whenever a shape would take the current one over the budget,
+    // so a shape bigger than the budget is flattened by itself.
 
     for (int i = 1; i < shapeList.getLength(); i++) {
 
@@ -130,8 +217,26 @@ IfBuilder::build(const IfShapeList &shapeList, SbBool _doStrips, SbBool _doVP,
 
 	ASSERT(shape->differenceLevel >= 0 && shape->differenceLevel <= 5);
 
-	if (shape->differenceLevel > 0)
-	    buildRoots(shape->differenceLevel, shape, useSoTransform);
+	int level = shape->differenceLevel;
+
+	if (maxBatchVertices > 0) {
+	    int numVertices = countVertices(shape);
+	    if (level == 0 && batchVertices + numVertices > maxBatchVertices) {
+		level = 5;
+		numBudgetSplits++;
+	    }
+	    if (level > 0)
+		batchVertices = 0;
+	    batchVertices += numVertices;
+	}
+
+	if (level > 0) {
+	    // The current level-5 root is complete. In low-memory
+	    // mode, flatten it before building any more.
+	    if (lowMemory)
+		flattenLevel5Now();
+	    buildRoots(level, shape, useSoTransform);
+	}
 
 	// Always add the appropriate nodes for Level 5
 	else
@@ -151,9 +256,56 @@ IfBuilder::build(const IfShapeList &shapeList, SbBool _doStrips, SbBool _doVP,
 #endif
 
     // Now replace all level-5 roots with the result of flattening,
-    // condensing, and so forth
+    // condensing, and so forth. In low-memory mode, all but the last
+    // have been done already.
+    if (lowMemory) {
+	flattenLevel5Now();
+	SbBool restored = restoreResults();
+	IfReporter::reportLowMemory("Low memory", numEarlyFlattened,
+				    spiller != NULL ?
+				    spiller->getNumSpilled() : 0,
+				    spiller != NULL ?
+				    spiller->getNumBytes() : 0);
+	delete spiller;
+	spiller = NULL;
+
+	// The source nodes of a lost subgraph are gone, so the result
+	// would be missing shapes
+	if (! restored) {
+	    roots[0]->unref();
+	    roots[0] = NULL;
+	    return NULL;
+	}
+    }
     replaceLevel5();
 
+    if (maxBatchVertices > 0)
+	IfReporter::reportBatching("Batching", shapeList.getLength(),
+				   numBatches, numBudgetSplits);
+    if (maxChunkTris > 0)
+	IfReporter::reportChunks("Partitioning", numChunkedGroups,
+				 numTotalChunks);
+    if (numLODLevels > 0)
+	IfReporter::reportLevelsOfDetail("Simplifying", numLODGroups,
+					 numLODLevels, numLODSourceTris,
+					 numLODTris);
+    if (doVP && packVP)
+	IfReporter::reportPacking("Packing", numPackedBytesSaved,
+				  maxNormalError * 180.0 / M_PI,
+				  maxTexCoordError);
+    IfReporter::reportFlattenMemory("Flattening memory", peakFlattenBytes,
+				    doublingFlattenBytes);
+    if (weldTolerance > 0.0)
+	IfReporter::reportWelding("Welding", numWeldedCoords,
+				  numDegenerateTris);
+    if (doStrips)
+	IfReporter::reportStrips("Stripping", numStrips, numOutputTris,
+				 numCacheMisses);
+    else if (optimizeTris)
+	IfReporter::reportCacheOptimization("Optimizing", numOutputTris,
+					    numCacheMissesBefore,
+					    numCacheMisses);
+
 #if DEBUG_WRITE
     {
 	SoWriteAction wa;
@@ -215,6 +367,201 @@ IfBuilder::buildRoots(int startLevel, IfShape *shape, SbBool useSoTransform)
     // don't want to flatten it because the IfShape says so.
     if (! shape->dontFlatten)
 	roots[5]->setName(LEVEL_5_ROOT_NAME);
+
+    numBatches++;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// In low-memory mode, flattens the current level-5 root, now that no
+// more shapes will be added to it, and replaces it with the result.
+// This releases the source nodes under it. If the flattened results
+// then take more than the limit, they are all spilled.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfBuilder::flattenLevel5Now()
+{
+    // Some level-5 roots are not to be flattened
+    if (roots[5] == NULL || roots[5]->getName() != LEVEL_5_ROOT_NAME)
+	return;
+
+    // Its properties are collected along the path of current roots
+    SoPath *path = new SoPath(roots[0]);
+    path->ref();
+    for (int level = 1; level <= 5; level++)
+	path->append(roots[level]);
+
+    SbBool doNormals, doTexCoords;
+    getFlags(path, doNormals, doTexCoords);
+    SoNode *flatRoot = flatten(path,
+			       doAnyNormals && doNormals,
+			       doAnyTexCoords && doTexCoords);
+    path->unref();
+
+    roots[4]->replaceChild(roots[5], flatRoot);
+    roots[5] = NULL;
+    numEarlyFlattened++;
+
+    if (maxResidentBytes > 0) {
+	Result result;
+	result.parent  = roots[4];
+	result.node    = flatRoot;
+	result.spillId = -1;
+	results.append(result);
+	numResident++;
+
+	residentBytes += countResultBytes(flatRoot);
+	if (residentBytes > maxResidentBytes)
+	    spillResults();
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Spills all resident results, replacing each one in the graph with
+// a placeholder. A result that cannot be spilled stays in memory.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfBuilder::spillResults()
+{
+    if (spiller == NULL)
+	spiller = new IfSpiller;
+
+    int numResults = results.getLength();
+    for (int i = numResults - numResident; i < numResults; i++) {
+	Result &result = results[i];
+	result.spillId = spiller->spill(result.node);
+	if (result.spillId < 0)
+	    continue;
+
+	SoInfo *placeholder = new SoInfo;
+	result.parent->replaceChild(result.node, placeholder);
+	result.node = placeholder;
+    }
+
+    numResident   = 0;
+    residentBytes = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Restores all spilled results, in the order they were spilled.
+// Results that cannot be read back (if the temporary file could not
+// be read, for example) are reported and keep their placeholders, and
+// FALSE is returned.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfBuilder::restoreResults()
+{
+    int numSpilled = 0, numLost = 0;
+
+    for (int i = 0; i < results.getLength(); i++) {
+	Result &result = results[i];
+	if (result.spillId < 0)
+	    continue;
+
+	numSpilled++;
+	SoNode *flatRoot = spiller->restore(result.spillId);
+	if (flatRoot == NULL) {
+	    numLost++;
+	    continue;
+	}
+	result.parent->replaceChild(result.node, flatRoot);
+    }
+
+    if (numLost > 0)
+	IfReporter::reportRestoreFailure("Restoring spilled subgraphs",
+					 numLost, numSpilled);
+
+    results.truncate(0);
+    numResident   = 0;
+    residentBytes = 0;
+
+    return (numLost == 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the bytes taken by the field values in a flattened subgraph:
+// the coordinates, normals, texture coordinates, colors, and indices,
+// whether they are in separate nodes or in an SoVertexProperty.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+size_t
+IfBuilder::countResultBytes(SoNode *root)
+{
+    size_t n = 0;
+
+    if (root->isOfType(SoGroup::getClassTypeId())) {
+	SoGroup *group = (SoGroup *) root;
+	for (int i = 0; i < group->getNumChildren(); i++)
+	    n += countResultBytes(group->getChild(i));
+    }
+
+    else if (root->isOfType(SoCoordinate3::getClassTypeId()))
+	n += ((SoCoordinate3 *) root)->point.getNum() * sizeof(SbVec3f);
+
+    else if (root->isOfType(SoNormal::getClassTypeId()))
+	n += ((SoNormal *) root)->vector.getNum() * sizeof(SbVec3f);
+
+    else if (root->isOfType(SoTextureCoordinate2::getClassTypeId()))
+	n += ((SoTextureCoordinate2 *) root)->point.getNum() * sizeof(SbVec2f);
+
+    else if (root->isOfType(SoIndexedShape::getClassTypeId())) {
+	SoIndexedShape *shape = (SoIndexedShape *) root;
+	n += (shape->coordIndex.getNum() +
+	      shape->normalIndex.getNum() +
+	      shape->materialIndex.getNum() +
+	      shape->textureCoordIndex.getNum()) * sizeof(int32_t);
+
+	SoVertexProperty *vp =
+	    (SoVertexProperty *) shape->vertexProperty.getValue();
+	if (vp != NULL)
+	    n += (vp->vertex.getNum() * sizeof(SbVec3f) +
+		  vp->normal.getNum() * sizeof(SbVec3f) +
+		  vp->texCoord.getNum() * sizeof(SbVec2f) +
+		  vp->orderedRGBA.getNum() * sizeof(uint32_t));
+	if (vp != NULL &&
+	    vp->isOfType(SoPackedVertexProperty::getClassTypeId())) {
+	    SoPackedVertexProperty *pvp = (SoPackedVertexProperty *) vp;
+	    n += (pvp->packedNormal.getNum() +
+		  pvp->packedTexCoord.getNum()) * sizeof(uint32_t);
+	}
+    }
+
+    return n;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the number of vertices the given shape will have after
+// flattening: 3 per triangle, 2 per line segment, and 1 per point.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfBuilder::countVertices(IfShape *shape)
+{
+    // Count the primitives in a graph containing just the shape and
+    // its level-5 properties. (Properties at higher levels do not
+    // change the count, with the rare exception of complexity.)
+    SoSeparator *root = new SoSeparator;
+    root->ref();
+    shape->addNodesForLevel(root, 5, FALSE);
+
+    SoGetPrimitiveCountAction pca;
+    pca.apply(root);
+    root->unref();
+
+    return (3 * pca.getTriangleCount() + 2 * pca.getLineCount() +
+	    pca.getPointCount());
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -235,6 +582,12 @@ IfBuilder::replaceLevel5()
     // There may not be any, depending on the shape types we found
     int numSubGraphs = sa.getPaths().getLength();
 
+    // Use threads only if there is more than one subgraph to flatten
+    if (numThreads > 1 && numSubGraphs > 1) {
+	replaceLevel5Threaded(sa.getPaths());
+	return;
+    }
+
     for (int i = 0; i < numSubGraphs; i++) {
 
 	IfReporter::reportIndex("Doing subgraph", i, numSubGraphs);
@@ -260,6 +613,140 @@ IfBuilder::replaceLevel5()
     }
 }
 
+/////////////////////////////////////////////////////////////////////////////
+//
+// Replaces all level-5 roots with the result of flattening, using
+// numThreads threads. The subgraphs are independent of each other
+// once their properties have been collected, so the holders are all
+// set up first, then processed in parallel, then put back into the
+// graph in the same order as in the serial case. This produces
+// exactly the same result as replaceLevel5().
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfBuilder::replaceLevel5Threaded(const SoPathList &paths)
+{
+    numJobs = paths.getLength();
+    jobHolders = new IfHolder *[numJobs];
+
+    // Results found in the cache, and the keys of the others
+    SoNode **cachedRoots = NULL;
+    char   *keys = NULL;
+    if (cache != NULL) {
+	cachedRoots = new SoNode *[numJobs];
+	keys = new char[numJobs * IfCache::KEY_SIZE];
+    }
+
+    // Set up a holder for each subgraph. This adds the shared nodes
+    // to new separators, which changes their reference counts, so it
+    // has to happen here. So does looking in the cache, since that
+    // writes the graph.
+    IfReporter::startReport("  Collecting subgraphs", TRUE);
+    int i;
+    for (i = 0; i < numJobs; i++) {
+	const SoPath *path = paths[i];
+	ASSERT(path->getLength() > 1);
+	ASSERT(path->getTail()->getTypeId() == SoSeparator::getClassTypeId());
+
+	SbBool doNormals, doTexCoords;
+	getFlags((SoPath *) path, doNormals, doTexCoords);
+
+	jobHolders[i] = prepareHolder(path,
+				      doAnyNormals && doNormals,
+				      doAnyTexCoords && doTexCoords);
+
+	if (cache != NULL) {
+	    char *key = &keys[i * IfCache::KEY_SIZE];
+	    getCacheKey(jobHolders[i], key);
+	    cachedRoots[i] = cache->lookup(key);
+	    if (cachedRoots[i] != NULL) {
+		cachedRoots[i]->ref();
+		delete jobHolders[i];
+		jobHolders[i] = NULL;
+	    }
+	}
+    }
+    IfReporter::finishReport(TRUE);
+
+    // Start the worker threads. This thread does its share of the
+    // work as well, so we need one less than the number requested.
+    int numWorkers = (numThreads < numJobs ? numThreads : numJobs) - 1;
+
+    char msg[100];
+    sprintf(msg, "Flattening %d subgraphs with %d threads",
+	    numJobs, numWorkers + 1);
+    IfReporter::startReport(msg);
+
+    nextJob  = 0;
+    jobMutex = new SbMutex;
+
+    SbThread **workers = new SbThread *[numWorkers];
+    for (i = 0; i < numWorkers; i++)
+	workers[i] = SbThread::create(jobThreadCB, this);
+
+    processJobs();
+
+    for (i = 0; i < numWorkers; i++) {
+	workers[i]->join();
+	SbThread::destroy(workers[i]);
+    }
+    delete [] workers;
+
+    delete jobMutex;
+    jobMutex = NULL;
+
+    IfReporter::finishReport();
+
+    // Replace the level 5 roots in order
+    for (i = 0; i < numJobs; i++) {
+	const SoPath *path = paths[i];
+	SoNode *level5Root = path->getTail();
+	SoNode *flatRoot;
+	if (jobHolders[i] == NULL) {
+	    flatRoot = cachedRoots[i];
+	    flatRoot->unrefNoDelete();
+	}
+	else {
+	    flatRoot = finishHolder(jobHolders[i]);
+	    if (cache != NULL)
+		cache->store(&keys[i * IfCache::KEY_SIZE], flatRoot);
+	}
+	SoSeparator *parent = (SoSeparator *) path->getNodeFromTail(1);
+	ASSERT(parent->getTypeId() == SoSeparator::getClassTypeId());
+	parent->replaceChild(level5Root, flatRoot);
+    }
+
+    delete [] cachedRoots;
+    delete [] keys;
+    delete [] jobHolders;
+    jobHolders = NULL;
+    numJobs = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Takes holders off the job list and processes them until there are
+// no more. This is run by each worker thread.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfBuilder::processJobs()
+{
+    while (TRUE) {
+	jobMutex->lock();
+	int job = nextJob++;
+	jobMutex->unlock();
+
+	if (job >= numJobs)
+	    break;
+
+	if (jobHolders[job] != NULL)
+	    processHolder(jobHolders[job], FALSE);
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // Traverses the given path with a callback action to determine if
@@ -308,12 +795,75 @@ IfBuilder::setFlags(SoCallbackAction *cba, SbBool *flags)
 /////////////////////////////////////////////////////////////////////////////
 //
 // Flattens the subgraph at the tail of the given path, returning
-// the resulting graph.
+// the resulting graph. If there is a cache, the result is taken from
+// it when possible and stored in it otherwise.
 //
 /////////////////////////////////////////////////////////////////////////////
 
 SoNode *
 IfBuilder::flatten(const SoPath *path, SbBool doNormals, SbBool doTexCoords)
+{
+    IfHolder *holder = prepareHolder(path, doNormals, doTexCoords);
+
+    // Use the cached result, if there is one
+    char key[IfCache::KEY_SIZE];
+    if (cache != NULL) {
+	getCacheKey(holder, key);
+	SoNode *cachedRoot = cache->lookup(key);
+	if (cachedRoot != NULL) {
+	    delete holder;
+	    return cachedRoot;
+	}
+    }
+
+    processHolder(holder, TRUE);
+    SoNode *result = finishHolder(holder);
+
+    if (cache != NULL)
+	cache->store(key, result);
+
+    return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Computes the cache key of the graph in a holder. Everything that
+// changes the result of processHolder() goes into the key, along with
+// a version that should be changed when the processing changes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfBuilder::getCacheKey(IfHolder *holder, char *key)
+{
+    // There may be any number of levels of detail, so their ratios
+    // are appended one at a time
+    char buf[400];
+    snprintf(buf, sizeof(buf), "ivfix 1 strips %d vp %d normals %d "
+	     "texCoords %d weld %g stripMethod %d cache %d "
+	     "optimize %d chunk %d pack %d lod",
+	     doStrips, doVP, holder->doNormals, holder->doTexCoords,
+	     weldTolerance, (int) stripMethod, cacheSize,
+	     optimizeTris, maxChunkTris, packVP);
+    SbString options = buf;
+    for (int i = 0; i < numLODLevels; i++) {
+	snprintf(buf, sizeof(buf), " %g", lodRatios[i]);
+	options += buf;
+    }
+
+    cache->getKey(holder->origRoot, options.getString(), key);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Creates an IfHolder for the subgraph at the tail of the given
+// path. This must be called from the main thread.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfHolder *
+IfBuilder::prepareHolder(const SoPath *path,
+			 SbBool doNormals, SbBool doTexCoords)
 {
     // Copy all properties from higher in the path to this root, just
     // in case the subgraph at the tail needs them. Specifically,
@@ -326,47 +876,277 @@ IfBuilder::flatten(const SoPath *path, SbBool doNormals, SbBool doTexCoords)
     IfHolder *holder = new IfHolder(root, doStrips, doNormals, doTexCoords);
     root->unref();
 
+    return holder;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Flattens, condenses, and strips the graph in the given holder.
+// Progress is reported only if doReport is TRUE, since the reports
+// from several threads would otherwise be mixed together.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfBuilder::processHolder(IfHolder *holder, SbBool doReport)
+{
     // Flatten to produce triangles
 
-    IfReporter::startReport("  Flattening", TRUE);
+    if (doReport)
+	IfReporter::startReport("  Flattening", TRUE);
+    holder->flattenMetrics.start(TRUE);
     IfFlattener *flattener = new IfFlattener;
     flattener->flatten(holder);
     delete flattener;
-    IfReporter::finishReport(TRUE);
-
-    IfReporter::reportHolder("    After flattening", holder);
+    holder->flattenMetrics.finish();
+    if (doReport) {
+	IfReporter::finishReport(TRUE);
+	IfReporter::reportHolder("    After flattening", holder);
+	IfReporter::reportFlattenMemory("       Field memory",
+					holder->peakFlattenBytes,
+					holder->doublingFlattenBytes, TRUE);
+    }
 
     // Condense the result
-    IfReporter::startReport("  Condensing", TRUE);
+    if (doReport)
+	IfReporter::startReport("  Condensing", TRUE);
+    holder->condenseMetrics.start(TRUE);
     IfCondenser *condenser = new IfCondenser;
+    condenser->setWeldTolerance(weldTolerance);
     condenser->condense(holder);
     delete condenser;
-    IfReporter::finishReport(TRUE);
+    holder->condenseMetrics.finish();
+    if (doReport) {
+	IfReporter::finishReport(TRUE);
+	IfReporter::reportHolder("    After condensing", holder);
+	if (weldTolerance > 0.0)
+	    IfReporter::reportWelding("       After welding",
+				      holder->numWeldedCoords,
+				      holder->numDegenerateTris, TRUE);
+    }
 
-    IfReporter::reportHolder("    After condensing", holder);
+    // Make simplified levels of detail of a large enough group, and
+    // split it into spatially coherent chunks, which are stripped
+    // separately and can be culled separately. These count as part
+    // of stripping.
+    holder->stripMetrics.start(TRUE);
+    IfHolder **levels = NULL;
+    int numLevels = 0;
+    SbBox3f box;
+    int numTris = holder->triSet->coordIndex.getNum() / 4;
+    if (numLODLevels > 0 && numTris >= MIN_LOD_TRIANGLES) {
+	const SbVec3f *coords = holder->coords->point.getValues(0);
+	for (int i = 0; i < holder->coords->point.getNum(); i++)
+	    box.extendBy(coords[i]);
+	levels = new IfHolder *[numLODLevels];
+	IfSimplifier *simplifier = new IfSimplifier;
+	simplifier->simplify(holder, numLODLevels, lodRatios, levels);
+	delete simplifier;
+	numLevels = numLODLevels;
+	holder->numLODLevels = numLevels;
+	holder->numLODSourceTris = numTris;
+	for (int i = 0; i < numLevels; i++)
+	    holder->numLODTris += levels[i]->triSet->coordIndex.getNum() / 4;
+	if (doReport)
+	    IfReporter::reportLevelsOfDetail("       After simplifying", 1,
+					     numLevels, numTris,
+					     holder->numLODTris, TRUE);
+    }
 
-    if (doStrips) {
-	// Produce better triangle strips
-	IfReporter::startReport("  Stripping ", TRUE);
-	IfStripper *stripper = new IfStripper;
-	stripper->strip(holder);
-	delete stripper;
-	IfReporter::finishReport(TRUE);
+    IfHolder **chunks = NULL;
+    int numChunks = 0;
+    if (maxChunkTris > 0) {
+	IfPartitioner *partitioner = new IfPartitioner;
+	partitioner->setMaxTriangles(maxChunkTris);
+	numChunks = partitioner->partition(holder, chunks);
+	delete partitioner;
+	if (doReport && numChunks > 0)
+	    IfReporter::reportChunks("       After partitioning", 1,
+				     numChunks, TRUE);
+    }
 
-	IfReporter::reportHolder("    After stripping ", holder);
+    if (doStrips || optimizeTris) {
+	// Produce better triangle strips, or reorder the triangles for
+	// the vertex cache
+	if (doReport)
+	    IfReporter::startReport(doStrips ? "  Stripping " :
+				    "  Optimizing", TRUE);
+	if (numChunks == 0)
+	    stripHolder(holder);
+	else {
+	    for (int i = 0; i < numChunks; i++) {
+		stripHolder(chunks[i]);
+		holder->numStrips     += chunks[i]->numStrips;
+		holder->numOutputTris += chunks[i]->numOutputTris;
+		holder->numCacheMissesBefore += chunks[i]->numCacheMissesBefore;
+		holder->numCacheMisses += chunks[i]->numCacheMisses;
+	    }
+	}
+
+	// The levels of detail are not counted in the statistics
+	for (int i = 0; i < numLevels; i++)
+	    stripHolder(levels[i]);
+    }
+    holder->stripMetrics.finish();
+
+    if (doReport && (doStrips || optimizeTris)) {
+	IfReporter::finishReport(TRUE);
+	if (doStrips) {
+	    if (numChunks == 0)
+		IfReporter::reportHolder("    After stripping ", holder);
+	    IfReporter::reportStrips("       After stripping",
+				     holder->numStrips, holder->numOutputTris,
+				     holder->numCacheMisses, TRUE);
+	}
+	else {
+	    if (numChunks == 0)
+		IfReporter::reportHolder("    After optimizing", holder);
+	    IfReporter::reportCacheOptimization("       After optimizing",
+						holder->numOutputTris,
+						holder->numCacheMissesBefore,
+						holder->numCacheMisses, TRUE);
+	}
     }
 
     if (doVP) {
 	// Find the last material in the object
+	SoSeparator *root = (SoSeparator *) holder->origRoot;
 	int i;
 	for (i = root->getNumChildren() - 1; i >= 0; i--) {
 	    if (root->getChild(i)->isOfType(SoMaterial::getClassTypeId()))
 		break;
 	}
 	SoMaterial *mtl = (i >= 0 ? (SoMaterial *) root->getChild(i) : NULL);
-	holder->convertToVertexProperty(mtl);
+	if (numChunks == 0)
+	    holder->convertToVertexProperty(mtl, packVP);
+	else
+	    for (i = 0; i < numChunks; i++)
+		chunks[i]->convertToVertexProperty(mtl, packVP);
+	for (i = 0; i < numLevels; i++)
+	    levels[i]->convertToVertexProperty(mtl, packVP);
+
+	// Gather the packing statistics of the chunks and levels,
+	// which are deleted below
+	if (packVP) {
+	    for (i = 0; i < numChunks + numLevels; i++) {
+		IfHolder *h = (i < numChunks ? chunks[i] :
+			       levels[i - numChunks]);
+		if (h->maxNormalError > holder->maxNormalError)
+		    holder->maxNormalError = h->maxNormalError;
+		if (h->maxTexCoordError > holder->maxTexCoordError)
+		    holder->maxTexCoordError = h->maxTexCoordError;
+		holder->numPackedBytesSaved += h->numPackedBytesSaved;
+	    }
+	}
+    }
+
+    if (numChunks > 0) {
+	// Replace the contents of the holder's root with a culling
+	// separator for each chunk. The chunk holders share only the
+	// holder's own original root, so they can be deleted here.
+	holder->root->removeAllChildren();
+	for (int i = 0; i < numChunks; i++) {
+	    chunks[i]->root->renderCulling = SoSeparator::ON;
+	    holder->root->addChild(chunks[i]->root);
+	    delete chunks[i];
+	}
+	delete [] chunks;
+	holder->numChunks = numChunks;
     }
 
+    if (numLevels > 0) {
+	// Put the full detail and the simplified levels under an SoLOD
+	// centered on the bounding box
+	SoLOD *lod = new SoLOD;
+	SoSeparator *fullDetail = new SoSeparator;
+	for (int i = 0; i < holder->root->getNumChildren(); i++)
+	    fullDetail->addChild(holder->root->getChild(i));
+	holder->root->removeAllChildren();
+	lod->addChild(fullDetail);
+
+	float width, height, depth;
+	box.getSize(width, height, depth);
+	float size = SbVec3f(width, height, depth).length();
+	lod->center = box.getCenter();
+	for (int i = 0; i < numLevels; i++) {
+	    lod->addChild(levels[i]->root);
+	    lod->range.set1Value(i, LOD_DISTANCE_SCALE * size /
+				 sqrt(lodRatios[i]));
+	    delete levels[i];
+	}
+	delete [] levels;
+
+	holder->root->addChild(lod);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Strips or optimizes the triangles in the given holder, as set up.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfBuilder::stripHolder(IfHolder *holder)
+{
+    if (doStrips) {
+	IfStripper *stripper = new IfStripper;
+	stripper->setMethod(stripMethod);
+	stripper->setCacheSize(cacheSize);
+	stripper->strip(holder);
+	delete stripper;
+    }
+
+    else if (optimizeTris) {
+	IfCacheOptimizer *optimizer = new IfCacheOptimizer;
+	optimizer->setCacheSize(cacheSize);
+	optimizer->optimize(holder);
+	delete optimizer;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Deletes the given holder, returning the root of the graph it
+// produced. This must be called from the main thread, since deleting
+// the holder releases the shared nodes in the original graph.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoNode *
+IfBuilder::finishHolder(IfHolder *holder)
+{
+    // The subgraphs are flattened one at a time (per thread), so
+    // the most memory used is that of the largest one
+    if (holder->peakFlattenBytes > peakFlattenBytes)
+	peakFlattenBytes = holder->peakFlattenBytes;
+    if (holder->doublingFlattenBytes > doublingFlattenBytes)
+	doublingFlattenBytes = holder->doublingFlattenBytes;
+    numWeldedCoords   += holder->numWeldedCoords;
+    numDegenerateTris += holder->numDegenerateTris;
+    numStrips         += holder->numStrips;
+    numOutputTris     += holder->numOutputTris;
+    numCacheMissesBefore += holder->numCacheMissesBefore;
+    numCacheMisses    += holder->numCacheMisses;
+    if (holder->numChunks > 0) {
+	numChunkedGroups++;
+	numTotalChunks += holder->numChunks;
+    }
+    if (holder->numLODLevels > 0) {
+	numLODGroups++;
+	numLODSourceTris += holder->numLODSourceTris;
+	numLODTris       += holder->numLODTris;
+    }
+    if (holder->maxNormalError > maxNormalError)
+	maxNormalError = holder->maxNormalError;
+    if (holder->maxTexCoordError > maxTexCoordError)
+	maxTexCoordError = holder->maxTexCoordError;
+    numPackedBytesSaved += holder->numPackedBytesSaved;
+
+    // Holders are finished in order, so the subgraphs are recorded in
+    // the same order no matter how many threads there are
+    IfReporter::recordSubgraph(holder);
+
     SoNode *result = holder->root;
     result->ref();
     delete holder;
@@ -415,7 +1195,7 @@ IfBuilder::collectObject(const SoPath *path)
 /////////////////////////////////////////////////////////////////////////////
 //
 // Recursive procedure that removes any separators that have only one
-// child.
+// child. Separators that do render culling are kept.
 //
 /////////////////////////////////////////////////////////////////////////////
 
@@ -432,6 +1212,11 @@ IfBuilder::removeUnnecessarySeparators(SoSeparator *root, int level)
 
 	if (lastKid->getTypeId() == SoSeparator::getClassTypeId()) {
 
+	    // A separator around a chunk is there to be culled
+	    if (((SoSeparator *) lastKid)->renderCulling.getValue() ==
+		SoSeparator::ON)
+		break;
+
 	    // A Level 2 separator should NOT be removed unless there
 	    // is no camera under its Level 1 separator. This keeps
 	    // caching ok under the camera.
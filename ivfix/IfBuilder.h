@@ -45,11 +45,18 @@
 #define  _IF_BUILDER_
 
 #include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/lists/SbList.h>
 #include "IfShapeList.h"
+#include "IfStripper.h"
 
+class IfCache;
 class IfHolder;
 class IfShape;
+class IfSpiller;
+class SbMutex;
 class SoNode;
+class SoPathList;
+class SoGroup;
 class SoSeparator;
 
 class IfBuilder {
@@ -58,23 +65,164 @@ class IfBuilder {
     IfBuilder();
     ~IfBuilder();
 
+    // Builds the result from the sorted shapes. Returns NULL if a
+    // subgraph spilled in low-memory mode cannot be read back.
     SoNode *	build(const IfShapeList &shapeList, SbBool doStrips,
 		      SbBool doVP, SbBool doAnyNormals, SbBool doAnyTexCoords,
 		      SbBool useSoTransform);
 
+    // Sets the number of threads used to flatten the level-5
+    // subgraphs. The default is 1, meaning that all subgraphs are
+    // flattened serially in the calling thread.
+    void	setNumThreads(int n)	{ numThreads = (n < 1 ? 1 : n); }
+
+    // Sets the distance within which coordinates are welded together
+    // when condensing. The default is 0 (no welding).
+    void	setWeldTolerance(float tol)	{ weldTolerance = tol; }
+
+    // Sets the method used to create triangle strips and the vertex
+    // cache size it should optimize for (see IfStripper)
+    void	setStripMethod(IfStripper::Method m)	{ stripMethod = m; }
+    void	setCacheSize(int size)		{ cacheSize = size; }
+
+    // Sets whether independent triangles (when not creating strips)
+    // are reordered for the vertex cache (see IfCacheOptimizer). The
+    // default is FALSE.
+    void	setOptimizeTriangles(SbBool flag)	{ optimizeTris = flag; }
+
+    // Sets the most vertices that shapes differing only at level 5
+    // (such as in transform) may have in total to be flattened
+    // together into one batch. A shape that would go over the budget
+    // starts a new batch. The default is 0, meaning no limit.
+    void	setMaxBatchVertices(int n)	{ maxBatchVertices = n; }
+
+    // Sets the most triangles in each chunk of a flattened level-5
+    // subgraph. A subgraph with more triangles is split into spatially
+    // coherent chunks (see IfPartitioner), each stripped separately
+    // under its own separator with render culling turned on. The
+    // default is 0, meaning no splitting.
+    void	setMaxChunkTriangles(int n)	{ maxChunkTris = n; }
+
+    // Sets the fractions of the triangles kept in each simplified
+    // level of detail (see IfSimplifier). Each flattened level-5
+    // subgraph that is big enough is put under an SoLOD with the full
+    // detail and a level for each fraction, used farther away as the
+    // fractions get smaller. The fractions must be decreasing, and
+    // the array is not copied. The default is none.
+    void	setLODRatios(int num, const float *ratios)
+	{ numLODLevels = num; lodRatios = ratios; }
+
+    // Sets whether the normals and texture coordinates in each
+    // SoVertexProperty node are packed at reduced precision, using an
+    // SoPackedVertexProperty node. This has no effect unless
+    // SoVertexProperty nodes are built. The default is FALSE.
+    void	setPackVertexProperty(SbBool flag)	{ packVP = flag; }
+
+    // Sets a cache of flattened subgraphs (see IfCache). A subgraph
+    // found in the cache is not flattened again, and those that are
+    // flattened are stored in it. The default is NULL (no cache).
+    void	setCache(IfCache *c)		{ cache = c; }
+
+    // Sets low-memory mode. In this mode each level-5 subgraph is
+    // flattened as soon as all its shapes have been added, and its
+    // source nodes are released right away, rather than building the
+    // whole graph first. The subgraphs are flattened one at a time
+    // even if there are several threads. The default is FALSE.
+    void	setLowMemory(SbBool flag)	{ lowMemory = flag; }
+
+    // Sets the most bytes of flattened subgraphs that are kept in
+    // memory in low-memory mode while the rest of the graph is being
+    // built. Beyond that, they are spilled to a temporary file (see
+    // IfSpiller) and read back when all shapes are done. The default
+    // is 0, meaning that nothing is spilled.
+    void	setMaxResidentBytes(size_t n)	{ maxResidentBytes = n; }
+
   private:
     SbBool	doStrips;	
     SbBool	doVP;	
     SbBool	doAnyNormals;	
     SbBool	doAnyTexCoords;	
     SoSeparator	*roots[6];		// Roots at 6 levels of graph
+    int		numThreads;		// Threads used for flattening
+    float	weldTolerance;		// Distance for welding coords
+    size_t	peakFlattenBytes;	// Most memory used by any
+    size_t	doublingFlattenBytes;	// subgraph's flattening
+    int		numWeldedCoords;	// Totals from welding
+    int		numDegenerateTris;
+    IfStripper::Method stripMethod;	// Method of creating strips
+    int		cacheSize;		// Vertex cache size to optimize for
+    SbBool	optimizeTris;		// Reorder independent triangles
+    int		numStrips;		// Totals from stripping or
+    int		numOutputTris;		// optimizing triangle lists
+    int		numCacheMissesBefore;
+    int		numCacheMisses;
+    int		maxBatchVertices;	// Vertex budget per batch (0 = none)
+    int		numBatches;		// Number of level-5 roots built
+    int		numBudgetSplits;	// Batches started by the budget
+    int		maxChunkTris;		// Triangles per chunk (0 = no chunks)
+    int		numChunkedGroups;	// Subgraphs split into chunks
+    int		numTotalChunks;		// Chunks they were split into
+    int		numLODLevels;		// Simplified levels of detail
+    const float	*lodRatios;		// Fraction of triangles in each
+    int		numLODGroups;		// Subgraphs given levels of detail
+    int		numLODSourceTris;	// Triangles in their full detail
+    int		numLODTris;		// Triangles in all their levels
+    SbBool	packVP;			// Pack normals and texture coords
+    float	maxNormalError;		// Largest packing errors, normals
+    float	maxTexCoordError;	// in radians
+    int		numPackedBytesSaved;	// Bytes saved by packing
+    IfCache	*cache;			// Cache of flattened subgraphs
+    SbBool	lowMemory;		// Flatten as soon as possible
+    size_t	maxResidentBytes;	// Most bytes before spilling
+    size_t	residentBytes;		// Bytes of resident results
+    IfSpiller	*spiller;		// Holds spilled results
+    int		numEarlyFlattened;	// Subgraphs flattened early
+
+    // A flattened subgraph in low-memory mode, and the separator it
+    // is in. Once spilled, the node is a placeholder and spillId says
+    // where the subgraph is.
+    struct Result {
+	SoGroup	*parent;
+	SoNode	*node;
+	int	spillId;
+    };
+    SbList<Result> results;		// Results so far
+    int		numResident;		// Results not yet spilled
+
+    // Holders waiting to be processed by the worker threads, and the
+    // index of the next one to hand out. The index is accessed only
+    // while holding the mutex. Subgraphs found in the cache have no
+    // holder.
+    IfHolder	**jobHolders;
+    int		numJobs;
+    int		nextJob;
+    SbMutex	*jobMutex;
 
     // Builds the roots from the given level down
     void	buildRoots(int startLevel, IfShape *shape, SbBool useSoTransform);
 
+    // In low-memory mode, flattens the current level-5 root if it is
+    // complete and replaces it with the result
+    void	flattenLevel5Now();
+
+    // Spills all resident results, and restores all spilled results.
+    // restoreResults() returns FALSE if any could not be restored.
+    void	spillResults();
+    SbBool	restoreResults();
+
+    // Returns the bytes taken by the field values in a flattened
+    // subgraph
+    static size_t countResultBytes(SoNode *root);
+
+    // Returns the number of vertices in the shape after flattening
+    static int	countVertices(IfShape *shape);
+
     // Replaces all level-5 roots with the result of flattening
     void	replaceLevel5();
 
+    // Does the same, flattening the subgraphs on numThreads threads
+    void	replaceLevel5Threaded(const SoPathList &paths);
+
     // Traverses the given path with a callback action to determine if
     // normals and texture coordinates are required for shapes in it
     void	getFlags(SoPath *path, SbBool &doNormals, SbBool &doTexCoords);
@@ -87,6 +235,28 @@ class IfBuilder {
     SoNode *	flatten(const SoPath *path,
 			SbBool doNormals, SbBool doTexCoords);
 
+    // The three parts of flatten(). The first and last add and remove
+    // references to nodes that are shared with the rest of the graph,
+    // so they must be called from the main thread only. The middle
+    // part changes only nodes owned by the holder and may be called
+    // from any thread.
+    IfHolder *	prepareHolder(const SoPath *path,
+			      SbBool doNormals, SbBool doTexCoords);
+    void	processHolder(IfHolder *holder, SbBool doReport);
+    SoNode *	finishHolder(IfHolder *holder);
+
+    // Strips or optimizes the triangles in a holder, as set up. This
+    // is the part of processHolder() that is done for each chunk.
+    void	stripHolder(IfHolder *holder);
+
+    // Computes the cache key of the graph in a holder, which depends
+    // on the options used to process it as well
+    void	getCacheKey(IfHolder *holder, char *key);
+
+    // Takes holders off the job list and processes them until there
+    // are no more
+    void	processJobs();
+
     // Collects all properties along the given path (above the tail)
     // and returns a separator-rooted graph that contains all of them
     // and the tail of the path.
@@ -106,6 +276,11 @@ class IfBuilder {
 					     const SoNode *)
 	{ setFlags(cba, (SbBool *) userData);
 	  return SoCallbackAction::ABORT; }
+
+    // Entry point for worker threads
+    static void *	jobThreadCB(void *userData)
+	{ ((IfBuilder *) userData)->processJobs();
+	  return NULL; }
 };
 
 #endif /* _IF_BUILDER_ */
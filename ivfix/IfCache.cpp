@@ -0,0 +1,445 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Inventor/SbDict.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoNode.h>
+
+#include "IfCache.h"
+
+// Name of the index file, and the line it starts with. Changing the
+// version makes old caches empty.
+#define INDEX_FILE_NAME		"index"
+#define INDEX_VERSION		"ivfix-cache 1"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfCache::IfCache(const char *_dirName)
+{
+    dirName	= _dirName;
+    maxBytes	= 256 * 1024 * 1024;
+    run		= 0;
+    entryDict	= new SbDict(1235);
+    numBytes	= 0;
+    numHits	= 0;
+    numMisses	= 0;
+    numStored	= 0;
+    numEvicted	= 0;
+
+    readIndex();
+
+    // This run is one later than the last one recorded
+    run++;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor. This writes out the index, after making sure the
+// entries fit within the size limit.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfCache::~IfCache()
+{
+    evict();
+    writeIndex();
+    delete entryDict;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Computes the key for the given graph. The graph and the options are
+// written to a buffer, and the bytes are hashed with two different
+// 64-bit hash functions (FNV-1a and a polynomial hash), whose values
+// make up the key. This hashes everything that affects the result:
+// the field values of all nodes, the structure of the graph, and
+// which nodes are instanced.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCache::getKey(SoNode *graph, const char *options, char key[KEY_SIZE])
+{
+    void	*buf;
+    size_t	size;
+    writeToBuffer(graph, buf, size);
+
+    uint64_t h1 = 0xcbf29ce484222325ULL, h2 = 0;
+    const unsigned char *bytes;
+    size_t i;
+
+    bytes = (const unsigned char *) options;
+    for (i = 0; bytes[i] != '\0'; i++) {
+	h1 = (h1 ^ bytes[i]) * 0x100000001b3ULL;
+	h2 = h2 * 31 + bytes[i];
+    }
+
+    bytes = (const unsigned char *) buf;
+    for (i = 0; i < size; i++) {
+	h1 = (h1 ^ bytes[i]) * 0x100000001b3ULL;
+	h2 = h2 * 31 + bytes[i];
+    }
+    h2 ^= size;
+
+    free(buf);
+
+    sprintf(key, "%08lx%08lx%08lx%08lx",
+	    (unsigned long) (h1 >> 32), (unsigned long) (h1 & 0xffffffff),
+	    (unsigned long) (h2 >> 32), (unsigned long) (h2 & 0xffffffff));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the result stored under the given key, or NULL. An entry
+// whose file cannot be read is removed.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoNode *
+IfCache::lookup(const char key[KEY_SIZE])
+{
+    int index = findEntry(key);
+    if (index < 0) {
+	numMisses++;
+	return NULL;
+    }
+
+    SoNode *result = NULL;
+    SoInput in;
+    if (in.openFile(getFileName(key).getString(), TRUE)) {
+	if (! SoDB::read(&in, result))
+	    result = NULL;
+	in.closeFile();
+    }
+
+    if (result == NULL) {
+	removeEntry(index);
+	numMisses++;
+	return NULL;
+    }
+
+    entries[index].lastUsed = run;
+    numHits++;
+    return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Stores a result under the given key. A result that cannot be
+// written is just not cached.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCache::store(const char key[KEY_SIZE], SoNode *result)
+{
+    if (findEntry(key) >= 0)
+	return;
+
+    // Write the result to memory first, so we know its size
+    result->ref();
+    void	*buf;
+    size_t	size;
+    writeToBuffer(result, buf, size);
+    result->unrefNoDelete();
+
+    SbString fileName = getFileName(key);
+    FILE *fp = fopen(fileName.getString(), "wb");
+    SbBool ok = FALSE;
+    if (fp != NULL) {
+	ok = (fwrite(buf, 1, size, fp) == size);
+	if (fclose(fp) != 0)
+	    ok = FALSE;
+	if (! ok)
+	    remove(fileName.getString());
+    }
+    free(buf);
+
+    if (! ok)
+	return;
+
+    addEntry(key, size, run);
+    numStored++;
+
+    if (numBytes > maxBytes)
+	evict();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reads the index file, if there is one.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCache::readIndex()
+{
+    FILE *fp = fopen(getFileName(INDEX_FILE_NAME).getString(), "r");
+    if (fp == NULL)
+	return;
+
+    char line[100];
+    if (fgets(line, sizeof(line), fp) != NULL &&
+	strncmp(line, INDEX_VERSION " ", strlen(INDEX_VERSION) + 1) == 0) {
+
+	run = atoi(line + strlen(INDEX_VERSION) + 1);
+
+	char		key[KEY_SIZE];
+	unsigned long	size;
+	int		lastUsed;
+	while (fscanf(fp, "%32s %lu %d", key, &size, &lastUsed) == 3) {
+	    if (strlen(key) == KEY_SIZE - 1 && findEntry(key) < 0)
+		addEntry(key, size, lastUsed);
+	}
+    }
+
+    fclose(fp);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Writes the index file. The version line also holds the number of
+// this run.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCache::writeIndex()
+{
+    FILE *fp = fopen(getFileName(INDEX_FILE_NAME).getString(), "w");
+    if (fp == NULL)
+	return;
+
+    fprintf(fp, "%s %d\n", INDEX_VERSION, run);
+    for (int i = 0; i < entries.getLength(); i++) {
+	const Entry &entry = entries[i];
+	if (entry.key[0] != '\0')
+	    fprintf(fp, "%s %lu %d\n", entry.key,
+		    (unsigned long) entry.numBytes, entry.lastUsed);
+    }
+
+    fclose(fp);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Adds an entry, returning its index. Entries whose keys share a
+// dictionary key are chained, with the newest first.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfCache::addEntry(const char *key, size_t n, int lastUsed)
+{
+    unsigned long dictKey = getDictKey(key);
+    void *value;
+
+    Entry entry;
+    strcpy(entry.key, key);
+    entry.numBytes = n;
+    entry.lastUsed = lastUsed;
+    entry.nextSameHash = -1;
+    if (entryDict->find(dictKey, value))
+	entry.nextSameHash = (int) (size_t) value - 1;
+
+    int index = entries.getLength();
+    entries.append(entry);
+    entryDict->enter(dictKey, (void *) (size_t) (index + 1));
+    numBytes += n;
+
+    return index;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the index of the entry with the given key, or -1. The
+// dictionary is keyed on part of the key, so the chain of entries
+// sharing that part is searched for the whole key.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfCache::findEntry(const char *key) const
+{
+    void *value;
+    if (! entryDict->find(getDictKey(key), value))
+	return -1;
+
+    for (int index = (int) (size_t) value - 1; index >= 0;
+	 index = entries[index].nextSameHash) {
+	if (strcmp(entries[index].key, key) == 0)
+	    return index;
+    }
+
+    return -1;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Removes an entry and its file, unlinking it from its chain.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCache::removeEntry(int index)
+{
+    Entry &entry = entries[index];
+    unsigned long dictKey = getDictKey(entry.key);
+    void *value;
+
+    if (entryDict->find(dictKey, value)) {
+	int head = (int) (size_t) value - 1;
+	if (head == index) {
+	    if (entry.nextSameHash < 0)
+		entryDict->remove(dictKey);
+	    else
+		entryDict->enter(dictKey,
+				 (void *) (size_t) (entry.nextSameHash + 1));
+	}
+	else {
+	    int prev = head;
+	    while (entries[prev].nextSameHash != index)
+		prev = entries[prev].nextSameHash;
+	    entries[prev].nextSameHash = entry.nextSameHash;
+	}
+    }
+
+    remove(getFileName(entry.key).getString());
+    numBytes -= entry.numBytes;
+
+    entry.key[0]       = '\0';
+    entry.numBytes     = 0;
+    entry.nextSameHash = -1;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Removes the least recently used entries until the rest fit within
+// the size limit. Entries used equally recently are removed in the
+// order they were added.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCache::evict()
+{
+    while (numBytes > maxBytes) {
+
+	int oldest = -1;
+	for (int i = 0; i < entries.getLength(); i++) {
+	    if (entries[i].key[0] != '\0' &&
+		(oldest < 0 || entries[i].lastUsed < entries[oldest].lastUsed))
+		oldest = i;
+	}
+	if (oldest < 0)
+	    break;
+
+	removeEntry(oldest);
+	numEvicted++;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the full name of a file in the cache directory.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbString
+IfCache::getFileName(const char *name) const
+{
+    SbString fileName = dirName;
+    fileName += "/";
+    fileName += name;
+    return fileName;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the dictionary key for a cache key: its first 8 hex digits.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+unsigned long
+IfCache::getDictKey(const char *key)
+{
+    char digits[9];
+    strncpy(digits, key, 8);
+    digits[8] = '\0';
+    return strtoul(digits, NULL, 16);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Writes a graph in binary into a newly allocated buffer.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCache::writeToBuffer(SoNode *graph, void *&buf, size_t &size)
+{
+    SoOutput out;
+    out.setBinary(TRUE);
+    out.setBuffer(malloc(4096), 4096, reallocCB);
+
+    SoWriteAction wa(&out);
+    wa.apply(graph);
+
+    out.getBuffer(buf, size);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reallocation callback for SoOutput.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void *
+IfCache::reallocCB(void *ptr, size_t newSize)
+{
+    return realloc(ptr, newSize);
+}
@@ -0,0 +1,147 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfCache class: an on-disk cache of the results of flattening,
+// condensing, and stripping level-5 subgraphs, so that re-running
+// ivfix on a scene in which only a few parts have changed redoes only
+// those parts. Each result is stored in a binary Inventor file named
+// by a content hash (the key) of the graph it was made from, which
+// holds the subgraph's shapes and all the state accumulated above
+// them, plus the options used to process it.
+//
+// An index file in the cache directory records the size of each entry
+// and the last run that used it. When the entries take more than the
+// size limit, the least recently used ones are removed. The index is
+// written when the cache is deleted.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_CACHE_
+#define  _IF_CACHE_
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbString.h>
+#include <Inventor/lists/SbList.h>
+
+class SbDict;
+class SoNode;
+
+class IfCache {
+
+  public:
+    // Number of characters in a key, including the terminating null
+    enum { KEY_SIZE = 33 };
+
+    // The directory must exist
+    IfCache(const char *dirName);
+    ~IfCache();
+
+    // Sets the most bytes the entries may take on disk. The default
+    // is 256 megabytes.
+    void		setMaxBytes(size_t n)	{ maxBytes = n; }
+
+    // Computes the key for the given graph, processed with options
+    // described by the given string
+    void		getKey(SoNode *graph, const char *options,
+			       char key[KEY_SIZE]);
+
+    // Returns the result stored under the given key, or NULL if there
+    // is none. The returned node is not ref'ed.
+    SoNode *		lookup(const char key[KEY_SIZE]);
+
+    // Stores a result under the given key, removing old entries if
+    // that takes the cache over its size limit
+    void		store(const char key[KEY_SIZE], SoNode *result);
+
+    // Statistics for this run
+    int			getNumHits() const	{ return numHits; }
+    int			getNumMisses() const	{ return numMisses; }
+    int			getNumStored() const	{ return numStored; }
+    int			getNumEvicted() const	{ return numEvicted; }
+    size_t		getNumBytes() const	{ return numBytes; }
+
+  private:
+    // An entry in the index. Removed entries have an empty key.
+    struct Entry {
+	char		key[KEY_SIZE];
+	size_t		numBytes;
+	int		lastUsed;	// Run that last used it
+	int		nextSameHash;	// Next entry with same dict key, or -1
+    };
+
+    SbString		dirName;
+    size_t		maxBytes;
+    int			run;		// Number of this run
+    SbList<Entry>	entries;
+    SbDict		*entryDict;	// Maps key hashes to index + 1 of the
+					// first entry in a chain
+    size_t		numBytes;	// Total size of entries
+    int			numHits, numMisses, numStored, numEvicted;
+
+    // Reads and writes the index file
+    void		readIndex();
+    void		writeIndex();
+
+    // Adds an entry, returning its index
+    int			addEntry(const char *key, size_t n, int lastUsed);
+
+    // Returns the index of the entry with the given key, or -1
+    int			findEntry(const char *key) const;
+
+    // Removes an entry and its file
+    void		removeEntry(int index);
+
+    // Removes least recently used entries until the cache fits
+    void		evict();
+
+    // Returns the full name of a file in the cache directory
+    SbString		getFileName(const char *name) const;
+
+    // Returns the dictionary key for a cache key
+    static unsigned long getDictKey(const char *key);
+
+    // Writes a graph into a newly allocated buffer, which the caller
+    // must free()
+    static void		writeToBuffer(SoNode *graph, void *&buf,
+				      size_t &size);
+
+    // Reallocation callback for SoOutput
+    static void *	reallocCB(void *ptr, size_t newSize);
+};
+
+#endif /* _IF_CACHE_ */
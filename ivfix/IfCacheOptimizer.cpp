@@ -0,0 +1,557 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <math.h>
+
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+
+#include "IfAssert.h"
+#include "IfCacheOptimizer.h"
+#include "IfHolder.h"
+#include "IfVertexCache.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfCacheOptimizer::IfCacheOptimizer()
+{
+    holder    = NULL;
+    cacheSize = 16;
+    triVerts  = NULL;
+    newOrder  = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfCacheOptimizer::~IfCacheOptimizer()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// This takes a scene graph produced by flattening and condensing a
+// graph and reorders its triangles and vertices for the vertex cache.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCacheOptimizer::optimize(IfHolder *_holder)
+{
+    holder = _holder;
+
+    // There had better be an SoIndexedFaceSet in the IfHolder
+    ASSERT(holder->faceSet != NULL);
+
+    // Each triangle has 3 indices and a -1
+    ASSERT(holder->faceSet->coordIndex.getNum() % 4 == 0);
+    numTris = holder->faceSet->coordIndex.getNum() / 4;
+
+    // If the materials share the coordinate indices, they will not
+    // survive renumbering the coordinates, so give the materials
+    // their own copy of the indices
+    if (holder->faceSet->materialIndex.getNum() == 1 &&
+	holder->faceSet->materialIndex[0] < 0)
+	holder->faceSet->materialIndex = holder->faceSet->coordIndex;
+
+    // Find the distinct vertices of each triangle
+    createVertices();
+
+    holder->numStrips		 = 0;
+    holder->numOutputTris	 = numTris;
+    holder->numCacheMissesBefore = countMisses(NULL);
+
+    // Find a good order for the triangles and rearrange the indices
+    // into it
+    orderTriangles();
+    reorderIndices();
+
+    holder->numCacheMisses = countMisses(newOrder);
+
+    // Store the values in the order in which they are used
+    renumberValues();
+
+    // Clean up
+    delete [] triVerts;
+    delete [] newOrder;
+    triVerts = newOrder = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Fills in triVerts with the distinct vertices of each
+// triangle. Vertices are distinct if any of their coordinate, normal,
+// texture coordinate, or material indices differ.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCacheOptimizer::createVertices()
+{
+    SoIndexedFaceSet *faceSet = holder->faceSet;
+
+    const int32_t *coordIndices = faceSet->coordIndex.getValues(0);
+    const int32_t *normalIndices =
+	((holder->doNormals && faceSet->normalIndex.getNum() > 1) ?
+	 faceSet->normalIndex.getValues(0) : NULL);
+    const int32_t *texCoordIndices =
+	((holder->doTexCoords && faceSet->textureCoordIndex.getNum() > 1) ?
+	 faceSet->textureCoordIndex.getValues(0) : NULL);
+    const int32_t *mtlIndices = (faceSet->materialIndex.getNum() > 1 ?
+				 faceSet->materialIndex.getValues(0) : NULL);
+
+    // The vertices found so far with each coordinate index are kept
+    // in a chain, so we can find duplicates easily. The other indices
+    // of each vertex are stored to compare against.
+    int numCoords = holder->coords->point.getNum();
+    int maxNumVerts = 3 * numTris;
+    int *firstVert  = new int[numCoords];
+    int *nextVert   = new int[maxNumVerts];
+    int *vertIndex  = new int[maxNumVerts];
+    int i;
+    for (i = 0; i < numCoords; i++)
+	firstVert[i] = -1;
+
+    triVerts = new int[maxNumVerts];
+    numVerts = 0;
+
+    for (i = 0; i < maxNumVerts; i++) {
+	int index = (i / 3) * 4 + i % 3;
+	int c = coordIndices[index];
+	ASSERT(c >= 0 && c < numCoords);
+
+	int v;
+	for (v = firstVert[c]; v >= 0; v = nextVert[v]) {
+	    int j = vertIndex[v];
+	    if ((normalIndices   == NULL ||
+		 normalIndices[j]   == normalIndices[index]) &&
+		(texCoordIndices == NULL ||
+		 texCoordIndices[j] == texCoordIndices[index]) &&
+		(mtlIndices      == NULL ||
+		 mtlIndices[j]      == mtlIndices[index]))
+		break;
+	}
+
+	if (v < 0) {
+	    v = numVerts++;
+	    vertIndex[v] = index;
+	    nextVert[v]  = firstVert[c];
+	    firstVert[c] = v;
+	}
+
+	triVerts[i] = v;
+    }
+
+    delete [] firstVert;
+    delete [] nextVert;
+    delete [] vertIndex;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Fills in newOrder with the triangles in an order that makes good
+// use of the vertex cache. Each vertex has a score based on its
+// position in a simulated LRU cache and on the number of triangles
+// using it that have not been added yet. The next triangle to add is
+// the one with the highest total score among those using vertices
+// in the cache. Only the scores of vertices in the cache change each
+// time, so this is linear in the number of triangles.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCacheOptimizer::orderTriangles()
+{
+    int i, j, k;
+
+    // Find the triangles using each vertex. The triangles for vertex
+    // v are stored in vertTris, starting at vertTriStart[v]. The
+    // first numActive[v] of them have not been added yet.
+    int *vertTriStart = new int[numVerts + 1];
+    int *vertTris     = new int[3 * numTris];
+    int *numActive    = new int[numVerts];
+    for (i = 0; i < numVerts; i++)
+	numActive[i] = 0;
+    for (i = 0; i < 3 * numTris; i++)
+	numActive[triVerts[i]]++;
+    vertTriStart[0] = 0;
+    for (i = 0; i < numVerts; i++) {
+	vertTriStart[i + 1] = vertTriStart[i] + numActive[i];
+	numActive[i] = 0;
+    }
+    for (i = 0; i < 3 * numTris; i++) {
+	int v = triVerts[i];
+	vertTris[vertTriStart[v] + numActive[v]++] = i / 3;
+    }
+
+    // Compute the initial scores
+    int   *cachePos  = new int[numVerts];
+    float *vertScore = new float[numVerts];
+    for (i = 0; i < numVerts; i++) {
+	cachePos[i]  = -1;
+	vertScore[i] = vertexScore(-1, numActive[i]);
+    }
+
+    float  *triScore = new float[numTris];
+    SbBool *isAdded  = new SbBool[numTris];
+    int bestTri = -1;
+    for (i = 0; i < numTris; i++) {
+	triScore[i] = (vertScore[triVerts[3*i + 0]] +
+		       vertScore[triVerts[3*i + 1]] +
+		       vertScore[triVerts[3*i + 2]]);
+	isAdded[i] = FALSE;
+	if (bestTri < 0 || triScore[i] > triScore[bestTri])
+	    bestTri = i;
+    }
+
+    // The simulated cache, most recently used first. There is room
+    // for the 3 vertices of a new triangle to push others out.
+    int *cache    = new int[cacheSize + 3];
+    int *newCache = new int[cacheSize + 3];
+    int cacheLen = 0;
+
+    // Used to find a triangle when none in the cache are left
+    int nextUnadded = 0;
+
+    newOrder = new int[numTris];
+
+    for (i = 0; i < numTris; i++) {
+
+	if (bestTri < 0) {
+	    while (isAdded[nextUnadded])
+		nextUnadded++;
+	    bestTri = nextUnadded;
+	}
+
+	newOrder[i] = bestTri;
+	isAdded[bestTri] = TRUE;
+
+	const int *verts = &triVerts[3 * bestTri];
+
+	// Remove the triangle from the active lists of its
+	// vertices. Each vertex has it once per corner it is used in.
+	for (j = 0; j < 3; j++) {
+	    int v = verts[j];
+	    int *tris = &vertTris[vertTriStart[v]];
+	    for (k = 0; k < numActive[v]; k++) {
+		if (tris[k] == bestTri) {
+		    tris[k] = tris[--numActive[v]];
+		    tris[numActive[v]] = bestTri;
+		    break;
+		}
+	    }
+	}
+
+	// Move the vertices of the triangle to the front of the cache
+	int newLen = 0;
+	for (j = 0; j < 3; j++) {
+	    if (j > 0 && verts[j] == verts[0])
+		continue;
+	    if (j > 1 && verts[j] == verts[1])
+		continue;
+	    newCache[newLen++] = verts[j];
+	}
+	for (j = 0; j < cacheLen; j++) {
+	    int v = cache[j];
+	    if (v != verts[0] && v != verts[1] && v != verts[2])
+		newCache[newLen++] = v;
+	}
+
+	// Update the scores of all vertices that were in either
+	// cache. Any that fell out of the cache get a position of -1.
+	for (j = 0; j < newLen; j++) {
+	    int v = newCache[j];
+	    cachePos[v]  = (j < cacheSize ? j : -1);
+	    vertScore[v] = vertexScore(cachePos[v], numActive[v]);
+	}
+
+	// Update the scores of the triangles using those vertices,
+	// and choose the best one of them to add next
+	bestTri = -1;
+	float bestScore = -1.0;
+	for (j = 0; j < newLen; j++) {
+	    int v = newCache[j];
+	    const int *tris = &vertTris[vertTriStart[v]];
+	    for (k = 0; k < numActive[v]; k++) {
+		int t = tris[k];
+		const int *tv = &triVerts[3 * t];
+		triScore[t] = (vertScore[tv[0]] +
+			       vertScore[tv[1]] + vertScore[tv[2]]);
+		if (j < cacheSize && triScore[t] > bestScore) {
+		    bestScore = triScore[t];
+		    bestTri   = t;
+		}
+	    }
+	}
+
+	// Keep what fits in the cache
+	cacheLen = (newLen < cacheSize ? newLen : cacheSize);
+	int *tmp = cache;
+	cache = newCache;
+	newCache = tmp;
+    }
+
+    delete [] vertTriStart;
+    delete [] vertTris;
+    delete [] numActive;
+    delete [] cachePos;
+    delete [] vertScore;
+    delete [] triScore;
+    delete [] isAdded;
+    delete [] cache;
+    delete [] newCache;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the score of a vertex at the given position in the cache
+// (-1 if not in it) with the given number of unused triangles. The
+// vertices of the last triangle get a fixed score, so it doesn't
+// matter which order they were used in; older vertices score lower
+// the older they get. Vertices with few triangles left get a boost,
+// to finish them off rather than leave lone triangles behind.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+float
+IfCacheOptimizer::vertexScore(int cachePos, int numActive) const
+{
+    // No triangles left to use it
+    if (numActive == 0)
+	return -1.0;
+
+    float score = 0.0;
+
+    if (cachePos >= 0) {
+	if (cachePos < 3)
+	    score = 0.75;
+	else {
+	    float s = 1.0 - (float) (cachePos - 3) / (cacheSize - 3);
+	    score = pow(s, 1.5);
+	}
+    }
+
+    score += 2.0 / sqrt((float) numActive);
+
+    return score;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the number of cache misses for the triangles in the given
+// order, or in their original order if order is NULL.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfCacheOptimizer::countMisses(const int *order)
+{
+    IfVertexCache cache(cacheSize, numVerts);
+
+    for (int i = 0; i < numTris; i++) {
+	const int *verts = &triVerts[3 * (order == NULL ? i : order[i])];
+	cache.access(verts[0]);
+	cache.access(verts[1]);
+	cache.access(verts[2]);
+    }
+
+    return cache.getNumMisses();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Rearranges all index fields that have 4 indices per triangle into
+// the new triangle order.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCacheOptimizer::reorderIndices()
+{
+    SoIndexedFaceSet *faceSet = holder->faceSet;
+
+    reorderIndexField(&faceSet->coordIndex);
+    reorderIndexField(&faceSet->normalIndex);
+    reorderIndexField(&faceSet->textureCoordIndex);
+    reorderIndexField(&faceSet->materialIndex);
+}
+
+void
+IfCacheOptimizer::reorderIndexField(SoMFInt32 *field)
+{
+    // Skip fields that are shared or unused
+    if (field->getNum() != 4 * numTris)
+	return;
+
+    int32_t *oldIndices = new int32_t[4 * numTris];
+    int32_t *indices = field->startEditing();
+    int i;
+    for (i = 0; i < 4 * numTris; i++)
+	oldIndices[i] = indices[i];
+
+    for (i = 0; i < numTris; i++) {
+	const int32_t *from = &oldIndices[4 * newOrder[i]];
+	int32_t *to = &indices[4 * i];
+	to[0] = from[0];
+	to[1] = from[1];
+	to[2] = from[2];
+	to[3] = from[3];
+    }
+
+    field->finishEditing();
+    delete [] oldIndices;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Renumbers the coordinates, normals, and texture coordinates in the
+// order in which the triangles first use them, so that the vertex
+// data is read sequentially. Normals and texture coordinates that
+// share the coordinate indices are moved along with the coordinates;
+// others are renumbered by their own indices. Values that are not
+// used by any triangle are removed.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// Renumbers the given indices in first-use order, storing the new
+// index of each old value in newIndex. Returns the number of values
+// used.
+static int
+renumberIndices(SoMFInt32 *field, int numValues, int *newIndex)
+{
+    int i, numUsed = 0;
+    for (i = 0; i < numValues; i++)
+	newIndex[i] = -1;
+
+    int	 numIndices = field->getNum();
+    int32_t *indices   = field->startEditing();
+    for (i = 0; i < numIndices; i++) {
+	int index = indices[i];
+	if (index < 0)
+	    continue;
+	if (newIndex[index] < 0)
+	    newIndex[index] = numUsed++;
+	indices[i] = newIndex[index];
+    }
+    field->finishEditing();
+
+    return numUsed;
+}
+
+// Moves the values in the given field to their new indices. Values
+// past the end of newIndex are not used.
+template <class FieldType, class ValueType> static void
+moveValues(FieldType *field, const int *newIndex, int numMapped, int numUsed)
+{
+    int numValues = field->getNum();
+    if (numValues > numMapped)
+	numValues = numMapped;
+    ValueType *oldValues = new ValueType[numValues];
+    const ValueType *values = field->getValues(0);
+    int i;
+    for (i = 0; i < numValues; i++)
+	oldValues[i] = values[i];
+
+    ValueType *newValues = field->startEditing();
+    for (i = 0; i < numValues; i++)
+	if (newIndex[i] >= 0)
+	    newValues[newIndex[i]] = oldValues[i];
+    field->finishEditing();
+    field->setNum(numUsed);
+
+    delete [] oldValues;
+}
+
+void
+IfCacheOptimizer::renumberValues()
+{
+    SoIndexedFaceSet *faceSet = holder->faceSet;
+
+    int numCoords = holder->coords->point.getNum();
+    int *newIndex = new int[numCoords];
+
+    int numUsed = renumberIndices(&faceSet->coordIndex, numCoords, newIndex);
+    moveValues<SoMFVec3f, SbVec3f>(&holder->coords->point,
+				   newIndex, numCoords, numUsed);
+
+    // Normals and texture coordinates that share the coordinate
+    // indices have one value per coordinate
+    SbBool shareNormals = (holder->doNormals &&
+			   faceSet->normalIndex.getNum() == 1 &&
+			   faceSet->normalIndex[0] < 0);
+    SbBool shareTexCoords = (holder->doTexCoords &&
+			     faceSet->textureCoordIndex.getNum() == 1 &&
+			     faceSet->textureCoordIndex[0] < 0);
+
+    if (shareNormals)
+	moveValues<SoMFVec3f, SbVec3f>(&holder->normals->vector,
+				       newIndex, numCoords, numUsed);
+    if (shareTexCoords)
+	moveValues<SoMFVec2f, SbVec2f>(&holder->texCoords->point,
+				       newIndex, numCoords, numUsed);
+    delete [] newIndex;
+
+    if (holder->doNormals && ! shareNormals &&
+	faceSet->normalIndex.getNum() > 1) {
+	int numNormals = holder->normals->vector.getNum();
+	newIndex = new int[numNormals];
+	numUsed = renumberIndices(&faceSet->normalIndex, numNormals, newIndex);
+	moveValues<SoMFVec3f, SbVec3f>(&holder->normals->vector,
+				       newIndex, numNormals, numUsed);
+	delete [] newIndex;
+    }
+
+    if (holder->doTexCoords && ! shareTexCoords &&
+	faceSet->textureCoordIndex.getNum() > 1) {
+	int numTexCoords = holder->texCoords->point.getNum();
+	newIndex = new int[numTexCoords];
+	numUsed = renumberIndices(&faceSet->textureCoordIndex,
+				  numTexCoords, newIndex);
+	moveValues<SoMFVec2f, SbVec2f>(&holder->texCoords->point,
+				       newIndex, numTexCoords, numUsed);
+	delete [] newIndex;
+    }
+}
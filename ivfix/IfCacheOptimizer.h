@@ -0,0 +1,109 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfCacheOptimizer class: takes a condensed scene graph with an
+// SoIndexedFaceSet of independent triangles and reorders the
+// triangles for good reuse of the post-transform vertex cache. The
+// coordinates, normals, and texture coordinates are then renumbered
+// in the order in which the triangles first use them, so that they
+// are also fetched from memory in order.
+//
+// Triangles are ordered with Tom Forsyth's "Linear-Speed Vertex Cache
+// Optimisation" algorithm, which repeatedly adds the triangle with the
+// highest score, based on how recently its vertices were used and how
+// many unused triangles they have left.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_CACHE_OPTIMIZER_
+#define  _IF_CACHE_OPTIMIZER_
+
+#include <Inventor/SbBasic.h>
+
+class IfHolder;
+class SoMFInt32;
+
+class IfCacheOptimizer {
+
+  public:
+    IfCacheOptimizer();
+    ~IfCacheOptimizer();
+
+    // Sets the size of the vertex cache to optimize for. The default
+    // is 16.
+    void	setCacheSize(int size)		{ cacheSize = size; }
+
+    void	optimize(IfHolder *_holder);
+
+  private:
+    IfHolder	*holder;	// Holds most important stuff
+    int		cacheSize;	// Vertex cache size
+    int		numTris;	// Number of triangles
+    int		numVerts;	// Number of distinct vertices
+
+    // The distinct vertices of each triangle (3 per triangle). Two
+    // triangle vertices are the same if all of their indices are.
+    int		*triVerts;
+
+    // The triangles in their new order
+    int		*newOrder;
+
+    // Fills in triVerts
+    void	createVertices();
+
+    // Fills in newOrder
+    void	orderTriangles();
+
+    // Returns the number of cache misses for the triangles in the
+    // given order (the original order if NULL)
+    int		countMisses(const int *order);
+
+    // Rearranges the index fields into the new triangle order
+    void	reorderIndices();
+    void	reorderIndexField(SoMFInt32 *field);
+
+    // Renumbers the values in first-use order
+    void	renumberValues();
+
+    // Returns the score of a vertex at the given position in the
+    // cache (-1 if not in it) with the given number of unused
+    // triangles
+    float	vertexScore(int cachePos, int numActive) const;
+};
+
+#endif /* _IF_CACHE_OPTIMIZER_ */
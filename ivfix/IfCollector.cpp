@@ -60,6 +60,7 @@
 #include <Inventor/nodes/SoPointSet.h>
 #include <Inventor/nodes/SoProfile.h>
 #include <Inventor/nodes/SoProfileCoordinate2.h>
+#include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoShape.h>
 #include <Inventor/nodes/SoShapeHints.h>
 #include <Inventor/nodes/SoTexture2.h>
@@ -73,6 +74,7 @@
 
 #include "IfAssert.h"
 #include "IfCollector.h"
+#include "IfInterner.h"
 #include "IfShape.h"
 #include "IfTypes.h"
 
@@ -84,6 +86,22 @@
 
 IfCollector::IfCollector()
 {
+    currentShape = NULL;
+    liveState	 = NULL;
+    changes	 = NULL;
+    numChanges	 = 0;
+    maxChanges	 = 0;
+    lastMark	 = -1;
+    logChanges	 = FALSE;
+    checkMode	 = FALSE;
+    numMismatches = 0;
+    numPropertyNodes = 0;
+    numInternedNodes = 0;
+
+    // These are all the types that we consider to be "shapes"; in
+    // other words, we do not want to go below these nodes when
+    // processing a scene.
+    IfTypes::getShapeTypes(&shapeTypes);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -94,6 +112,7 @@ IfCollector::IfCollector()
 
 IfCollector::~IfCollector()
 {
+    delete [] changes;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -108,13 +127,292 @@ IfCollector::collect(SoNode *sceneRoot, IfShape *&shapeList,
 		     SbBool doTexCoords)
 {
     doingTexCoords = doTexCoords;
+    numMismatches  = 0;
 
-    // These are all the types that we consider to be "shapes"; in
-    // other words, we do not want to go below these nodes when
-    // processing a scene.
-    SoTypeList shapeTypes;
-    IfTypes::getShapeTypes(&shapeTypes);
+    // Find the shapes and their properties in one traversal
+    collectLive(sceneRoot);
+
+    int numShapes = liveShapes.getLength();
+    int i;
+
+    // In check mode, collect the shapes again the old way and make
+    // sure the results match
+    if (checkMode) {
+	IfShape *pathShapes;
+	int numPathShapes = collectByPaths(sceneRoot, pathShapes);
+
+	if (numPathShapes != numShapes)
+	    numMismatches = (numShapes > numPathShapes ?
+			     numShapes : numPathShapes);
+	else {
+	    for (i = 0; i < numShapes; i++)
+		if (! sameShapes((IfShape *) liveShapes[i], &pathShapes[i]))
+		    numMismatches++;
+	}
+
+	delete [] pathShapes;
+    }
+
+    if (numShapes == 0) {
+	shapeList = NULL;
+	return 0;
+    }
+
+    // Allocate an array of IfShape instances of the correct size and
+    // move the collected shapes into it. Then replace property nodes
+    // that have the same values with one of them, so that shapes
+    // with equal properties share nodes.
+    shapeList = new IfShape[numShapes];
+    IfInterner interner;
+    for (i = 0; i < numShapes; i++) {
+	IfShape *shape = (IfShape *) liveShapes[i];
+	shapeList[i].copyNodes(shape);
+	delete shape;
+	interner.internShape(&shapeList[i]);
+    }
+    liveShapes.truncate(0);
+
+    numPropertyNodes = interner.getNumNodes();
+    numInternedNodes = interner.getNumCanonical();
+
+    return numShapes;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Collects all shapes in a single traversal of the scene. The
+// properties that apply at the current point in the traversal are
+// kept in liveState, which is copied into an IfShape at each shape.
+// Every change to liveState is saved, so that the changes made under
+// a separator can be undone when the traversal leaves it. This
+// visits each node once and copies no paths.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCollector::collectLive(SoNode *sceneRoot)
+{
+    liveState  = new IfShape;
+    numChanges = 0;
+    lastMark   = -1;
+
+    SoCallbackAction cba;
+    cba.addPreCallback(SoNode::getClassTypeId(), storeLiveNodeCB, this);
+    cba.addPostCallback(SoSeparator::getClassTypeId(),
+			leaveSeparatorCB, this);
+    cba.apply(sceneRoot);
+
+    // Undo anything left over (in case the traversal was cut short)
+    // so that liveState refers only to nodes it ref'ed
+    leaveSeparator(NULL);
+
+    delete liveState;
+    liveState = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Handles a node encountered in the single traversal of the scene.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoCallbackAction::Response
+IfCollector::storeLiveNode(SoCallbackAction *cba, SoNode *node)
+{
+    SoType type = node->getTypeId();
+
+    // Shapes are collected, and we do not go below them
+    for (int i = 0; i < shapeTypes.getLength(); i++) {
+	if (type.isDerivedFrom(shapeTypes[i])) {
+	    storeLiveShape(cba, node);
+	    return SoCallbackAction::PRUNE;
+	}
+    }
+
+    // Mark the start of a separator, so the changes made under it
+    // can be undone
+    if (type.isDerivedFrom(SoSeparator::getClassTypeId())) {
+	int mark = addChange();
+	changes[mark].separator = node;
+	changes[mark].prevMark  = lastMark;
+	lastMark = mark;
+    }
+
+    // Any other node is treated just like a node found on the path
+    // to a shape
+    currentShape = liveState;
+    logChanges   = TRUE;
+    SoCallbackAction::Response response = storeNode(cba, node);
+    logChanges   = FALSE;
+
+    return response;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Creates an IfShape for a shape node from the live state.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCollector::storeLiveShape(SoCallbackAction *cba, SoNode *node)
+{
+    SoType type = node->getTypeId();
+
+    IfShape *shape = new IfShape;
+    shape->copyNodes(liveState);
+
+    shape->shape = node;
+    shape->shape->ref();
+
+    // File, LOD, line- and point-based shape nodes, and some others
+    // are handled specially, since we want to make sure they are
+    // never flattened
+    if (IfTypes::isOpaqueGroupType(type) ||
+	IfTypes::isUnflattenableShape(type))
+	shape->dontFlatten = TRUE;
+    else
+	ASSERT(IfTypes::isShape(type));
+
+    shape->transform = SoModelMatrixElement::get(cba->getState());
+
+    finishShape(shape);
+
+    liveShapes.append(shape);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Undoes all changes made to the live state since the given separator
+// was entered. Passing NULL undoes all changes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCollector::leaveSeparator(const SoNode *separator)
+{
+    // The separator may not have been marked if it is also a shape
+    // (such as an SoWWWAnchor), in which case nothing changed
+    int mark;
+    if (separator == NULL)
+	mark = 0;
+    else if (lastMark >= 0 && changes[lastMark].separator == separator)
+	mark = lastMark;
+    else
+	return;
+
+    while (numChanges > mark) {
+	StateChange &change = changes[--numChanges];
+
+	if (change.node != NULL) {
+	    if (*change.node != NULL)
+		(*change.node)->unref();
+	    *change.node = change.oldNode;
+	}
 
+	else if (change.list != NULL) {
+	    if (change.oldLength < 0) {
+		delete *change.list;
+		*change.list = NULL;
+	    }
+	    else
+		(*change.list)->truncate(change.oldLength);
+	}
+
+	else
+	    lastMark = change.prevMark;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Adds an empty entry to the list of changes, returning its index.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfCollector::addChange()
+{
+    if (numChanges == maxChanges) {
+	maxChanges = (maxChanges == 0 ? 256 : 2 * maxChanges);
+	StateChange *newChanges = new StateChange[maxChanges];
+	for (int i = 0; i < numChanges; i++)
+	    newChanges[i] = changes[i];
+	delete [] changes;
+	changes = newChanges;
+    }
+
+    StateChange &change = changes[numChanges];
+    change.node		= NULL;
+    change.oldNode	= NULL;
+    change.list		= NULL;
+    change.oldLength	= -1;
+    change.separator	= NULL;
+    change.prevMark	= -1;
+
+    return numChanges++;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Sets a node pointer in the shape being collected. The new node is
+// ref'ed. If the live state is being changed, the old node is saved
+// (along with its reference) so the change can be undone; otherwise
+// it is unref'ed.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCollector::setNode(SoNode **field, SoNode *node)
+{
+    if (node != NULL)
+	node->ref();
+
+    if (logChanges) {
+	int i = addChange();
+	changes[i].node	   = field;
+	changes[i].oldNode = *field;
+    }
+    else if (*field != NULL)
+	(*field)->unref();
+
+    *field = node;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Appends a node to a node list in the shape being collected,
+// creating the list if necessary. If the live state is being changed,
+// the old length of the list is saved so the change can be undone.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCollector::addToList(SoNodeList **list, SoNode *node)
+{
+    if (logChanges) {
+	int i = addChange();
+	changes[i].list	     = list;
+	changes[i].oldLength = (*list == NULL ? -1 : (*list)->getLength());
+    }
+
+    if (*list == NULL)
+	*list = new SoNodeList;
+    (*list)->append(node);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Collects all shapes the old way: a first traversal stores a path to
+// each shape, and each path is then traversed to collect the
+// properties of its shape. The shapes are not interned. Returns the
+// number of shapes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfCollector::collectByPaths(SoNode *sceneRoot, IfShape *&shapeList)
+{
     // To find all the shapes in the scene, we apply an
     // SoCallbackAction to the root. We would like to use an
     // SoSearchAction, which is much faster, but we have to search for
@@ -143,6 +441,8 @@ IfCollector::collect(SoNode *sceneRoot, IfShape *&shapeList,
     for (i = 0; i < numShapes; i++)
 	collectShape(pathsToShapes[i], &shapeList[i]);
 
+    pathsToShapes.truncate(0);
+
     return numShapes;
 }
 
@@ -206,8 +506,20 @@ IfCollector::collectShape(const SoPath *pathToShape, IfShape *shape)
     // Examine each node that affects the shape
     ca.apply((SoPath *) pathToShape);
 
-    // If the shape is derived from SoVertexShape and has a non-NULL
-    // vertexProperty field, this has to be handled specially
+    finishShape(shape);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Finishes a collected shape. If the shape is derived from
+// SoVertexShape and has a non-NULL vertexProperty field, this has to
+// be handled specially.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCollector::finishShape(IfShape *shape)
+{
     if (shape->shape->isOfType(SoVertexShape::getClassTypeId())) {
 	SoVertexShape *vs = (SoVertexShape *) shape->shape;
 	SoVertexProperty *vp =
@@ -267,15 +579,10 @@ IfCollector::storeNode(SoCallbackAction *cba, SoNode *node)
     currentShape->field = NULL
 
 #define SET_TO_NODE(field, classname)					      \
-    if (currentShape->field != NULL)					      \
-	currentShape->field->unref();					      \
-    currentShape->field = (classname *) node;				      \
-    currentShape->field->ref()
+    setNode((SoNode **) &currentShape->field, node)
 
 #define ADD_TO_LIST(field)						      \
-    if (currentShape->field == NULL)					      \
-	currentShape->field = new SoNodeList;				      \
-    currentShape->field->append(node)
+    addToList(&currentShape->field, node)
 
 #define DO_TYPE(classname, field)					      \
     else if (IS_OF_TYPE(classname)) {					      \
@@ -328,13 +635,9 @@ IfCollector::storeNode(SoCallbackAction *cba, SoNode *node)
     // their values later on, so we want to make sure that changing a
     // material does not affect other objects. (This is especially
     // important if fixing is done on several objects in the same
-    // scene graph.)
-    else if (IS_OF_TYPE(SoMaterial)) {
-	if (currentShape->material != NULL)
-	    currentShape->material->unref();
-	currentShape->material = (SoMaterial *) node->copy();
-	currentShape->material->ref();
-    }
+    // scene graph.) The copy is made when the material is interned
+    // (see IfInterner), so shapes with equal materials share one.
+    DO_TYPE(SoMaterial,			material)
 
     //////////////////////////////////////////////////////////////////
     //
@@ -390,66 +693,144 @@ IfCollector::handleVertexProperty(IfShape *shape, SoVertexProperty *vp)
     // Coordinates
     num = vp->vertex.getNum();
     if (num > 0) {
-	if (shape->coords != NULL)
-	    shape->coords->unref();
-	shape->coords = new SoCoordinate3;
-	shape->coords->ref();
-	shape->coords->point.setValues(0, num, vp->vertex.getValues(0));
+	SoCoordinate3 *coords = new SoCoordinate3;
+	coords->point.setValues(0, num, vp->vertex.getValues(0));
+	setNode((SoNode **) &shape->coords, coords);
     }
 
     // Normals
     num = vp->normal.getNum();
     if (num > 0) {
-	if (shape->normals != NULL) 
-	    shape->normals->unref();
-	shape->normals = new SoNormal;
-	shape->normals->ref();
-	shape->normals->vector.setValues(0, num, vp->normal.getValues(0));
+	SoNormal *normals = new SoNormal;
+	normals->vector.setValues(0, num, vp->normal.getValues(0));
+	setNode((SoNode **) &shape->normals, normals);
 
 	// Steal normal binding
-	shape->normalBinding = new SoNormalBinding;
-	shape->normalBinding->ref();
-	shape->normalBinding->value = vp->normalBinding.getValue();
+	SoNormalBinding *normalBinding = new SoNormalBinding;
+	normalBinding->value = vp->normalBinding.getValue();
+	setNode((SoNode **) &shape->normalBinding, normalBinding);
     }
 
     // Colors
     num = vp->orderedRGBA.getNum();
     if (num > 0) {
-	SoMaterial *oldMaterial = shape->material;
-	if (oldMaterial != NULL) {
-	    shape->material = (SoMaterial *) oldMaterial->copy();
-	    oldMaterial->unref();
-	}
+	SoMaterial *material;
+	if (shape->material != NULL)
+	    material = (SoMaterial *) shape->material->copy();
 	else
-	    shape->material = new SoMaterial;
-	shape->material->ref();
+	    material = new SoMaterial;
 
 	// Unpack the colors
-	shape->material->diffuseColor.setNum(num);
-	shape->material->transparency.setNum(num);
-	SbColor *dc = shape->material->diffuseColor.startEditing();
-	float   *tr = shape->material->transparency.startEditing();
+	material->diffuseColor.setNum(num);
+	material->transparency.setNum(num);
+	SbColor *dc = material->diffuseColor.startEditing();
+	float   *tr = material->transparency.startEditing();
 	const uint32_t *pc = vp->orderedRGBA.getValues(0);
 
 	for (int i = 0; i < num; i++)
 	    dc[i].setPackedValue(pc[i], tr[i]);
 
-	shape->material->diffuseColor.finishEditing();
-	shape->material->transparency.finishEditing();
+	material->diffuseColor.finishEditing();
+	material->transparency.finishEditing();
+
+	setNode((SoNode **) &shape->material, material);
 
 	// Steal material binding
-	shape->materialBinding = new SoMaterialBinding;
-	shape->materialBinding->ref();
-	shape->materialBinding->value = vp->materialBinding.getValue();
+	SoMaterialBinding *materialBinding = new SoMaterialBinding;
+	materialBinding->value = vp->materialBinding.getValue();
+	setNode((SoNode **) &shape->materialBinding, materialBinding);
     }
 
     // Texture coordinates
     num = vp->texCoord.getNum();
     if (num > 0) {
-	if (shape->texCoords != NULL) 
-	    shape->texCoords->unref();
-	shape->texCoords = new SoTextureCoordinate2;
-	shape->texCoords->ref();
-	shape->texCoords->point.setValues(0, num, vp->texCoord.getValues(0));
+	SoTextureCoordinate2 *texCoords = new SoTextureCoordinate2;
+	texCoords->point.setValues(0, num, vp->texCoord.getValues(0));
+	setNode((SoNode **) &shape->texCoords, texCoords);
     }
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if two shapes collected in different ways have the
+// same shape node, properties, and transform.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfCollector::sameShapes(const IfShape *s1, const IfShape *s2)
+{
+
+#define SAME_NODE(name)	sameNodes(s1->name, s2->name)
+#define SAME_LIST(name)	sameLists(s1->name, s2->name)
+
+    return (SAME_NODE(shape)		&&
+	    SAME_NODE(camera)		&&
+	    SAME_LIST(lights)		&&
+	    SAME_LIST(clipPlanes)	&&
+	    SAME_NODE(environment)	&&
+	    SAME_NODE(lightModel)	&&
+	    SAME_NODE(texture)		&&
+	    SAME_NODE(drawStyle)	&&
+	    SAME_NODE(shapeHints)	&&
+	    SAME_NODE(material)		&&
+	    SAME_LIST(other)		&&
+	    SAME_NODE(complexity)	&&
+	    SAME_NODE(coords)		&&
+	    SAME_NODE(font)		&&
+	    SAME_NODE(materialBinding)	&&
+	    SAME_NODE(normals)		&&
+	    SAME_NODE(normalBinding)	&&
+	    SAME_NODE(profileCoords)	&&
+	    SAME_LIST(profiles)		&&
+	    SAME_NODE(texCoords)	&&
+	    SAME_NODE(texCoordBinding)	&&
+	    SAME_LIST(textureTransforms) &&
+	    s1->transform   == s2->transform &&
+	    s1->dontFlatten == s2->dontFlatten);
+
+#undef SAME_NODE
+#undef SAME_LIST
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if two nodes are the same. Nodes created from
+// vertexProperty fields are new for each collection, so nodes of the
+// same type with equal field values are also considered the same.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfCollector::sameNodes(const SoNode *n1, const SoNode *n2)
+{
+    if (n1 == n2)
+	return TRUE;
+    if (n1 == NULL || n2 == NULL)
+	return FALSE;
+
+    return (n1->getTypeId() == n2->getTypeId() && n1->fieldsAreEqual(n2));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if two node lists contain the same nodes in the same
+// order. A NULL list is the same as an empty one.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfCollector::sameLists(const SoNodeList *l1, const SoNodeList *l2)
+{
+    int n1 = (l1 == NULL ? 0 : l1->getLength());
+    int n2 = (l2 == NULL ? 0 : l2->getLength());
+
+    if (n1 != n2)
+	return FALSE;
+
+    for (int i = 0; i < n1; i++)
+	if ((*l1)[i] != (*l2)[i])
+	    return FALSE;
+
+    return TRUE;
+}
@@ -63,10 +63,79 @@ class IfCollector {
     int		collect(SoNode *sceneRoot, IfShape *&shapeList,
 			SbBool doTexCoords);
 
+    // Sets whether collect() also collects the shapes the old way, by
+    // storing a path to each shape and traversing each path again,
+    // and compares the results. This is for checking that the faster
+    // single traversal finds the same shapes and properties. The
+    // default is FALSE.
+    void	setCheckMode(SbBool flag)	{ checkMode = flag; }
+
+    // Returns the number of shapes whose results differed in check
+    // mode. A difference in the number of shapes counts as all of
+    // them.
+    int		getNumMismatches() const	{ return numMismatches; }
+
+    // Returns the number of distinct property nodes found by
+    // collect() and the number left after nodes with the same values
+    // were replaced by one of them (see IfInterner)
+    int		getNumPropertyNodes() const	{ return numPropertyNodes; }
+    int		getNumInternedNodes() const	{ return numInternedNodes; }
+
   private:
+    // A change made to the live traversal state, saved so that it can
+    // be undone when traversal leaves the separator it was made
+    // under. A change either sets a node pointer, appends to a node
+    // list, or marks the start of a separator.
+    struct StateChange {
+	SoNode		**node;		// Node pointer that was set
+	SoNode		*oldNode;	// Its old value (keeps the ref)
+	SoNodeList	**list;		// Node list that was appended to
+	int		oldLength;	// Its old length, or -1 if NULL
+	const SoNode	*separator;	// Separator that was entered
+	int		prevMark;	// Index of the previous mark
+    };
+
     IfShape	*currentShape;		// IfShape being collected
+    IfShape	*liveState;		// Properties at current node
+    SoTypeList	shapeTypes;		// Types considered to be shapes
+    SbPList	liveShapes;		// IfShapes found in traversal
+    StateChange	*changes;		// Changes made to liveState
+    int		numChanges, maxChanges;
+    int		lastMark;		// Index of innermost separator mark
+    SbBool	logChanges;		// TRUE while changing liveState
     SoPathList	pathsToShapes;		// Paths to shapes in scene
     SbBool	doingTexCoords;		// TRUE if tex coords will be produced
+    SbBool	checkMode;		// TRUE to compare with paths
+    int		numMismatches;		// Result of check mode
+    int		numPropertyNodes;	// Statistics from interning
+    int		numInternedNodes;
+
+    // Collects all shapes in one traversal of the scene, appending
+    // an IfShape for each to liveShapes
+    void	collectLive(SoNode *sceneRoot);
+
+    // Handles a node encountered in the single traversal
+    SoCallbackAction::Response	storeLiveNode(SoCallbackAction *cba,
+					      SoNode *node);
+
+    // Creates an IfShape for a shape node from the live state
+    void	storeLiveShape(SoCallbackAction *cba, SoNode *node);
+
+    // Undoes all changes made under the given separator when
+    // traversal leaves it
+    void	leaveSeparator(const SoNode *separator);
+
+    // Adds an entry to the list of changes, returning its index
+    int		addChange();
+
+    // Sets a node pointer or appends to a node list of the shape
+    // being collected, saving the change if it is the live state
+    void	setNode(SoNode **field, SoNode *node);
+    void	addToList(SoNodeList **list, SoNode *node);
+
+    // Collects all shapes the old way, by storing paths to them and
+    // traversing each path. Returns the number of shapes.
+    int		collectByPaths(SoNode *sceneRoot, IfShape *&shapeList);
 
     // Stores a path to a shape found in the scene
     void	storePath(SoCallbackAction *cba);
@@ -74,6 +143,9 @@ class IfCollector {
     // Collects properties for a single shape
     void	collectShape(const SoPath *pathToShape, IfShape *shape);
 
+    // Finishes a collected shape, handling its own vertexProperty
+    void	finishShape(IfShape *shape);
+
     // Handles properties stored in a vertexProperty node
     void	handleVertexProperty(IfShape *shape, SoVertexProperty *vp);
 
@@ -81,7 +153,25 @@ class IfCollector {
     // shape. Returns a callback action response code.
     SoCallbackAction::Response	storeNode(SoCallbackAction *cba, SoNode *node);
 
+    // Returns TRUE if two shapes collected in different ways have the
+    // same shape node and properties
+    static SbBool	sameShapes(const IfShape *s1, const IfShape *s2);
+    static SbBool	sameNodes(const SoNode *n1, const SoNode *n2);
+    static SbBool	sameLists(const SoNodeList *l1, const SoNodeList *l2);
+
     // Callbacks
+    static SoCallbackAction::Response	storeLiveNodeCB(void *userData,
+							SoCallbackAction *cba,
+							const SoNode *node)
+	{ return ((IfCollector *) userData)->storeLiveNode(cba,
+							   (SoNode *) node); }
+
+    static SoCallbackAction::Response	leaveSeparatorCB(void *userData,
+							 SoCallbackAction *,
+							 const SoNode *node)
+	{ ((IfCollector *) userData)->leaveSeparator(node);
+	  return SoCallbackAction::CONTINUE; }
+
     static SoCallbackAction::Response	storePathCB(void *userData,
 						    SoCallbackAction *cba,
 						    const SoNode *)
@@ -34,7 +34,6 @@
  *
  */
 
-#include <Inventor/SbBox.h>
 #include <Inventor/SbDict.h>
 #include <Inventor/nodes/SoCoordinate3.h>
 #include <Inventor/nodes/SoIndexedShape.h>
@@ -44,8 +43,9 @@
 
 #include "IfAssert.h"
 #include "IfCondenser.h"
-#include "IfHasher.h"
 #include "IfHolder.h"
+#include "IfOpenHasher.h"
+#include "IfWelder.h"
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -56,6 +56,7 @@
 IfCondenser::IfCondenser()
 {
     holder = NULL;
+    weldTolerance = 0.0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -104,20 +105,8 @@ IfCondenser::condense(IfHolder *_holder)
 void
 IfCondenser::condenseCoordinates()
 {
-    int		  numCoords = holder->coords->point.getNum();
     const SbVec3f *coords   = holder->coords->point.getValues(0);
 
-    // Determine the 3D extent of the coordinates so the hash
-    // function can normalize coordinates into the range 0 to 1.
-    SbBox3f box;
-    int i;
-    for (i = 0; i < numCoords; i++)
-	box.extendBy(coords[i]);
-    SbVec3f scale;
-    box.getSize(scale[0],scale[1], scale[2]);
-    for (i = 0; i < 3; i++)
-	scale[i] = (scale[i] == 0.f ? 1.f : 1.f / scale[i]);
-
     // Create a new field in which to store the uniquified coordinates
     SoMFVec3f uniqueCoords;
     uniqueCoords.setContainer(NULL);
@@ -127,10 +116,10 @@ IfCondenser::condenseCoordinates()
     int	 numIndices = holder->triSet->coordIndex.getNum();
     int32_t *indices   = holder->triSet->coordIndex.startEditing();
 
-    // Create a IfHasher to store the coordinates
-    IfHasher coordHasher(&uniqueCoords, numIndices, box.getMin(), scale);
+    // Create a IfOpenHasher to store the coordinates
+    IfOpenHasher coordHasher(&uniqueCoords, numIndices);
 
-    for (i = 0; i < numIndices; i++)
+    for (int i = 0; i < numIndices; i++)
 	if (indices[i] >= 0)
 	    indices[i] = coordHasher.addVector(coords[indices[i]]);
 
@@ -139,6 +128,97 @@ IfCondenser::condenseCoordinates()
 
     // Replace the coordinates with the unique ones
     holder->coords->point = uniqueCoords;
+
+    if (weldTolerance > 0.0)
+	weldCoordinates();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Welds coordinates that are within the weld tolerance of each other,
+// updating the coordinate indices in the triangle strip set.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCondenser::weldCoordinates()
+{
+    int numCoords = holder->coords->point.getNum();
+    int32_t *newIndex = new int32_t[numCoords];
+
+    IfWelder welder(weldTolerance);
+    holder->numWeldedCoords = welder.weld(&holder->coords->point, newIndex);
+
+    if (holder->numWeldedCoords > 0) {
+	int	 numIndices = holder->triSet->coordIndex.getNum();
+	int32_t *indices    = holder->triSet->coordIndex.startEditing();
+	for (int i = 0; i < numIndices; i++)
+	    if (indices[i] >= 0)
+		indices[i] = newIndex[indices[i]];
+	holder->triSet->coordIndex.finishEditing();
+
+	// Triangles with two welded vertices no longer have any area
+	removeDegenerateTriangles();
+    }
+
+    delete [] newIndex;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Removes triangles that use the same coordinate more than once. At
+// this point each triangle takes up 4 entries (3 vertices and an end
+// marker) in the coordinate index field and in any other index fields
+// that are in use, so the same triangles are removed from all of them.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfCondenser::removeDegenerateTriangles()
+{
+    SoIndexedShape *triSet = holder->triSet;
+
+    int numIndices = triSet->coordIndex.getNum();
+    int numTris = numIndices / 4;
+    ASSERT(numTris * 4 == numIndices);
+
+    // Collect the index fields that have to be changed
+    SoMFInt32 *fields[4];
+    int32_t   *vals[4];
+    int	       numFields = 0;
+    fields[numFields++] = &triSet->coordIndex;
+    if (holder->doNormals)
+	fields[numFields++] = &triSet->normalIndex;
+    if (holder->doTexCoords)
+	fields[numFields++] = &triSet->textureCoordIndex;
+    fields[numFields++] = &triSet->materialIndex;
+
+    int f;
+    for (f = 0; f < numFields; f++) {
+	ASSERT(fields[f]->getNum() == numIndices);
+	vals[f] = fields[f]->startEditing();
+    }
+
+    const int32_t *ci = vals[0];
+    int numKept = 0;
+    for (int t = 0; t < numTris; t++) {
+	int i = 4 * t;
+	if (ci[i] == ci[i+1] || ci[i+1] == ci[i+2] || ci[i] == ci[i+2])
+	    continue;
+
+	if (numKept != t)
+	    for (f = 0; f < numFields; f++)
+		for (int j = 0; j < 4; j++)
+		    vals[f][4 * numKept + j] = vals[f][i + j];
+	numKept++;
+    }
+
+    for (f = 0; f < numFields; f++) {
+	fields[f]->finishEditing();
+	fields[f]->setNum(4 * numKept);
+    }
+
+    holder->numDegenerateTris = numTris - numKept;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -151,13 +231,8 @@ IfCondenser::condenseCoordinates()
 void
 IfCondenser::condenseNormals()
 {
-    //int		  numNormals = holder->normals->vector.getNum();
     const SbVec3f *normals   = holder->normals->vector.getValues(0);
 
-    // Normals always lie between -1 and 1 in all dimensions
-    SbVec3f min(-1.0, -1.0, -1.0);
-    SbVec3f scale(0.5, 0.5, 0.5);
-
     // Create a new field in which to store the uniquified normals
     SoMFVec3f uniqueNormals;
     uniqueNormals.setContainer(NULL);
@@ -167,8 +242,8 @@ IfCondenser::condenseNormals()
     int	 numIndices = holder->triSet->normalIndex.getNum();
     int32_t *indices   = holder->triSet->normalIndex.startEditing();
 
-    // Create a IfHasher to store the normals
-    IfHasher normalHasher(&uniqueNormals, numIndices, min, scale);
+    // Create a IfOpenHasher to store the normals
+    IfOpenHasher normalHasher(&uniqueNormals, numIndices);
 
     for (int i = 0; i < numIndices; i++)
 	if (indices[i] >= 0)
@@ -197,13 +272,8 @@ IfCondenser::condenseNormals()
 void
 IfCondenser::condenseTextureCoordinates()
 {
-    //int		  numTexCoords = holder->texCoords->point.getNum();
     const SbVec2f *texCoords   = holder->texCoords->point.getValues(0);
 
-    // Texture Coordinates always lie between 0 and 1 in both dimensions
-    SbVec2f min(0.0, 0.0);
-    SbVec2f scale(1.0, 1.0);
-
     // Create a new field in which to store the uniquified texture coordinates
     SoMFVec2f uniqueTexCoords;
     uniqueTexCoords.setContainer(NULL);
@@ -213,8 +283,8 @@ IfCondenser::condenseTextureCoordinates()
     int	 numIndices = holder->triSet->textureCoordIndex.getNum();
     int32_t *indices   = holder->triSet->textureCoordIndex.startEditing();
 
-    // Create a IfHasher to store the texture coordinates
-    IfHasher texCoordHasher(&uniqueTexCoords, numIndices, min, scale);
+    // Create a IfOpenHasher to store the texture coordinates
+    IfOpenHasher texCoordHasher(&uniqueTexCoords, numIndices);
 
     for (int i = 0; i < numIndices; i++)
 	if (indices[i] >= 0)
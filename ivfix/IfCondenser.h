@@ -59,10 +59,16 @@ class IfCondenser {
     IfCondenser();
     ~IfCondenser();
 
+    // Sets the distance within which coordinates are welded
+    // together. The default is 0, meaning that only identical
+    // coordinates are merged.
+    void	setWeldTolerance(float tol)	{ weldTolerance = tol; }
+
     void	condense(IfHolder *_holder);
 
   private:
     IfHolder		*holder;	// Holds most important stuff
+    float		weldTolerance;	// Distance for welding coords
 
     // Removes duplicate coordinates, normals, or texture coordinates,
     // updating the indices in the triangle shape.
@@ -70,6 +76,11 @@ class IfCondenser {
     void		condenseNormals();
     void		condenseTextureCoordinates();
 
+    // Welds coordinates within the tolerance of each other and
+    // removes the triangles that become degenerate as a result
+    void		weldCoordinates();
+    void		removeDegenerateTriangles();
+
     // Condenses the material indices if possible
     void		condenseMaterials();
 
@@ -35,6 +35,7 @@
  */
 
 #include "IfBuilder.h"
+#include "IfCache.h"
 #include "IfCollector.h"
 #include "IfFixer.h"
 #include "IfMerger.h"
@@ -54,9 +55,26 @@
 IfFixer::IfFixer()
 {
     doStrips	= TRUE;
+    stripMethod	= GREEDY_STRIPS;
+    cacheSize	= 16;
+    optimizeFaces = FALSE;
     doVP	= TRUE;
+    packVP	= FALSE;
     doNormals	= TRUE;
     doTexCoords	= TRUE;
+    useSoTransform = FALSE;
+    numThreads	= 1;
+    weldTolerance = 0.0;
+    maxPromotionBytes = 4096;
+    maxBatchVertices = 0;
+    maxChunkTriangles = 0;
+    numLODLevels = 0;
+    lodRatios = NULL;
+    checkCollection = FALSE;
+    cacheDirName = NULL;
+    maxCacheBytes = 256 * 1024 * 1024;
+    lowMemory = FALSE;
+    maxResidentBytes = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -116,19 +134,29 @@ IfFixer::fix(SoNode *root)
     IfReporter::reportNodeCount("Original graph", root);
 
     // Replace hard-to-deal-with nodes with friendlier nodes
-    IfReporter::startReport("Replacing problem nodes");
+    IfReporter::startStage("replace", "Replacing problem nodes");
     IfReplacer *replacer = new IfReplacer;
     replacer->replace(root);
+    IfReporter::finishStage();
+    IfReporter::reportInterning("After replacing colors",
+				replacer->getNumReplaced(),
+				replacer->getNumMaterials());
     delete replacer;
-    IfReporter::finishReport();
 
     // Collect all shapes
-    IfReporter::startReport("Collecting shapes");
+    IfReporter::startStage("collect", "Collecting shapes");
     IfShape *shapes;
     IfCollector *collector = new IfCollector;
+    collector->setCheckMode(checkCollection);
     int numShapes = collector->collect(root, shapes, doTexCoords);
+    IfReporter::finishStage();
+    if (checkCollection)
+	IfReporter::reportCollectionCheck("Checking collection", numShapes,
+					  collector->getNumMismatches());
+    IfReporter::reportInterning("After interning",
+				collector->getNumPropertyNodes(),
+				collector->getNumInternedNodes());
     delete collector;
-    IfReporter::finishReport();
 
     // The IfShape instances ref() all the nodes they keep, so we don't
     // have to keep around the original scene graph
@@ -143,40 +171,84 @@ IfFixer::fix(SoNode *root)
     IfReporter::reportShapeList("After collecting", &shapeList);
 
     // Sort the shapes
-    IfReporter::startReport("Sorting shapes");
+    IfReporter::startStage("sort", "Sorting shapes");
     IfSorter *sorter = new IfSorter;
+    sorter->setNumThreads(numThreads);
     sorter->sort(shapeList);
     delete sorter;
-    IfReporter::finishReport();
+    IfReporter::finishStage();
     IfReporter::reportShapeList("After sorting", &shapeList, TRUE);
 
     // Merge adjacent shapes to get a minimal list
-    IfReporter::startReport("Merging shapes");
+    IfReporter::startStage("merge", "Merging shapes");
     IfMerger *merger = new IfMerger;
+    merger->setMaxPromotionBytes(maxPromotionBytes);
     merger->merge(shapeList);
+    IfReporter::finishStage();
+    IfReporter::reportMerging("After merging", merger->getNumMerged(),
+			      merger->getNumPromoted(),
+			      merger->getNumPromotionBytes(),
+			      merger->getNumRejected());
     delete merger;
-    IfReporter::finishReport();
     IfReporter::reportShapeList("After merging", &shapeList, TRUE);
 
-    // Build a scene graph from the sorted list of shapes
+    // Build a scene graph from the sorted list of shapes. This
+    // flattens, condenses, and strips each of its subgraphs, which
+    // the builder reports on itself.
+    IfReporter::startStage("build", NULL);
     IfBuilder *builder = new IfBuilder;
+    builder->setNumThreads(numThreads);
+    builder->setWeldTolerance(weldTolerance);
+    builder->setStripMethod(stripMethod == CACHE_STRIPS ?
+			    IfStripper::CACHE : IfStripper::GREEDY);
+    builder->setCacheSize(cacheSize);
+    builder->setOptimizeTriangles(optimizeFaces);
+    builder->setMaxBatchVertices(maxBatchVertices);
+    builder->setMaxChunkTriangles(maxChunkTriangles);
+    builder->setLODRatios(numLODLevels, lodRatios);
+    builder->setPackVertexProperty(packVP);
+    builder->setLowMemory(lowMemory);
+    builder->setMaxResidentBytes(maxResidentBytes);
+    IfCache *cache = NULL;
+    if (cacheDirName != NULL) {
+	cache = new IfCache(cacheDirName);
+	cache->setMaxBytes(maxCacheBytes);
+	builder->setCache(cache);
+    }
     SoNode *resultRoot = builder->build(shapeList, doStrips, doVP,
 					doNormals, doTexCoords, useSoTransform);
-    resultRoot->ref();
+    if (resultRoot != NULL)
+	resultRoot->ref();
     delete builder;
+    IfReporter::finishStage();
     IfReporter::finishReport();
+    if (cache != NULL) {
+	IfReporter::reportCache("Subgraph cache", cache->getNumHits(),
+				cache->getNumMisses(), cache->getNumStored(),
+				cache->getNumEvicted(), cache->getNumBytes());
+	delete cache;
+    }
+
+    // The shapes are no longer needed, so free them before weeding
+    delete [] shapes;
+
+    // The builder has reported why it failed
+    if (resultRoot == NULL)
+	return NULL;
 
     // Weed out any unnecessary stuff. This works in place.
-    IfReporter::startReport("Weeding unnecessary values");
+    IfReporter::startStage("weed", "Weeding unnecessary values");
     IfWeeder *weeder = new IfWeeder;
     weeder->weed(resultRoot);
+    IfReporter::finishStage();
+    IfReporter::reportMaterialWeeding("After weeding",
+				      weeder->getNumMaterialValues(),
+				      weeder->getNumUniqueMaterials(),
+				      weeder->getNumUsedMaterials());
     delete weeder;
-    IfReporter::finishReport();
 
     IfReporter::reportNodeCount("Final graph", resultRoot);
 
-    delete [] shapes;
-
     resultRoot->unrefNoDelete();
     return resultRoot;
 }
@@ -59,6 +59,12 @@ class IfFixer {
 	HIGH			// Lots of reporting
     };
 
+    // Methods of creating triangle strips
+    enum StripMethod {
+	GREEDY_STRIPS,		// Longest strips (the default)
+	CACHE_STRIPS		// Best vertex cache reuse
+    };
+
     IfFixer();
     ~IfFixer();
 
@@ -70,10 +76,28 @@ class IfFixer {
     // default) or independent faces
     void		setStripFlag(SbBool flag)	{ doStrips = flag; }
 
+    // Sets the method used to create triangle strips, and the size
+    // of the FIFO vertex cache that CACHE_STRIPS optimizes for and
+    // that is used to report cache miss ratios. The default cache
+    // size is 16.
+    void		setStripMethod(StripMethod m)	{ stripMethod = m; }
+    void		setCacheSize(int size)		{ cacheSize = size; }
+
+    // Sets flag indicating whether to reorder the triangles and
+    // vertices of independent faces (see setStripFlag()) to make good
+    // use of the vertex cache. The default is FALSE.
+    void		setOptimizeFacesFlag(SbBool flag) { optimizeFaces = flag; }
+
     // Sets flag indicating whether to output shape properties as
     // SoVertexProperty nodes (the default) or regular property nodes
     void		setVertexPropertyFlag(SbBool flag) { doVP = flag; }
 
+    // Sets flag indicating whether to pack the normals and texture
+    // coordinates of SoVertexProperty nodes at reduced precision, in
+    // SoPackedVertexProperty nodes. Readers of the result must
+    // register that node class. The default is FALSE.
+    void		setPackVertexPropertyFlag(SbBool flag) { packVP = flag; }
+
     // Sets flags indicating whether to output normals or texture
     // coordinates. The default is TRUE in both cases, meaning that
     // normals and texture coordinates will be output when necessary.
@@ -86,6 +110,65 @@ class IfFixer {
     // but worse file readability).
     void		setUseSoTransform(SbBool flag)	 { useSoTransform = flag; }
 
+    // Sets the number of threads used to sort the shapes and to
+    // flatten the subgraphs of the result. The default is 1. The
+    // result does not depend on the number of threads.
+    void		setNumThreads(int n)		 { numThreads = n; }
+
+    // Sets the distance within which coordinates are welded together.
+    // The default is 0, meaning that only identical coordinates are
+    // shared. Triangles that become degenerate are removed.
+    void		setWeldTolerance(float tol)	 { weldTolerance = tol; }
+
+    // Sets the largest number of bytes of material indices that may
+    // be added to merge one shape into another when their material
+    // bindings have to be promoted to PER_VERTEX_INDEXED (see
+    // IfMerger). The default is 4096; 0 disables promotion.
+    void		setMaxPromotionBytes(int bytes)
+	{ maxPromotionBytes = bytes; }
+
+    // Sets the most vertices that small shapes differing only in
+    // transform are pre-transformed into as one batch (see
+    // IfBuilder). Larger budgets mean fewer draw calls but bigger
+    // vertex buffers. The default is 0, meaning no limit.
+    void		setMaxBatchVertices(int n)	 { maxBatchVertices = n; }
+
+    // Sets the most triangles in each spatial chunk that a flattened
+    // subgraph is split into, so that parts of large meshes that are
+    // out of view can be culled (see IfPartitioner). The default is
+    // 0, meaning no splitting.
+    void		setMaxChunkTriangles(int n)	 { maxChunkTriangles = n; }
+
+    // Sets the fractions of the triangles kept in the simplified
+    // levels of detail made for each large flattened subgraph (see
+    // IfSimplifier), which must be decreasing. The array is not
+    // copied. The default is no levels of detail.
+    void		setLODRatios(int num, const float *ratios)
+	{ numLODLevels = num; lodRatios = ratios; }
+
+    // Sets whether the shapes found in a single traversal of the
+    // scene are checked against the old path-based collection (see
+    // IfCollector). This is slow and meant for regression testing.
+    // The default is FALSE.
+    void		setCheckCollection(SbBool flag)	 { checkCollection = flag; }
+
+    // Sets the directory of an on-disk cache of flattened subgraphs
+    // (see IfCache), and the most bytes it may take. Subgraphs that
+    // were flattened with the same options in an earlier run are
+    // taken from the cache. The default is NULL (no cache); the
+    // default size is 256 megabytes.
+    void		setCacheDirectory(const char *dirName)
+	{ cacheDirName = dirName; }
+    void		setMaxCacheBytes(size_t n)	 { maxCacheBytes = n; }
+
+    // Sets low-memory mode, in which each subgraph is flattened as
+    // soon as all its shapes are known and its source nodes are
+    // released, and the most bytes of flattened subgraphs kept in
+    // memory before they are spilled to a temporary file until the
+    // end (see IfBuilder). The defaults are FALSE and 0 (no limit).
+    void		setLowMemory(SbBool flag)	 { lowMemory = flag; }
+    void		setMaxResidentBytes(size_t n)	 { maxResidentBytes = n; }
+
     // Fixes a scene graph, returning the root of the result, or NULL
     // on error. If the passed root is not ref'ed, its memory will be
     // freed up before this finishes.
@@ -93,10 +176,26 @@ class IfFixer {
 
   private:
     SbBool		doStrips;
+    StripMethod		stripMethod;
+    int			cacheSize;
+    SbBool		optimizeFaces;
     SbBool		doVP;
+    SbBool		packVP;
     SbBool		doNormals;
     SbBool		doTexCoords;
     SbBool		useSoTransform;
+    int			numThreads;
+    float		weldTolerance;
+    int			maxPromotionBytes;
+    int			maxBatchVertices;
+    int			maxChunkTriangles;
+    int			numLODLevels;
+    const float		*lodRatios;
+    SbBool		checkCollection;
+    const char		*cacheDirName;
+    size_t		maxCacheBytes;
+    SbBool		lowMemory;
+    size_t		maxResidentBytes;
 };
 
 #endif /* _IF_FIXER_ */
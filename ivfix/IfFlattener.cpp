@@ -36,6 +36,7 @@
 
 #include <Inventor/SoPrimitiveVertex.h>
 #include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoGetPrimitiveCountAction.h>
 #include <Inventor/nodes/SoCoordinate3.h>
 #include <Inventor/nodes/SoIndexedShape.h>
 #include <Inventor/nodes/SoMaterialBinding.h>
@@ -60,6 +61,8 @@ IfFlattener::IfFlattener()
 
     numVerts      = 0;
     numMtlIndices = 0;
+    maxNumTris    = 0;
+    peakBytes     = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -86,16 +89,20 @@ IfFlattener::flatten(IfHolder *_holder)
 {
     holder = _holder;
 
-    // Assume that we will find lots of triangles. We'll clean up
-    // later if there are fewer. Fields will start out with this many
-    // entries. We double this size whenever we run out of space. When
-    // we're done, we shrink the fields down to the amount used.
+    // Count the triangles first, so the fields can be allocated at
+    // their final size rather than growing as triangles are
+    // added. Some shapes may not report their counts exactly, so we
+    // still double the size whenever we run out of space. When we're
+    // done, we shrink the fields down to the amount used.
+    SoGetPrimitiveCountAction pca;
+    pca.apply(holder->origRoot);
+    int numCountedTris = pca.getTriangleCount();
+
     coordVals    = NULL;
     normalVals   = NULL;
     texCoordVals = NULL;
     mtlIndexVals = NULL;
-    fieldSize = 20000;
-    expandFields();
+    expandFields(numCountedTris > 0 ? numCountedTris : 1);
 
     // We'll apply a callback action to produce triangles from all shapes
     SoCallbackAction cba;
@@ -120,16 +127,20 @@ IfFlattener::flatten(IfHolder *_holder)
 
     // Process the resulting structures to produce a graph
     createGraph();
+
+    holder->peakFlattenBytes     = peakBytes;
+    holder->doublingFlattenBytes = getDoublingBytes(numVerts / 3);
 }
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Expands the fields in the nodes to contain fieldSize entries.
+// Expands the fields in the nodes to hold the given number of
+// triangles.
 //
 /////////////////////////////////////////////////////////////////////////////
 
 void
-IfFlattener::expandFields()
+IfFlattener::expandFields(int newMaxNumTris)
 {
     // If already editing the fields, stop!
     if (coordVals != NULL) {
@@ -141,14 +152,20 @@ IfFlattener::expandFields()
 	    holder->texCoords->point.finishEditing();
     }
 
-    // Increase the size
-    holder->coords->point.setNum(fieldSize);
+    // The old and new values both exist while the values are copied
+    size_t bytes = getFieldBytes(maxNumTris) + getFieldBytes(newMaxNumTris);
+    if (bytes > peakBytes)
+	peakBytes = bytes;
+
+    // Increase the size. There are 3 vertices and 4 material indices
+    // (including the end-of-triangle marker) per triangle.
+    maxNumTris = newMaxNumTris;
+    holder->coords->point.setNum(3 * maxNumTris);
     if (holder->doNormals)
-	holder->normals->vector.setNum(fieldSize);
+	holder->normals->vector.setNum(3 * maxNumTris);
     if (holder->doTexCoords)
-	holder->texCoords->point.setNum(fieldSize);
-    holder->triSet->coordIndex.setNum(fieldSize);
-    holder->triSet->materialIndex.setNum(fieldSize);
+	holder->texCoords->point.setNum(3 * maxNumTris);
+    holder->triSet->materialIndex.setNum(4 * maxNumTris);
 
     // Start editing (again, maybe)
     coordVals = holder->coords->point.startEditing();
@@ -159,6 +176,56 @@ IfFlattener::expandFields()
 	texCoordVals = holder->texCoords->point.startEditing();
 }
 
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the number of bytes used by the fields for the given
+// number of triangles.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+size_t
+IfFlattener::getFieldBytes(int numTris) const
+{
+    size_t bytesPerTri = 3 * sizeof(SbVec3f) + 4 * sizeof(int32_t);
+    if (holder->doNormals)
+	bytesPerTri += 3 * sizeof(SbVec3f);
+    if (holder->doTexCoords)
+	bytesPerTri += 3 * sizeof(SbVec2f);
+
+    return numTris * bytesPerTri;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the most bytes the fields would have used at once for the
+// given number of triangles if they had grown by doubling. That
+// scheme kept the same number of entries in every field, including
+// the coordinate indices, and doubled it whenever the material
+// indices ran out of space.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+size_t
+IfFlattener::getDoublingBytes(int numTris) const
+{
+    size_t bytesPerEntry = sizeof(SbVec3f) + 2 * sizeof(int32_t);
+    if (holder->doNormals)
+	bytesPerEntry += sizeof(SbVec3f);
+    if (holder->doTexCoords)
+	bytesPerEntry += sizeof(SbVec2f);
+
+    size_t size = 20000;
+    size_t peak = size * bytesPerEntry;
+    while (4 * (size_t) numTris >= size) {
+	size_t bytes = (size + 2 * size) * bytesPerEntry;
+	if (bytes > peak)
+	    peak = bytes;
+	size *= 2;
+    }
+
+    return peak;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // Prepares to process the triangles making up a shape.
@@ -187,10 +254,8 @@ void
 IfFlattener::addTriangle(SoCallbackAction *, const SoPrimitiveVertex *verts[3])
 {
     // Make sure there's enough room in the fields
-    if (numMtlIndices + 4 >= fieldSize) {
-	fieldSize *= 2;
-	expandFields();
-    }
+    if (numVerts + 3 > 3 * maxNumTris)
+	expandFields(2 * maxNumTris);
 
     // For each of the three vertices
     for (int i = 0; i < 3; i++) {
@@ -309,6 +374,12 @@ IfFlattener::createGraph()
     }
     holder->triSet->coordIndex.finishEditing();
 
+    // All fields exist at this point
+    size_t bytes = (getFieldBytes(maxNumTris) +
+		    holder->triSet->coordIndex.getNum() * sizeof(int32_t));
+    if (bytes > peakBytes)
+	peakBytes = bytes;
+
     // The normal and texture coordinate indices start out the same as
     // the coordinate indices
     if (holder->doNormals)
@@ -316,16 +387,15 @@ IfFlattener::createGraph()
     if (holder->doTexCoords)
 	holder->triSet->textureCoordIndex = holder->triSet->coordIndex;
 
-    // Decrease the sizes of the fields if there is any extra space
-    if (numVerts < fieldSize) {
+    // Decrease the sizes of the fields if the count was too high
+    if (numTris < maxNumTris) {
 	holder->coords->point.setNum(numVerts);
 	if (holder->doNormals)
 	    holder->normals->vector.setNum(numVerts);
 	if (holder->doTexCoords)
 	    holder->texCoords->point.setNum(numVerts);
-    }
-    if (numMtlIndices < fieldSize)
 	holder->triSet->materialIndex.setNum(numMtlIndices);
+    }
 
     // Assume that the normals, materials, and texture coordinates are
     // bound per vertex, using the indices
@@ -69,7 +69,8 @@ class IfFlattener {
     SbMatrix	normalMatrix;	// For transforming normals
     SbMatrix	textureMatrix;	// For transforming texture coords
     int		numMtlIndices;	// Number of material indices stored
-    int		fieldSize;	// Number of entries allocated for fields
+    int		maxNumTris;	// Number of triangles allocated for
+    size_t	peakBytes;	// Most bytes used by fields at once
 
     // These hold pointers to the field value arrays (returned by
     // startEditing()) to make additions much faster:
@@ -78,7 +79,20 @@ class IfFlattener {
     SbVec2f	*texCoordVals;
     int32_t	*mtlIndexVals;
 
-    void	expandFields();
+    // Expands the fields in the nodes to hold the given number of
+    // triangles
+    void	expandFields(int newMaxNumTris);
+
+    // Returns the number of bytes used by the fields for the given
+    // number of triangles
+    size_t	getFieldBytes(int numTris) const;
+
+    // Returns the most bytes that the fields would have used at once
+    // for the given number of triangles if they had started out with
+    // 20000 entries and doubled in size whenever they ran out of
+    // space, as they used to. This is used to report the savings
+    // from counting the triangles first.
+    size_t	getDoublingBytes(int numTris) const;
 
     void	prepareForShape(SoCallbackAction *cba, const SoShape *shape);
     void	addTriangle(SoCallbackAction *cba,
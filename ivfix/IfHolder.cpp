@@ -46,6 +46,7 @@
 #include <Inventor/nodes/SoTextureCoordinate2.h>
 #include <Inventor/nodes/SoTextureCoordinateBinding.h>
 
+#include "../make/Common.h"
 #include "IfHolder.h"
 
 /////////////////////////////////////////////////////////////////////////////
@@ -107,6 +108,22 @@ IfHolder::IfHolder(SoNode *graphRoot, SbBool _doStrips,
     }
 
     root->addChild(triSet);
+
+    peakFlattenBytes     = 0;
+    doublingFlattenBytes = 0;
+    numWeldedCoords   = 0;
+    numDegenerateTris = 0;
+    numStrips         = 0;
+    numOutputTris     = 0;
+    numCacheMissesBefore = 0;
+    numCacheMisses    = 0;
+    numChunks         = 0;
+    numLODLevels      = 0;
+    numLODSourceTris  = 0;
+    numLODTris        = 0;
+    maxNormalError    = 0.0;
+    maxTexCoordError  = 0.0;
+    numPackedBytesSaved = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -130,10 +147,11 @@ IfHolder::~IfHolder()
 /////////////////////////////////////////////////////////////////////////////
 
 void
-IfHolder::convertToVertexProperty(SoMaterial *mtl)
+IfHolder::convertToVertexProperty(SoMaterial *mtl, SbBool doPack)
 {
     // Create a new SoVertexProperty node
-    SoVertexProperty *vp = new SoVertexProperty;
+    SoVertexProperty *vp = (doPack ? new SoPackedVertexProperty :
+			    new SoVertexProperty);
     vp->ref();
 
     // Copy the field values from the property nodes 
@@ -163,6 +181,19 @@ IfHolder::convertToVertexProperty(SoMaterial *mtl)
 	vp->orderedRGBA.finishEditing();
     }
 
+    // Pack the normals and texture coordinates. Each packed value
+    // takes 4 bytes, instead of 12 for a normal or 8 for a texture
+    // coordinate; the texture coordinate range adds 16 bytes.
+    if (doPack) {
+	int numN = vp->normal.getNum();
+	int numT = vp->texCoord.getNum();
+	((SoPackedVertexProperty *) vp)->pack(maxNormalError,
+					      maxTexCoordError);
+	numPackedBytesSaved = numN * (12 - 4);
+	if (numT > 0)
+	    numPackedBytesSaved += numT * (8 - 4) - 16;
+    }
+
     // Store the SoVertexProperty node in the shape
     triSet->vertexProperty = vp;
     vp->unref();
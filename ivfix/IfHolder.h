@@ -45,6 +45,7 @@
 #define  _IF_HOLDER_
 
 #include <Inventor/SbBasic.h>
+#include "IfMetrics.h"
 
 class SoCoordinate3;
 class SoIndexedFaceSet;
@@ -94,10 +95,58 @@ class IfHolder {
     // This holds whichever of the above shapes is actually used:
     SoIndexedShape		*triSet;
 
+    // Statistics from IfFlattener: the most bytes used at once by
+    // the fields it filled in, and the most they would have used if
+    // they had grown by doubling
+    size_t			peakFlattenBytes;
+    size_t			doublingFlattenBytes;
+
+    // Statistics from welding coordinates in IfCondenser
+    int				numWeldedCoords;
+    int				numDegenerateTris;
+
+    // Statistics from IfStripper or IfCacheOptimizer: the number of
+    // strips and triangles, and the number of vertex cache misses
+    // before and after optimizing
+    int				numStrips;
+    int				numOutputTris;
+    int				numCacheMissesBefore;
+    int				numCacheMisses;
+
+    // The number of chunks the triangles were split into by
+    // IfPartitioner, or 0. Once split, the root holds a separator for
+    // each chunk, and the other nodes above are no longer used.
+    int				numChunks;
+
+    // The number of simplified levels of detail made by IfSimplifier,
+    // or 0, the triangles they were made from, and the triangles in
+    // all of them. The root then holds an SoLOD whose first child has
+    // the full detail.
+    int				numLODLevels;
+    int				numLODSourceTris;
+    int				numLODTris;
+
+    // Statistics from packing the normals and texture coordinates:
+    // the largest angle between a normal and its packed value (in
+    // radians), the largest texture coordinate error, and the number
+    // of bytes saved
+    float			maxNormalError;
+    float			maxTexCoordError;
+    int				numPackedBytesSaved;
+
+    // The cost of flattening, condensing, and stripping (or
+    // optimizing) this graph, measured in the thread that did it
+    IfMetrics			flattenMetrics;
+    IfMetrics			condenseMetrics;
+    IfMetrics			stripMetrics;
+
     // Converts the scene graph to use an SoVertexProperty node for
     // the properties. The given material is used in case the
     // materials need to be copied into the SoVertexProperty node.
-    void			convertToVertexProperty(SoMaterial *mtl);
+    // If doPack is TRUE, an SoPackedVertexProperty is used, with the
+    // normals and texture coordinates stored at reduced precision.
+    void			convertToVertexProperty(SoMaterial *mtl,
+							SbBool doPack = FALSE);
 };
 
 #endif /* _IF_HOLDER_ */
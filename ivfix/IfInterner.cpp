@@ -0,0 +1,273 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <Inventor/SbDict.h>
+#include <Inventor/SbString.h>
+#include <Inventor/fields/SoField.h>
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoDrawStyle.h>
+#include <Inventor/nodes/SoEnvironment.h>
+#include <Inventor/nodes/SoFont.h>
+#include <Inventor/nodes/SoLightModel.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoShapeHints.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoTextureCoordinateBinding.h>
+
+#include "IfAssert.h"
+#include "IfInterner.h"
+#include "IfShape.h"
+#include "IfTypes.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfInterner::IfInterner()
+{
+    nodeDict = new SbDict(1235);
+    hashDict = new SbDict(1235);
+    numNodes     = 0;
+    numCanonical = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor. The nodes are unref'ed when nodeRefs goes away.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfInterner::~IfInterner()
+{
+    for (int i = 0; i < hashLists.getLength(); i++)
+	delete (SbPList *) hashLists[i];
+
+    delete nodeDict;
+    delete hashDict;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the canonical instance of the given node.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoNode *
+IfInterner::intern(SoNode *node)
+{
+    // See if we have already seen this node
+    void *entry;
+    if (nodeDict->find((unsigned long) node, entry))
+	return (SoNode *) entry;
+
+    // Keep the node around, so that its address can't be reused by
+    // another node while it is in the dictionary
+    nodeRefs.append(node);
+    numNodes++;
+
+    SoNode *canonical = NULL;
+    SbPList *list = NULL;
+
+    // Look for a node with the same values
+    if (canIntern(node)) {
+	uint32_t hashKey = computeHashKey(node);
+	if (hashDict->find(hashKey, entry))
+	    list = (SbPList *) entry;
+	else {
+	    list = new SbPList;
+	    hashLists.append(list);
+	    hashDict->enter(hashKey, list);
+	}
+
+	for (int i = 0; i < list->getLength(); i++) {
+	    if (areSame(node, (SoNode *) (*list)[i])) {
+		canonical = (SoNode *) (*list)[i];
+		break;
+	    }
+	}
+    }
+
+    // If there is none, the node becomes a canonical instance itself,
+    // unless it is a material
+    if (canonical == NULL) {
+	canonical = node;
+	if (node->isOfType(SoMaterial::getClassTypeId())) {
+	    canonical = node->copy();
+	    nodeRefs.append(canonical);
+	}
+	if (list != NULL)
+	    list->append(canonical);
+	numCanonical++;
+    }
+
+    nodeDict->enter((unsigned long) node, canonical);
+
+    return canonical;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Replaces the property nodes of the given shape with their
+// canonical instances.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfInterner::internShape(IfShape *shape)
+{
+#define INTERN_NODE(field, classname)					      \
+    if (shape->field != NULL) {						      \
+	SoNode *c = intern(shape->field);				      \
+	if (c != shape->field) {					      \
+	    c->ref();							      \
+	    shape->field->unref();					      \
+	    shape->field = (classname *) c;				      \
+	}								      \
+    }
+
+#define INTERN_LIST(list)						      \
+    if (shape->list != NULL) {						      \
+	for (i = 0; i < shape->list->getLength(); i++) {		      \
+	    SoNode *c = intern((*shape->list)[i]);			      \
+	    if (c != (*shape->list)[i])					      \
+		shape->list->set(i, c);					      \
+	}								      \
+    }
+
+    int i;
+
+    INTERN_NODE(camera,			SoCamera);
+    INTERN_LIST(lights);
+    INTERN_LIST(clipPlanes);
+    INTERN_NODE(environment,		SoEnvironment);
+    INTERN_NODE(lightModel,		SoLightModel);
+    INTERN_NODE(texture,		SoTexture2);
+    INTERN_NODE(drawStyle,		SoDrawStyle);
+    INTERN_NODE(shapeHints,		SoShapeHints);
+    INTERN_NODE(material,		SoMaterial);
+    INTERN_LIST(other);
+    INTERN_NODE(complexity,		SoComplexity);
+    INTERN_NODE(font,			SoFont);
+    INTERN_NODE(materialBinding,	SoMaterialBinding);
+    INTERN_NODE(normalBinding,		SoNormalBinding);
+    INTERN_NODE(texCoordBinding,	SoTextureCoordinateBinding);
+    INTERN_LIST(textureTransforms);
+
+#undef INTERN_NODE
+#undef INTERN_LIST
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if the node can be interned. Its type has to be one
+// whose effect depends only on its field values, and those values
+// must not come from connections or be ignored.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfInterner::canIntern(SoNode *node)
+{
+    if (! IfTypes::isInternableType(node->getTypeId()))
+	return FALSE;
+
+    SoFieldList fields;
+    int numFields = node->getFields(fields);
+    for (int i = 0; i < numFields; i++)
+	if (fields[i]->isConnected() || fields[i]->isIgnored())
+	    return FALSE;
+
+    return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Computes a hash key from the type, name, and field values of a
+// node. The field values are hashed in their string form, which is
+// slow but works for all field types. Each node is hashed only once.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// Adds the characters of the given string to a hash key
+static uint32_t
+hashString(uint32_t key, const char *s)
+{
+    // FNV-1a
+    while (*s != '\0') {
+	key ^= (unsigned char) *s++;
+	key *= 16777619;
+    }
+    return key;
+}
+
+uint32_t
+IfInterner::computeHashKey(SoNode *node)
+{
+    uint32_t key = 2166136261U;
+
+    key = hashString(key, node->getTypeId().getName().getString());
+    key = hashString(key, node->getName().getString());
+
+    SoFieldList fields;
+    int numFields = node->getFields(fields);
+    for (int i = 0; i < numFields; i++) {
+	SbString value;
+	fields[i]->get(value);
+	key = hashString(key, value.getString());
+    }
+
+    return key;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if the two nodes have the same type, name, and field
+// values.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfInterner::areSame(SoNode *node1, SoNode *node2)
+{
+    return (node1->getTypeId() == node2->getTypeId() &&
+	    node1->getName()   == node2->getName()   &&
+	    node1->fieldsAreEqual(node2));
+}
@@ -0,0 +1,101 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfInterner class: maps property nodes that have the same type, name,
+// and field values to a single canonical instance of them. This is
+// used by IfCollector so that shapes with equal properties share the
+// same nodes. Those shapes then compare the same without looking at
+// field values, and they end up in the same part of the fixed graph.
+//
+// Nodes are found by a hash of their field values. Each node passed
+// in is also remembered, so it is hashed only once no matter how many
+// shapes it affects.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_INTERNER_
+#define  _IF_INTERNER_
+
+#include <Inventor/SoLists.h>
+
+class IfShape;
+class SbDict;
+
+class IfInterner {
+
+  public:
+    IfInterner();
+    ~IfInterner();
+
+    // Returns the canonical instance of the given node. This is the
+    // node itself if it is the first with its values or if it cannot
+    // be interned (see IfTypes::isInternableType()). The canonical
+    // instance of a material is always a copy, since materials may
+    // be changed later on.
+    SoNode *	intern(SoNode *node);
+
+    // Replaces the property nodes of the given shape (including those
+    // in its lists) with their canonical instances
+    void	internShape(IfShape *shape);
+
+    // Returns the number of distinct nodes passed to intern() and
+    // the number of canonical instances they map to
+    int		getNumNodes() const		{ return numNodes;    }
+    int		getNumCanonical() const		{ return numCanonical; }
+
+  private:
+    SbDict	*nodeDict;	// Maps nodes passed in to canonical nodes
+    SbDict	*hashDict;	// Maps hash keys to SbPLists of canonical
+				// nodes with that key
+    SbPList	hashLists;	// All SbPLists in hashDict, for deleting
+    SoNodeList	nodeRefs;	// Keeps all of the above nodes around
+    int		numNodes;
+    int		numCanonical;
+
+    // Returns TRUE if the node can be interned
+    static SbBool	canIntern(SoNode *node);
+
+    // Computes a hash key from the type, name, and field values
+    static uint32_t	computeHashKey(SoNode *node);
+
+    // Returns TRUE if the two nodes have the same type, name, and
+    // field values
+    static SbBool	areSame(SoNode *node1, SoNode *node2);
+};
+
+#endif /* _IF_INTERNER_ */
@@ -36,7 +36,9 @@
 
 #include <Inventor/nodes/SoMaterial.h>
 #include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
 #include <Inventor/nodes/SoIndexedShape.h>
+#include <Inventor/nodes/SoIndexedTriangleStripSet.h>
 
 #include "IfAssert.h"
 #include "IfShape.h"
@@ -50,6 +52,13 @@
 
 IfMerger::IfMerger()
 {
+    copiedShape		= NULL;
+    indexedBinding	= NULL;
+    maxPromotionBytes	= 4096;
+    numMerged		= 0;
+    numPromoted		= 0;
+    numPromotionBytes	= 0;
+    numRejected		= 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -60,6 +69,8 @@ IfMerger::IfMerger()
 
 IfMerger::~IfMerger()
 {
+    if (indexedBinding != NULL)
+	indexedBinding->unref();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -79,11 +90,15 @@ IfMerger::merge(IfShapeList &shapeList)
     //
     //  - The IfShapes' shape nodes are all indexed shapes
     //
-    //  - The material binding is PER_VERTEX_INDEXED for both shapes
+    //  - The material binding is PER_VERTEX_INDEXED for both shapes,
+    //    or can be promoted to it without adding too many indices
     //
 
     // This is the IfShape to merge into
     IfShape *shape1 = shapeList[0];
+    copiedShape = NULL;
+
+    numMerged = numPromoted = numPromotionBytes = numRejected = 0;
 
     for (int i = 1; i < shapeList.getLength(); i++) {
 	IfShape *shape2 = shapeList[i];
@@ -91,6 +106,7 @@ IfMerger::merge(IfShapeList &shapeList)
 	if (canMergeShapes(shape1, shape2) && mergeShapes(shape1, shape2)) {
 	    shape2->differenceLevel = 0;
 	    shape2->differenceCode  = IfShape::NONE;
+	    numMerged++;
 	}
 	else
 	    shape1 = shape2;
@@ -120,14 +136,12 @@ IfMerger::canMergeShapes(IfShape *shape1, IfShape *shape2)
 	! shape2->shape->isOfType(SoIndexedShape::getClassTypeId()))
 	return FALSE;
 
-    // Have to have PER_VERTEX_INDEXED bindings
-    if (shape1->materialBinding == NULL || shape2->materialBinding == NULL ||
-	shape1->materialBinding->value.getValue() !=
-	SoMaterialBinding::PER_VERTEX_INDEXED ||
-	shape2->materialBinding->value.getValue() != 
-	SoMaterialBinding::PER_VERTEX_INDEXED)
+    // Have to have materials to merge
+    if (shape1->material == NULL || shape2->material == NULL)
 	return FALSE;
 
+    // The bindings are checked by mergeShapes(), since promoting them
+    // depends on the materials being mergeable
     return TRUE;
 }
 
@@ -165,6 +179,16 @@ IfMerger::mergeShapes(IfShape *shape1, IfShape *shape2)
     int case1 = getMaterialCase(m1);
     int case2 = getMaterialCase(m2);
 
+    // A material with 1 value in each field (typical of an OVERALL
+    // binding) fits any of the cases, since appending it keeps the
+    // changing fields the same length
+    if (case1 != case2) {
+	if (isSingleMaterial(m2))
+	    case2 = case1;
+	else if (isSingleMaterial(m1))
+	    case1 = case2;
+    }
+
     // If either is 0 or they're not the same, we can't merge them
     if (case1 == 0 || case1 != case2)
 	return FALSE;
@@ -181,6 +205,39 @@ IfMerger::mergeShapes(IfShape *shape1, IfShape *shape2)
 	    return FALSE;
     }
 
+    // Both shapes have to end up with PER_VERTEX_INDEXED bindings.
+    // Promoting a binding adds a material index per vertex, so do it
+    // only if that costs no more than the draw call that is saved.
+    int cost1 = getPromotionCost(shape1);
+    int cost2 = getPromotionCost(shape2);
+    if (cost1 < 0 || cost2 < 0)
+	return FALSE;
+    if (cost1 + cost2 > maxPromotionBytes) {
+	numRejected++;
+	return FALSE;
+    }
+    if (cost1 > 0) {
+	promoteBinding(shape1);
+	numPromoted++;
+	numPromotionBytes += cost1;
+    }
+    if (cost2 > 0) {
+	promoteBinding(shape2);
+	numPromoted++;
+	numPromotionBytes += cost2;
+    }
+
+    // Materials with the same values are shared by shapes (see
+    // IfInterner), so copy the first shape's material before changing
+    // it, unless that has already been done
+    if (shape1 != copiedShape) {
+	m1 = (SoMaterial *) m1->copy();
+	m1->ref();
+	shape1->material->unref();
+	shape1->material = m1;
+	copiedShape = shape1;
+    }
+
     // Save the original number of values in the first shape's
     // material. This will be the offset into the second shape's
     // materials.
@@ -212,7 +269,7 @@ IfMerger::mergeShapes(IfShape *shape1, IfShape *shape2)
     // Modify IfShape2's shape's material indices
     //
 
-    SoIndexedShape *iShape = (SoIndexedShape *) shape2->shape;
+    SoIndexedShape *iShape = getWritableShape(shape2);
 
     // If the material indices are the same as the coordinate
     // indices, we will have to copy them first
@@ -281,3 +338,181 @@ IfMerger::getMaterialCase(SoMaterial *material)
     // Any other case is case 0 - unmergeable
     return 0;
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if all fields of the material have exactly 1 value.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfMerger::isSingleMaterial(SoMaterial *material)
+{
+    return (material->ambientColor.getNum()  == 1 &&
+	    material->diffuseColor.getNum()  == 1 &&
+	    material->specularColor.getNum() == 1 &&
+	    material->emissiveColor.getNum() == 1 &&
+	    material->shininess.getNum()     == 1 &&
+	    material->transparency.getNum()  == 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the number of bytes of material indices that have to be
+// added to promote the shape's material binding to
+// PER_VERTEX_INDEXED. Returns 0 if the binding is already
+// PER_VERTEX_INDEXED and -1 if it can't be promoted.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfMerger::getPromotionCost(IfShape *shape)
+{
+    // No binding node means the default, OVERALL
+    int binding = (shape->materialBinding == NULL ?
+		   SoMaterialBinding::OVERALL :
+		   shape->materialBinding->value.getValue());
+
+    if (binding == SoMaterialBinding::PER_VERTEX_INDEXED)
+	return 0;
+
+    // Only face sets and triangle strip sets are promoted; their
+    // parts and faces are easy to find in the coordinate indices
+    SbBool isStripSet =
+	shape->shape->isOfType(SoIndexedTriangleStripSet::getClassTypeId());
+    if (! isStripSet &&
+	! shape->shape->isOfType(SoIndexedFaceSet::getClassTypeId()))
+	return -1;
+
+    // A strip can't have a different material for each triangle if
+    // the materials are bound to vertices
+    if (isStripSet &&
+	(binding == SoMaterialBinding::PER_FACE ||
+	 binding == SoMaterialBinding::PER_FACE_INDEXED))
+	return -1;
+
+    SoIndexedShape *iShape = (SoIndexedShape *) shape->shape;
+    int num = iShape->coordIndex.getNum();
+
+    // Indexed per-part or per-face bindings need an index for each
+    // face or strip, unless the indices are left at the default, which
+    // uses material i for part i
+    if ((binding == SoMaterialBinding::PER_PART_INDEXED ||
+	 binding == SoMaterialBinding::PER_FACE_INDEXED) &&
+	! (iShape->materialIndex.getNum() == 1 &&
+	   iShape->materialIndex[0] == -1)) {
+	const int32_t *c = iShape->coordIndex.getValues(0);
+	int numParts = 0;
+	for (int i = 0; i < num; i++)
+	    if (c[i] >= 0 && (i == num - 1 || c[i+1] < 0))
+		numParts++;
+	if (iShape->materialIndex.getNum() < numParts)
+	    return -1;
+    }
+
+    return num * (int) sizeof(int32_t);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Promotes the shape's material binding to PER_VERTEX_INDEXED,
+// creating material indices that bind the same materials as the
+// original binding. getPromotionCost() must have returned a positive
+// value for the shape.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfMerger::promoteBinding(IfShape *shape)
+{
+    int binding = (shape->materialBinding == NULL ?
+		   SoMaterialBinding::OVERALL :
+		   shape->materialBinding->value.getValue());
+
+    SoIndexedShape *iShape = getWritableShape(shape);
+
+    int num = iShape->coordIndex.getNum();
+    const int32_t *c = iShape->coordIndex.getValues(0);
+
+    // Copy the old indices, since they are about to be replaced. If
+    // they are left at the default, indexed per-part and per-face
+    // bindings use material i for part i, as Inventor does.
+    int numOld = iShape->materialIndex.getNum();
+    SbBool defaultIndices = (numOld == 1 && iShape->materialIndex[0] == -1);
+    int32_t *oldIndices = new int32_t[numOld];
+    for (int j = 0; j < numOld; j++)
+	oldIndices[j] = iShape->materialIndex[j];
+
+    iShape->materialIndex.setNum(num);
+    int32_t *m = iShape->materialIndex.startEditing();
+
+    int part = 0, vert = 0;
+    for (int i = 0; i < num; i++) {
+
+	if (c[i] < 0) {
+	    m[i] = c[i];
+	    continue;
+	}
+
+	switch (binding) {
+	  case SoMaterialBinding::PER_PART:
+	  case SoMaterialBinding::PER_FACE:
+	    m[i] = part;
+	    break;
+
+	  case SoMaterialBinding::PER_PART_INDEXED:
+	  case SoMaterialBinding::PER_FACE_INDEXED:
+	    m[i] = (defaultIndices ? part : oldIndices[part]);
+	    break;
+
+	  case SoMaterialBinding::PER_VERTEX:
+	    m[i] = vert;
+	    break;
+
+	  default:
+	    m[i] = 0;
+	    break;
+	}
+
+	// The last vertex of a face or strip ends the part
+	if (i == num - 1 || c[i+1] < 0)
+	    part++;
+	vert++;
+    }
+
+    iShape->materialIndex.finishEditing();
+    delete [] oldIndices;
+
+    // All promoted shapes can share the same binding node
+    if (indexedBinding == NULL) {
+	indexedBinding = new SoMaterialBinding;
+	indexedBinding->ref();
+	indexedBinding->value = SoMaterialBinding::PER_VERTEX_INDEXED;
+    }
+    indexedBinding->ref();
+    if (shape->materialBinding != NULL)
+	shape->materialBinding->unref();
+    shape->materialBinding = indexedBinding;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the shape's indexed shape node. The same node may be used
+// by several shapes with different materials (through instancing),
+// so if anything else refers to it, it is replaced with a copy
+// before it is changed.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoIndexedShape *
+IfMerger::getWritableShape(IfShape *shape)
+{
+    if (shape->shape->getRefCount() > 1) {
+	SoNode *shapeCopy = shape->shape->copy();
+	shapeCopy->ref();
+	shape->shape->unref();
+	shape->shape = shapeCopy;
+    }
+
+    return (SoIndexedShape *) shape->shape;
+}
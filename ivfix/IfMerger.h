@@ -47,7 +47,9 @@
 #include "IfShapeList.h"
 
 class IfShape;
+class SoIndexedShape;
 class SoMaterial;
+class SoMaterialBinding;
 
 class IfMerger {
 
@@ -57,7 +59,38 @@ class IfMerger {
 
     void		merge(IfShapeList &shapeList);
 
+    // Shapes whose material binding is not PER_VERTEX_INDEXED can be
+    // merged only after their bindings are promoted to it, which
+    // requires a material index per vertex. This sets the largest
+    // number of bytes of new material indices that may be added to
+    // save one shape (and therefore one draw call). A value of 0
+    // disables promotion. The default is 4096.
+    void		setMaxPromotionBytes(int bytes)
+	{ maxPromotionBytes = bytes; }
+
+    // These return the results of the last merge: the number of
+    // shapes merged into others, how many shapes had their bindings
+    // promoted, the number of bytes of material indices that added,
+    // and the number of merges rejected as too costly
+    int			getNumMerged() const	{ return numMerged; }
+    int			getNumPromoted() const	{ return numPromoted; }
+    int			getNumPromotionBytes() const { return numPromotionBytes; }
+    int			getNumRejected() const	{ return numRejected; }
+
   private:
+    // The shape whose material has been copied so that other shapes'
+    // materials can be appended to it
+    IfShape		*copiedShape;
+
+    // Binding node shared by all shapes whose bindings are promoted
+    SoMaterialBinding	*indexedBinding;
+
+    int			maxPromotionBytes;
+    int			numMerged;
+    int			numPromoted;
+    int			numPromotionBytes;
+    int			numRejected;
+
     // Returns TRUE if shape2 can probably be merged into shape1
     static SbBool	canMergeShapes(IfShape *shape1, IfShape *shape2);
 
@@ -66,6 +99,24 @@ class IfMerger {
 
     // Determines which material case (0 - 3) is true for a material
     static int		getMaterialCase(SoMaterial *material);
+
+    // Returns TRUE if all fields of the material have 1 value
+    static SbBool	isSingleMaterial(SoMaterial *material);
+
+    // Returns the number of bytes of material indices that have to be
+    // added to promote the shape's material binding to
+    // PER_VERTEX_INDEXED: 0 if it already has that binding, -1 if it
+    // can't be promoted
+    static int		getPromotionCost(IfShape *shape);
+
+    // Promotes the shape's material binding to PER_VERTEX_INDEXED,
+    // creating the material indices that give the same result
+    void		promoteBinding(IfShape *shape);
+
+    // Returns the shape's indexed shape node, replacing it with a
+    // copy first if it is used by other shapes, since it is about to
+    // be changed
+    static SoIndexedShape *	getWritableShape(IfShape *shape);
 };
 
 #endif /* _IF_MERGER_ */
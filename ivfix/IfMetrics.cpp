@@ -0,0 +1,257 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <new>
+#include <stdlib.h>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+#include <Inventor/SbTime.h>
+
+#include "IfMetrics.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// When IF_COUNT_ALLOCS is defined, allocations are counted by
+// replacing the global operator new. That affects every allocation in
+// the program, including Coin's, so it is left out of normal builds.
+// The process-wide count is atomic, since several threads may be
+// flattening at once; each thread also keeps its own count.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifdef IF_COUNT_ALLOCS
+
+static std::atomic<long>	numProcessAllocs(0);
+static thread_local long	numThreadAllocs = 0;
+
+void *
+operator new(size_t size)
+{
+    numProcessAllocs.fetch_add(1, std::memory_order_relaxed);
+    numThreadAllocs++;
+
+    void *p = malloc(size > 0 ? size : 1);
+    if (p == NULL)
+	throw std::bad_alloc();
+    return p;
+}
+
+void
+operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void
+operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+#endif /* IF_COUNT_ALLOCS */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfMetrics::IfMetrics()
+{
+    wallTime	= 0.0;
+    cpuTime	= 0.0;
+    peakRSS	= 0;
+    numAllocs	= 0;
+    threadOnly	= FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Starts measuring. The current values are stored in the results, so
+// that finish() can replace them with the differences.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfMetrics::start(SbBool _threadOnly)
+{
+    threadOnly	= _threadOnly;
+    wallTime	= SbTime::getTimeOfDay().getValue();
+    cpuTime	= getCPUTime(threadOnly);
+    peakRSS	= 0;
+    numAllocs	= getNumAllocs(threadOnly);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Finishes measuring, storing the results.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfMetrics::finish()
+{
+    wallTime	= SbTime::getTimeOfDay().getValue() - wallTime;
+    cpuTime	= getCPUTime(threadOnly) - cpuTime;
+    peakRSS	= getPeakRSS();
+    numAllocs	= getNumAllocs(threadOnly) - numAllocs;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Adds the results of another measurement to these.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfMetrics::add(const IfMetrics &metrics)
+{
+    wallTime  += metrics.wallTime;
+    cpuTime   += metrics.cpuTime;
+    numAllocs += metrics.numAllocs;
+    if (metrics.peakRSS > peakRSS)
+	peakRSS = metrics.peakRSS;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Writes the results as a JSON object. The number of allocations is
+// null if they are not counted.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfMetrics::writeJSON(FILE *fp) const
+{
+    fprintf(fp, "{ \"wallSeconds\": %.6f, \"cpuSeconds\": %.6f, "
+	    "\"peakRSSBytes\": %lu, ",
+	    wallTime, cpuTime, (unsigned long) peakRSS);
+#ifdef IF_COUNT_ALLOCS
+    fprintf(fp, "\"allocations\": %ld }", numAllocs);
+#else
+    fprintf(fp, "\"allocations\": null }");
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the CPU time (user plus system) used by the process or the
+// calling thread, in seconds.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+double
+IfMetrics::getCPUTime(SbBool threadOnly)
+{
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (threadOnly)
+	GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime,
+		       &kernelTime, &userTime);
+    else
+	GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime,
+			&kernelTime, &userTime);
+
+    // FILETIMEs are in units of 100 nanoseconds
+    ULARGE_INTEGER k, u;
+    k.LowPart  = kernelTime.dwLowDateTime;
+    k.HighPart = kernelTime.dwHighDateTime;
+    u.LowPart  = userTime.dwLowDateTime;
+    u.HighPart = userTime.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) * 1.0e-7;
+#else
+    struct timespec ts;
+    clock_gettime(threadOnly ? CLOCK_THREAD_CPUTIME_ID :
+		  CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the peak resident memory (working set) of the process, in
+// bytes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+size_t
+IfMetrics::getPeakRSS()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (! GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+	return 0;
+    return pmc.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+	return 0;
+#ifdef __APPLE__
+    // This is in bytes on Mac OS X...
+    return (size_t) usage.ru_maxrss;
+#else
+    // ... and in kilobytes elsewhere
+    return (size_t) usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the number of allocations made by the process or the
+// calling thread.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+long
+IfMetrics::getNumAllocs(SbBool threadOnly)
+{
+#ifdef IF_COUNT_ALLOCS
+    if (threadOnly)
+	return numThreadAllocs;
+    return numProcessAllocs.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,99 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfMetrics class: measures the cost of a stage of processing: the
+// wall-clock and CPU time it takes, the number of allocations it makes
+// with operator new, and the peak resident memory of the process when
+// it is done. A measurement can be limited to the calling thread, which
+// is how the subgraphs flattened on worker threads are measured.
+//
+// Allocations are counted only when this is compiled with
+// IF_COUNT_ALLOCS defined, since that replaces the global operator new
+// for the whole program. Otherwise the count is always 0.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_METRICS_
+#define  _IF_METRICS_
+
+#include <stdio.h>
+#include <Inventor/SbBasic.h>
+
+class IfMetrics {
+
+  public:
+    IfMetrics();
+
+    // Starts measuring. If threadOnly is TRUE, only the CPU time and
+    // allocations of the calling thread are counted.
+    void		start(SbBool threadOnly = FALSE);
+
+    // Finishes measuring, storing the results. This has to be called
+    // from the same thread as start().
+    void		finish();
+
+    // Adds the results of another measurement to these. Times and
+    // allocations are summed; the peak memory is the larger one.
+    void		add(const IfMetrics &metrics);
+
+    // Writes the results as a JSON object
+    void		writeJSON(FILE *fp) const;
+
+    // The results
+    double		wallTime;	// Seconds
+    double		cpuTime;	// Seconds
+    size_t		peakRSS;	// Bytes
+    long		numAllocs;	// 0 unless IF_COUNT_ALLOCS
+
+    // Returns the peak resident memory of the process so far. This
+    // only ever rises, so compare it with an earlier value to see
+    // what a piece of work added.
+    static size_t	getPeakRSS();
+
+  private:
+    SbBool		threadOnly;
+
+    // Returns the CPU time used by the process or calling thread
+    static double	getCPUTime(SbBool threadOnly);
+
+    // Returns the number of allocations made by the process or
+    // calling thread
+    static long		getNumAllocs(SbBool threadOnly);
+};
+
+#endif /* _IF_METRICS_ */
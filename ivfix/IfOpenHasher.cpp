@@ -0,0 +1,274 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <new>
+
+#include <Inventor/fields/SoMFVec2f.h>
+#include <Inventor/fields/SoMFVec3f.h>
+
+#include "IfAssert.h"
+#include "IfOpenHasher.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructors for 2- or 3-dimensional vectors.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfOpenHasher::IfOpenHasher(SoMFVec2f *field, int maxNumVectors)
+{
+    dimension = 2;
+
+    field2 = field;
+    field3 = NULL;
+
+    maxNum = maxNumVectors;
+
+    commonConstructor();
+}
+
+IfOpenHasher::IfOpenHasher(SoMFVec3f *field, int maxNumVectors)
+{
+    dimension = 3;
+
+    field2 = NULL;
+    field3 = field;
+
+    maxNum = maxNumVectors;
+
+    commonConstructor();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Stuff common to both constructors.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfOpenHasher::commonConstructor()
+{
+    // Make room in the field and begin editing
+    if (dimension == 2) {
+	field2->setNum(maxNum);
+	vectors2 = field2->startEditing();
+	vectors3 = NULL;
+    }
+    else {
+	field3->setNum(maxNum);
+	vectors3 = field3->startEditing();
+	vectors2 = NULL;
+    }
+
+    // Make the table a power of 2 at least twice as big as the
+    // maximum number of vectors, so it is never more than half full
+    // and probe sequences stay short. This is worked out in 64 bits,
+    // since twice the maximum may not fit in 32. The size is held to
+    // 2^31, which still leaves an empty slot after the most vectors
+    // an int can count. A table too big to address cannot be made.
+    ASSERT(maxNum >= 0);
+    uint64_t size = 16;
+    while (size < (uint64_t) maxNum * 2 && size < ((uint64_t) 1 << 31))
+	size <<= 1;
+    if (size > SIZE_MAX / sizeof(Slot))
+	throw std::bad_alloc();
+    mask = (uint32_t) (size - 1);
+
+    slots = new Slot[(size_t) size];
+    for (uint64_t i = 0; i < size; i++)
+	slots[i].index = -1;
+
+    curIndex = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfOpenHasher::~IfOpenHasher()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// These add a vector to the list, returning its index.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfOpenHasher::addVector(const SbVec2f &newVector)
+{
+    ASSERT(slots != NULL);
+    ASSERT(dimension == 2);
+
+    // See if we need to add this one, or is it already there
+    int index;
+    SbBool notThere = addIfNotThere(newVector.getValue(), index);
+
+    // If it's not there, we need to add it to the field
+    if (notThere)
+	vectors2[index] = newVector;
+
+    return index;
+}
+
+int
+IfOpenHasher::addVector(const SbVec3f &newVector)
+{
+    ASSERT(slots != NULL);
+    ASSERT(dimension == 3);
+
+    // See if we need to add this one, or is it already there
+    int index;
+    SbBool notThere = addIfNotThere(newVector.getValue(), index);
+
+    // If it's not there, we need to add it to the field
+    if (notThere)
+	vectors3[index] = newVector;
+
+    return index;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Adds the given vector to the hash table, if it is not already
+// there. Returns TRUE if the vector was added.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfOpenHasher::addIfNotThere(const float *newVector, int &index)
+{
+    ASSERT(curIndex < maxNum);
+
+    uint32_t hash = hashVector(newVector);
+
+    // Probe linearly from the home slot until we find a match or an
+    // empty slot. The table is never full, so this terminates.
+    uint32_t s;
+    for (s = hash & mask; slots[s].index >= 0; s = (s + 1) & mask) {
+	if (slots[s].hash == hash && sameVector(newVector, slots[s].index)) {
+	    index = slots[s].index;
+	    return FALSE;
+	}
+    }
+
+    slots[s].hash  = hash;
+    slots[s].index = curIndex;
+
+    index = curIndex++;
+    return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Hash function for finding duplicate vectors. This mixes the bit
+// patterns of the components. Since equal vectors must hash the same,
+// -0 is treated as 0.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+IfOpenHasher::hashVector(const float *v) const
+{
+    uint32_t h = 0x9e3779b9;
+
+    for (int i = 0; i < dimension; i++) {
+	uint32_t bits;
+	memcpy(&bits, &v[i], sizeof(bits));
+	if (bits == 0x80000000)
+	    bits = 0;
+
+	// Combine and scramble (the finalizer from MurmurHash3)
+	h ^= bits;
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+    }
+
+    return h;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if the given vector matches the given existing vector.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfOpenHasher::sameVector(const float *vector, int index) const
+{
+    if (dimension == 2)
+	return (vector[0] == vectors2[index][0] &&
+		vector[1] == vectors2[index][1]);
+    else
+	return (vector[0] == vectors3[index][0] &&
+		vector[1] == vectors3[index][1] &&
+		vector[2] == vectors3[index][2]);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Finishes up.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfOpenHasher::finish()
+{
+    // Stop editing and set the field to contain the correct number of
+    // values
+    if (dimension == 2) {
+	field2->finishEditing();
+	field2->setNum(curIndex);
+    }
+    else {
+	field3->finishEditing();
+	field3->setNum(curIndex);
+    }
+
+    // Get rid of the table
+    delete [] slots;
+
+    // Make sure nobody uses this again
+    slots = NULL;
+}
@@ -0,0 +1,114 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfOpenHasher class: does the same job as IfHasher, maintaining a
+// list of unique 2- or 3-dimensional vectors, but stores the indices
+// of the vectors in a flat open-addressing hash table keyed on the bit
+// patterns of the vector components. This avoids the pointer chasing
+// of the chained SbDict lists and gives a good spread of keys for all
+// kinds of data, so it is used by IfCondenser.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_OPEN_HASHER_
+#define  _IF_OPEN_HASHER_
+
+#include <Inventor/SbLinear.h>
+
+class SoMFVec2f;
+class SoMFVec3f;
+
+class IfOpenHasher {
+
+  public:
+    // There is a constructor for each dimension. Each takes a field
+    // of the correct type in which to store the results and the
+    // maximum number of vectors to be added, which is used to size
+    // the table so it never has to grow. Note that nobody else should
+    // modify or access the passed field while the IfOpenHasher
+    // instance is active, until finish() is called.
+    IfOpenHasher(SoMFVec2f *field, int maxNumVectors);
+    IfOpenHasher(SoMFVec3f *field, int maxNumVectors);
+
+    // Destructor
+    ~IfOpenHasher();
+
+    // These add a vector to the field, or re-use an existing value in
+    // it. The index of the value (new or old) is returned. Vectors
+    // are considered the same if all their components compare equal,
+    // so 0 and -0 are merged and vectors containing NaN never are.
+    int			addVector(const SbVec2f &newVector);
+    int			addVector(const SbVec3f &newVector);
+
+    // Finishes up
+    void		finish();
+
+  private:
+    // One of these is stored in each slot of the table. The hash is
+    // kept so most non-matching slots can be skipped without looking
+    // at the vectors themselves. An index of -1 marks an empty slot.
+    struct Slot {
+	uint32_t	hash;
+	int32_t		index;
+    };
+
+    int			dimension;	// Dimension of vectors (2 or 3)
+    SoMFVec2f		*field2;	// Given field
+    SoMFVec3f		*field3;	// Given field
+    SbVec2f		*vectors2;	// Pointer into field values 
+    SbVec3f		*vectors3;	// Pointer into field values 
+    int			maxNum;		// Max number of vectors
+    Slot		*slots;		// The hash table
+    uint32_t		mask;		// Table size - 1 (size is 2^n)
+    int			curIndex;	// Next index to use
+
+    // Stuff common to both constructors
+    void		commonConstructor();
+
+    // Adds the given vector to the hash table, if it is not already
+    // there. Returns TRUE if the vector was added.
+    SbBool		addIfNotThere(const float *newVector, int &index);
+
+    // Hash function for finding duplicate vectors
+    uint32_t		hashVector(const float *v) const;
+
+    // Returns TRUE if the given vector matches the given existing vector
+    SbBool		sameVector(const float *vector, int index) const;
+};
+
+#endif /* _IF_OPEN_HASHER_ */
@@ -0,0 +1,360 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <algorithm>
+
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedShape.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+#include <Inventor/nodes/SoTextureCoordinateBinding.h>
+
+#include "IfAssert.h"
+#include "IfHolder.h"
+#include "IfPartitioner.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// This is used with std::nth_element() to order triangles (given by
+// their indices) by one coordinate of their centroids. Ties are broken
+// by index so that the chunks do not depend on the library.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+struct IfPartitionerCentroidLess {
+    const SbVec3f	*centroids;
+    int			axis;
+
+    bool	operator ()(int t1, int t2) const
+	{
+	    float c1 = centroids[t1][axis], c2 = centroids[t2][axis];
+	    return (c1 < c2 || (c1 == c2 && t1 < t2));
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfPartitioner::IfPartitioner()
+{
+    maxTris   = 4096;
+    numTris   = 0;
+    centroids = NULL;
+    order     = NULL;
+    indexMap  = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfPartitioner::~IfPartitioner()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Splits the triangles in the holder into chunks. Returns the number
+// of chunks and a new array of holders for them, or 0 if the
+// triangles fit in one chunk.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfPartitioner::partition(IfHolder *holder, IfHolder **&chunks)
+{
+    ASSERT(holder->triSet->coordIndex.getNum() % 4 == 0);
+    numTris = holder->triSet->coordIndex.getNum() / 4;
+
+    if (maxTris < 1 || numTris <= maxTris)
+	return 0;
+
+    // Compute the centroid of each triangle
+    const int32_t *coordIndices = holder->triSet->coordIndex.getValues(0);
+    const SbVec3f *coords = holder->coords->point.getValues(0);
+    centroids = new SbVec3f[numTris];
+    order     = new int[numTris];
+    int i;
+    for (i = 0; i < numTris; i++) {
+	const int32_t *tri = &coordIndices[4 * i];
+	centroids[i] = (coords[tri[0]] + coords[tri[1]] + coords[tri[2]]) / 3.0;
+	order[i] = i;
+    }
+
+    // Split them into chunks, ending with the end of the last one
+    chunkStarts.truncate(0);
+    split(0, numTris);
+    int numChunks = chunkStarts.getLength();
+    chunkStarts.append(numTris);
+
+    // Keep the triangles of each chunk in their original order, which
+    // is coherent for the vertex cache
+    for (i = 0; i < numChunks; i++)
+	std::sort(order + chunkStarts[i], order + chunkStarts[i + 1]);
+
+    // The index map has to be big enough for any of the indexed fields
+    int mapSize = holder->coords->point.getNum();
+    if (holder->doNormals && holder->normals->vector.getNum() > mapSize)
+	mapSize = holder->normals->vector.getNum();
+    if (holder->doTexCoords && holder->texCoords->point.getNum() > mapSize)
+	mapSize = holder->texCoords->point.getNum();
+    indexMap = new int[mapSize];
+    for (i = 0; i < mapSize; i++)
+	indexMap[i] = -1;
+
+    chunks = new IfHolder *[numChunks];
+    for (i = 0; i < numChunks; i++)
+	chunks[i] = makeChunk(holder, chunkStarts[i], chunkStarts[i + 1]);
+
+    delete [] centroids;
+    delete [] order;
+    delete [] indexMap;
+    centroids = NULL;
+    order     = NULL;
+    indexMap  = NULL;
+
+    return numChunks;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Splits the triangles in order[start..end) in half at the median of
+// their centroids along the longest axis of the centroids' bounding
+// box, until each half is small enough to be a chunk.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfPartitioner::split(int start, int end)
+{
+    if (end - start <= maxTris) {
+	chunkStarts.append(start);
+	return;
+    }
+
+    SbVec3f min = centroids[order[start]], max = min;
+    int i, j;
+    for (i = start + 1; i < end; i++) {
+	const SbVec3f &c = centroids[order[i]];
+	for (j = 0; j < 3; j++) {
+	    if (c[j] < min[j])
+		min[j] = c[j];
+	    else if (c[j] > max[j])
+		max[j] = c[j];
+	}
+    }
+
+    IfPartitionerCentroidLess centroidLess;
+    centroidLess.centroids = centroids;
+    centroidLess.axis = 0;
+    for (j = 1; j < 3; j++)
+	if (max[j] - min[j] > max[centroidLess.axis] - min[centroidLess.axis])
+	    centroidLess.axis = j;
+
+    int mid = start + (end - start) / 2;
+    std::nth_element(order + start, order + mid, order + end, centroidLess);
+
+    split(start, mid);
+    split(mid, end);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a holder for the triangles in order[start..end). Its
+// coordinates, normals, and texture coordinates are the ones used by
+// the triangles, in order of first use. The materials are shared by
+// all chunks, so they are all kept and the material indices are
+// copied as they are.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfHolder *
+IfPartitioner::makeChunk(IfHolder *holder, int start, int end)
+{
+    IfHolder *chunk = new IfHolder(holder->origRoot, holder->doStrips,
+				   holder->doNormals, holder->doTexCoords);
+
+    const SoIndexedShape *src = holder->triSet;
+    SoIndexedShape	 *dst = chunk->triSet;
+    const int32_t *coordIndices = src->coordIndex.getValues(0);
+    int numIndices = 4 * (end - start);
+    int *used = new int[numIndices];
+    int i, numUsed;
+
+    // Coordinates
+    dst->coordIndex.setNum(numIndices);
+    numUsed = remapIndices(coordIndices, start, end,
+			   dst->coordIndex.startEditing(), used);
+    dst->coordIndex.finishEditing();
+    const SbVec3f *coords = holder->coords->point.getValues(0);
+    chunk->coords->point.setNum(numUsed);
+    SbVec3f *newCoords = chunk->coords->point.startEditing();
+    for (i = 0; i < numUsed; i++)
+	newCoords[i] = coords[used[i]];
+    chunk->coords->point.finishEditing();
+
+    // Normals. A single index means they share the coordinate indices.
+    if (holder->doNormals) {
+	chunk->normalBinding->value = holder->normalBinding->value;
+	dst->normalIndex.setNum(numIndices);
+	numUsed = remapIndices(src->normalIndex.getNum() > 1 ?
+			       src->normalIndex.getValues(0) : coordIndices,
+			       start, end,
+			       dst->normalIndex.startEditing(), used);
+	dst->normalIndex.finishEditing();
+	const SbVec3f *normals = holder->normals->vector.getValues(0);
+	chunk->normals->vector.setNum(numUsed);
+	SbVec3f *newNormals = chunk->normals->vector.startEditing();
+	for (i = 0; i < numUsed; i++)
+	    newNormals[i] = normals[used[i]];
+	chunk->normals->vector.finishEditing();
+	if (sameIndices(&dst->coordIndex, &dst->normalIndex))
+	    dst->normalIndex = -1;
+    }
+
+    // Texture coordinates, likewise
+    if (holder->doTexCoords) {
+	chunk->texCoordBinding->value = holder->texCoordBinding->value;
+	dst->textureCoordIndex.setNum(numIndices);
+	numUsed = remapIndices(src->textureCoordIndex.getNum() > 1 ?
+			       src->textureCoordIndex.getValues(0) :
+			       coordIndices, start, end,
+			       dst->textureCoordIndex.startEditing(), used);
+	dst->textureCoordIndex.finishEditing();
+	const SbVec2f *texCoords = holder->texCoords->point.getValues(0);
+	chunk->texCoords->point.setNum(numUsed);
+	SbVec2f *newTexCoords = chunk->texCoords->point.startEditing();
+	for (i = 0; i < numUsed; i++)
+	    newTexCoords[i] = texCoords[used[i]];
+	chunk->texCoords->point.finishEditing();
+	if (sameIndices(&dst->coordIndex, &dst->textureCoordIndex))
+	    dst->textureCoordIndex = -1;
+    }
+
+    // Materials. An overall material keeps its single 0 index;
+    // otherwise the indices are copied, from the original coordinate
+    // indices if they were shared with them.
+    chunk->materialBinding->value = holder->materialBinding->value;
+    if (holder->materialBinding->value.getValue() ==
+	SoMaterialBinding::OVERALL)
+	dst->materialIndex = src->materialIndex;
+    else {
+	const int32_t *mtlIndices = (src->materialIndex.getNum() > 1 ?
+				     src->materialIndex.getValues(0) :
+				     coordIndices);
+	dst->materialIndex.setNum(numIndices);
+	int32_t *newMtlIndices = dst->materialIndex.startEditing();
+	for (i = start; i < end; i++) {
+	    const int32_t *tri = &mtlIndices[4 * order[i]];
+	    for (int j = 0; j < 4; j++)
+		*newMtlIndices++ = tri[j];
+	}
+	dst->materialIndex.finishEditing();
+	if (sameIndices(&dst->coordIndex, &dst->materialIndex))
+	    dst->materialIndex = -1;
+    }
+
+    delete [] used;
+
+    return chunk;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Stores the new indices of the triangles in order[start..end),
+// numbering the old indices in order of first use. Returns the number
+// of distinct indices, storing the old ones in used[]. The index map
+// is left all -1 again.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfPartitioner::remapIndices(const int32_t *oldIndices, int start, int end,
+			    int32_t *newIndices, int *used)
+{
+    int numUsed = 0;
+
+    for (int i = start; i < end; i++) {
+	const int32_t *tri = &oldIndices[4 * order[i]];
+	for (int j = 0; j < 3; j++) {
+	    int index = tri[j];
+	    if (indexMap[index] < 0) {
+		indexMap[index] = numUsed;
+		used[numUsed++] = index;
+	    }
+	    *newIndices++ = indexMap[index];
+	}
+	*newIndices++ = -1;
+    }
+
+    for (int k = 0; k < numUsed; k++)
+	indexMap[used[k]] = -1;
+
+    return numUsed;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if the two sets of indices are the same.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfPartitioner::sameIndices(const SoMFInt32 *indexField1,
+			   const SoMFInt32 *indexField2)
+{
+    int num1 = indexField1->getNum();
+    int num2 = indexField2->getNum();
+
+    if (num1 != num2)
+	return FALSE;
+
+    const int32_t *ind1 = indexField1->getValues(0);
+    const int32_t *ind2 = indexField2->getValues(0);
+
+    for (int i = 0; i < num1; i++)
+	if (ind1[i] != ind2[i])
+	    return FALSE;
+
+    return TRUE;
+}
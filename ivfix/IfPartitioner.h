@@ -0,0 +1,105 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfPartitioner class: splits the triangles of a condensed IfHolder
+// into spatially coherent chunks, each in a holder of its own, so that
+// each chunk can be put under its own separator and culled separately
+// when rendering.
+//
+// The chunks are the leaves of a bounding volume hierarchy built over
+// the triangle centroids: a set of triangles larger than the target is
+// split in half at the median along the longest axis of its
+// centroids' bounding box. Each chunk then gets only the coordinates,
+// normals, and texture coordinates its triangles use.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_PARTITIONER_
+#define  _IF_PARTITIONER_
+
+#include <Inventor/SbLinear.h>
+#include <Inventor/lists/SbList.h>
+
+class IfHolder;
+class SoMFInt32;
+
+class IfPartitioner {
+
+  public:
+    IfPartitioner();
+    ~IfPartitioner();
+
+    // Sets the most triangles in each chunk. Chunks have between
+    // half this many and this many triangles. The default is 4096.
+    void		setMaxTriangles(int n)		{ maxTris = n; }
+
+    // Splits the triangles in the holder, which must be as left by
+    // IfCondenser. Returns the number of chunks, and a newly allocated
+    // array of new holders for them, which share the original root of
+    // the given holder. If there are no more triangles than the
+    // maximum, returns 0 and creates nothing.
+    int			partition(IfHolder *holder, IfHolder **&chunks);
+
+  private:
+    int			maxTris;
+    int			numTris;
+    SbVec3f		*centroids;	// Centroid of each triangle
+    int			*order;		// Triangles, grouped by chunk
+    SbList<int>		chunkStarts;	// Where each chunk starts in order
+    int			*indexMap;	// Old index to new index, or -1
+
+    // Splits the triangles in order[start..end) into chunks
+    void		split(int start, int end);
+
+    // Makes a holder for the triangles in order[start..end)
+    IfHolder *		makeChunk(IfHolder *holder, int start, int end);
+
+    // Stores the new indices of the triangles in order[start..end)
+    // for a chunk, numbering the old indices in order of first use.
+    // Returns the number of distinct indices, storing the old ones in
+    // used[].
+    int			remapIndices(const int32_t *oldIndices,
+				     int start, int end,
+				     int32_t *newIndices, int *used);
+
+    // Returns TRUE if the two sets of indices are the same
+    static SbBool	sameIndices(const SoMFInt32 *indexField1,
+				    const SoMFInt32 *indexField2);
+};
+
+#endif /* _IF_PARTITIONER_ */
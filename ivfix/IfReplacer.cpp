@@ -34,7 +34,6 @@
  *
  */
 
-#include <Inventor/actions/SoSearchAction.h>
 #include <Inventor/elements/SoLazyElement.h>
 #include <Inventor/nodes/SoBaseColor.h>
 #include <Inventor/nodes/SoGroup.h>
@@ -42,6 +41,7 @@
 #include <Inventor/nodes/SoPackedColor.h>
 
 #include "IfAssert.h"
+#include "IfInterner.h"
 #include "IfReplacer.h"
 
 /////////////////////////////////////////////////////////////////////////////
@@ -52,6 +52,9 @@
 
 IfReplacer::IfReplacer()
 {
+    interner	 = NULL;
+    numReplaced	 = 0;
+    numMaterials = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -75,89 +78,96 @@ IfReplacer::replace(SoNode *sceneRoot)
 {
     // Replace all SoBaseColor and SoPackedColor nodes with SoMaterial
     // nodes, which are easier to deal with
-    replaceMaterials(sceneRoot,   SoBaseColor::getClassTypeId());
-    replaceMaterials(sceneRoot, SoPackedColor::getClassTypeId());
+    replaceMaterials(sceneRoot);
 }
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Replaces all nodes of the given type with SoMaterial nodes.
+// Replaces all SoBaseColor and SoPackedColor nodes with SoMaterial
+// nodes. A single SoCallbackAction finds the nodes and computes the
+// material in effect after each one. Materials with the same values
+// are replaced by one instance (see IfInterner), so the nodes they
+// replace end up sharing it.
 //
 /////////////////////////////////////////////////////////////////////////////
 
 void
-IfReplacer::replaceMaterials(SoNode *sceneRoot, const SoType &typeToReplace)
+IfReplacer::replaceMaterials(SoNode *sceneRoot)
 {
-    // Find all nodes of the given type
-    SoSearchAction sa;
-    sa.setType(typeToReplace);
-    sa.setInterest(SoSearchAction::ALL);
-    sa.apply(sceneRoot);
-
-    // Replace the tail of each path with a material. To do this, we
-    // need to apply an SoCallbackAction to the path to gather the
-    // material components.
-    for (int i = 0; i < sa.getPaths().getLength(); i++) {
-
-	// Cast the path to a full path, just in case
-	SoFullPath *path = (SoFullPath *) sa.getPaths()[i];
-	ASSERT(path->getTail()->isOfType(typeToReplace));
-
-	// The path better have at least one group above the material
-	if (path->getLength() < 2 ||
-	    ! path->getNodeFromTail(1)->isOfType(SoGroup::getClassTypeId()))
-	    continue;
-
-	// Create a material node that represents the material in
-	// effect at the tail of the path
-	SoMaterial *newMaterial = createMaterialForPath(path);
-	newMaterial->ref();
-	
-	// Replace the tail node with that material
-	SoGroup *parent = (SoGroup *) path->getNodeFromTail(1);
-	parent->replaceChild(path->getTail(), newMaterial);
-	       
-	newMaterial->unref();
+    interner = new IfInterner;
+
+    SoCallbackAction cba;
+    cba.addPostCallback(SoBaseColor::getClassTypeId(),   colorCB, this);
+    cba.addPostCallback(SoPackedColor::getClassTypeId(), colorCB, this);
+    cba.apply(sceneRoot);
+
+    numMaterials = interner->getNumCanonical();
+    delete interner;
+    interner = NULL;
+
+    // Replace each node with its material. If the parent is
+    // instanced, the node is found once for each instance; only the
+    // first one is replaced.
+    numReplaced = 0;
+    for (int i = 0; i < parents.getLength(); i++) {
+	SoGroup *parent = (SoGroup *) parents[i];
+	int index = childIndices[i];
+	if (parent->getChild(index) == oldNodes[i]) {
+	    parent->replaceChild(index, newMaterials[i]);
+	    numReplaced++;
+	}
     }
+
+    parents.truncate(0);
+    childIndices.truncate(0);
+    oldNodes.truncate(0);
+    newMaterials.truncate(0);
 }
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Creates and returns a material node that represents the material in
-// effect at the tail of the given path.
+// Saves the node at the tail of the current path, to be replaced
+// with a material that represents the material in effect after it.
 //
 /////////////////////////////////////////////////////////////////////////////
 
-SoMaterial *
-IfReplacer::createMaterialForPath(SoPath *path)
+void
+IfReplacer::storeColor(SoCallbackAction *cba, SoNode *node)
 {
-    material = NULL;
-
-    // Apply an SoCallbackAction to the path, and create the material
-    // after we get to the tail node
-    SoCallbackAction cba;
-    cba.addPostTailCallback(materialTailCB, this);
-    cba.apply(path);
-
-    ASSERT(material != NULL);
-
-    return material;
+    // Cast the path to a full path, just in case
+    const SoFullPath *path = (const SoFullPath *) cba->getCurPath();
+    ASSERT(path->getTail() == node);
+
+    // The path better have at least one group above the material
+    if (path->getLength() < 2 ||
+	! path->getNodeFromTail(1)->isOfType(SoGroup::getClassTypeId()))
+	return;
+
+    // Create the material, using an equal one if there is one
+    SoMaterial *newMaterial =
+	(SoMaterial *) interner->intern(createMaterial(cba));
+
+    parents.append(path->getNodeFromTail(1));
+    childIndices.append(path->getIndexFromTail(0));
+    oldNodes.append(node);
+    newMaterials.append(newMaterial);
 }
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Stores a material created during traversal of a path.
+// Creates and returns a material node that represents the material
+// in effect in the action's state.
 //
 /////////////////////////////////////////////////////////////////////////////
 
-void
-IfReplacer::storeMaterial(SoCallbackAction *cba)
+SoMaterial *
+IfReplacer::createMaterial(SoCallbackAction *cba)
 {
     // Create a new material
-    material = new SoMaterial;
+    SoMaterial *material = new SoMaterial;
 
     // Copy the values from the elements in the state into the
-
+    // material
     SoState *state = cba->getState();
     SoLazyElement *elt = SoLazyElement::getInstance(cba->getState());
 
@@ -201,4 +211,6 @@ IfReplacer::storeMaterial(SoCallbackAction *cba)
 	    trans[i] = eltTrans[i];
 	material->transparency.finishEditing();
     }
+
+    return material;
 }
@@ -44,11 +44,13 @@
 #ifndef  _IF_REPLACER_
 #define  _IF_REPLACER_
 
+#include <Inventor/SoLists.h>
+#include <Inventor/lists/SbList.h>
 #include <Inventor/actions/SoCallbackAction.h>
 
+class IfInterner;
 class SoMaterial;
 class SoNode;
-class SoPath;
 
 class IfReplacer {
 
@@ -59,25 +61,43 @@ class IfReplacer {
     // Replaces nodes in the given scene, in place
     void	replace(SoNode *sceneRoot);
 
+    // Returns the number of nodes replaced by materials and the
+    // number of distinct materials that replaced them
+    int		getNumReplaced() const		{ return numReplaced; }
+    int		getNumMaterials() const		{ return numMaterials; }
+
   private:
-    SoMaterial	*material;		// Replacement material
+    IfInterner	*interner;		// Finds equal new materials
 
-    // Replaces all nodes of the given type with SoMaterial nodes
-    void	replaceMaterials(SoNode *sceneRoot,
-				 const SoType &typeToReplace);
+    // Nodes to replace, found during traversal. The graph can't be
+    // changed until traversal is done, so for each node we save its
+    // parent, its index in the parent, and the material to replace
+    // it with.
+    SoNodeList	parents;
+    SbList<int>	childIndices;
+    SoNodeList	oldNodes;
+    SoNodeList	newMaterials;
 
-    // Creates and returns a material node that represents the
-    // material in effect at the tail of the given path.
-    SoMaterial * createMaterialForPath(SoPath *path);
+    int		numReplaced;
+    int		numMaterials;
+
+    // Replaces all SoBaseColor and SoPackedColor nodes with SoMaterial
+    // nodes
+    void	replaceMaterials(SoNode *sceneRoot);
 
-    // Stores a material created during traversal of a path
-    void	storeMaterial(SoCallbackAction *cba);
+    // Saves the node at the tail of the current path along with a
+    // material that represents the material in effect after it
+    void	storeColor(SoCallbackAction *cba, SoNode *node);
+
+    // Creates and returns a material node that represents the
+    // material in effect in the action's state
+    static SoMaterial *	createMaterial(SoCallbackAction *cba);
 
     // Callback
-    static SoCallbackAction::Response materialTailCB(void *userData,
-						     SoCallbackAction *cba,
-						     const SoNode *)
-	{ ((IfReplacer *) userData)->storeMaterial(cba);
+    static SoCallbackAction::Response colorCB(void *userData,
+					      SoCallbackAction *cba,
+					      const SoNode *node)
+	{ ((IfReplacer *) userData)->storeColor(cba, (SoNode *) node);
 	  return SoCallbackAction::CONTINUE; }
 };
 
@@ -34,8 +34,11 @@
  *
  */
 
+#include <string.h>
+
 #include <Inventor/nodes/SoCoordinate3.h>
 #include <Inventor/nodes/SoIndexedTriangleStripSet.h>
+#include <Inventor/nodes/SoLOD.h>
 
 #include "IfHolder.h"
 #include "IfReporter.h"
@@ -46,6 +49,16 @@ FILE   *IfReporter::fp = stderr;
 SbBool	IfReporter::verbose = FALSE;
 SbBool	IfReporter::details = FALSE;
 
+SbList<IfReporter::Stage>	IfReporter::stages;
+SbList<IfReporter::Subgraph>	IfReporter::subgraphs;
+IfReporter::Stage		IfReporter::curStage;
+SbBool				IfReporter::haveCache = FALSE;
+int				IfReporter::cacheHits = 0;
+int				IfReporter::cacheMisses = 0;
+int				IfReporter::cacheStored = 0;
+int				IfReporter::cacheEvicted = 0;
+size_t				IfReporter::cacheBytes = 0;
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // Reports an operation that takes time. "Done" is printed when
@@ -106,32 +119,298 @@ IfReporter::reportHolder(const char *msg, IfHolder *holder)
 	return;
 
     int nc = holder->coords->point.getNum();
-    int ntc = holder->triSet->coordIndex.getNum();
-    const int32_t *ind = holder->triSet->coordIndex.getValues(0);
+    int ns, nt, nv;
+    countHolder(holder, ns, nt, nv);
 
-    // Count strips, triangles, and vertices
+    fprintf(fp,
+	    "   %s: %5d strips, %5d tris, %5d verts, %5d coords\n",
+	    msg, ns, nt, nv, nc);
+}
 
-    int ns = 0, nt = 0, nv = 0;
-    int vertsInStrip = 0;
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the result of checking the single-traversal collector
+// against the path-based one. Since a mismatch is a bug, it is
+// reported even when not verbose.
+//
+/////////////////////////////////////////////////////////////////////////////
 
-    for (int i = 0; i < ntc; i++) {
+void
+IfReporter::reportCollectionCheck(const char *msg, int numShapes,
+				  int numMismatches)
+{
+    if (! verbose && numMismatches == 0)
+	return;
 
-	if (ind[i] < 0) {
-	    if (vertsInStrip > 2)
-		ns++;
-	    vertsInStrip = 0;
-	}
+    fprintf(fp, "%s: %d shapes, %d differ from path-based collection\n",
+	    msg, numShapes, numMismatches);
+}
 
-	else {
-	    nv++;
-	    if (++vertsInStrip > 2)
-		nt++;
-	}
-    }
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the number of property nodes found when collecting and the
+// number left after interning.
+//
+/////////////////////////////////////////////////////////////////////////////
 
-    fprintf(fp,
-	    "   %s: %5d strips, %5d tris, %5d verts, %5d coords\n",
-	    msg, ns, nt, nv, nc);
+void
+IfReporter::reportInterning(const char *msg, int numNodes, int numInterned)
+{
+    if (! verbose)
+	return;
+
+    fprintf(fp, "%s: %d property nodes, %d distinct\n",
+	    msg, numNodes, numInterned);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the results of merging shapes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportMerging(const char *msg, int numMerged, int numPromoted,
+			  int numPromotionBytes, int numRejected)
+{
+    if (! verbose)
+	return;
+
+    fprintf(fp, "%s: %d shapes merged, %d bindings promoted "
+	    "(%d index bytes), %d merges rejected by cost\n",
+	    msg, numMerged, numPromoted, numPromotionBytes, numRejected);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the use of the cache of flattened subgraphs.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportCache(const char *msg, int numHits, int numMisses,
+			int numStored, int numEvicted, size_t numBytes)
+{
+    haveCache    = TRUE;
+    cacheHits    = numHits;
+    cacheMisses  = numMisses;
+    cacheStored  = numStored;
+    cacheEvicted = numEvicted;
+    cacheBytes   = numBytes;
+
+    if (! verbose)
+	return;
+
+    fprintf(fp, "%s: %d hits, %d misses, %d stored, %d evicted "
+	    "(%.1f MB in cache)\n", msg, numHits, numMisses, numStored,
+	    numEvicted, numBytes / (1024.0 * 1024.0));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the results of low-memory mode.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportLowMemory(const char *msg, int numFlattened,
+			    int numSpilled, size_t numBytes)
+{
+    if (! verbose)
+	return;
+
+    fprintf(fp, "%s: %d subgraphs flattened early, %d spilled "
+	    "(%.1f MB)\n", msg, numFlattened, numSpilled,
+	    numBytes / (1024.0 * 1024.0));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports spilled subgraphs that could not be read back.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportRestoreFailure(const char *msg, int numLost,
+				 int numSpilled)
+{
+    fprintf(fp, "%s: %d of %d could not be read back from the "
+	    "temporary file\n", msg, numLost, numSpilled);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the results of weeding material values.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportMaterialWeeding(const char *msg, int numValues,
+				  int numUnique, int numUsed)
+{
+    if (! verbose || numValues == 0)
+	return;
+
+    fprintf(fp, "%s: %d material values, %d unique (%.1f%%), %d kept\n",
+	    msg, numValues, numUnique, 100.0 * numUnique / numValues,
+	    numUsed);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the results of batching shapes for flattening.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportBatching(const char *msg, int numShapes, int numBatches,
+			   int numSplits)
+{
+    if (! verbose)
+	return;
+
+    fprintf(fp, "%s: %d shapes in %d batches "
+	    "(%d started by the vertex budget)\n",
+	    msg, numShapes, numBatches, numSplits);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the results of splitting subgraphs into chunks.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportChunks(const char *msg, int numGroups, int numChunks,
+			 SbBool isDetail)
+{
+    if (! verbose || (isDetail && ! details))
+	return;
+
+    if (isDetail)
+	fprintf(fp, "%s: %d chunks\n", msg, numChunks);
+    else
+	fprintf(fp, "%s: %d subgraphs split into %d chunks\n",
+		msg, numGroups, numChunks);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the results of making levels of detail.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportLevelsOfDetail(const char *msg, int numGroups,
+				 int numLevels, int numTris, int numLevelTris,
+				 SbBool isDetail)
+{
+    if (! verbose || (isDetail && ! details) || numTris == 0)
+	return;
+
+    if (isDetail)
+	fprintf(fp, "%s: %d tris, %d in %d levels (%.1f%%)\n",
+		msg, numTris, numLevelTris, numLevels,
+		100.0 * numLevelTris / numTris);
+    else
+	fprintf(fp, "%s: %d subgraphs given %d levels of detail, "
+		"%d tris, %d in all levels (%.1f%%)\n",
+		msg, numGroups, numLevels, numTris, numLevelTris,
+		100.0 * numLevelTris / numTris);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the results of packing normals and texture coordinates.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportPacking(const char *msg, int bytesSaved,
+			  float maxNormalError, float maxTexCoordError)
+{
+    if (! verbose)
+	return;
+
+    fprintf(fp, "%s: %d bytes saved, max normal error %g degrees, "
+	    "max texture coordinate error %g\n",
+	    msg, bytesSaved, maxNormalError, maxTexCoordError);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the most memory used by the fields filled in by flattening.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportFlattenMemory(const char *msg, size_t peakBytes,
+				size_t doublingBytes, SbBool isDetail)
+{
+    if (! verbose || (isDetail && ! details) || doublingBytes == 0)
+	return;
+
+    fprintf(fp, "%s: %.2f MB peak, %.2f MB if doubling (%.0f%% saved)\n",
+	    msg, peakBytes / 1048576.0, doublingBytes / 1048576.0,
+	    100.0 * (1.0 - (double) peakBytes / doublingBytes));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the results of welding coordinates.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportWelding(const char *msg, int numWelded, int numDegenerate,
+			  SbBool isDetail)
+{
+    if (! verbose || (isDetail && ! details))
+	return;
+
+    fprintf(fp, "%s: %d coords welded, %d degenerate tris removed\n",
+	    msg, numWelded, numDegenerate);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the average strip length and average vertex cache miss
+// ratio of triangle strips.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportStrips(const char *msg, int numStrips, int numTris,
+			 int numCacheMisses, SbBool isDetail)
+{
+    if (! verbose || (isDetail && ! details) || numTris == 0)
+	return;
+
+    fprintf(fp, "%s: %d strips, %.2f tris per strip, ACMR %.3f\n",
+	    msg, numStrips,
+	    numStrips > 0 ? (float) numTris / numStrips : 0.0,
+	    (float) numCacheMisses / numTris);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reports the average vertex cache miss ratio of triangle lists
+// before and after optimizing.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::reportCacheOptimization(const char *msg, int numTris,
+				    int numMissesBefore, int numMissesAfter,
+				    SbBool isDetail)
+{
+    if (! verbose || (isDetail && ! details) || numTris == 0)
+	return;
+
+    fprintf(fp, "%s: %d tris, ACMR %.3f before, %.3f after\n",
+	    msg, numTris,
+	    (float) numMissesBefore / numTris,
+	    (float) numMissesAfter  / numTris);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -180,3 +459,262 @@ IfReporter::reportNodeCount(const char *msg, SoNode *root)
 
     fprintf(fp, "%s: %d nodes\n", msg, nodeCount);
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Starts a stage of the pipeline.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::startStage(const char *name, const char *msg)
+{
+    if (msg != NULL)
+	startReport(msg);
+
+    curStage.name = name;
+    curStage.msg  = msg;
+    curStage.metrics.start();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Finishes the current stage of the pipeline, recording its cost.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::finishStage()
+{
+    curStage.metrics.finish();
+    stages.append(curStage);
+
+    if (curStage.msg != NULL)
+	finishReport();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Records the cost of processing the graph in a holder.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::recordSubgraph(IfHolder *holder)
+{
+    Subgraph subgraph;
+    int ns, nv;
+    countHolder(holder, ns, subgraph.numTris, nv);
+    subgraph.flatten  = holder->flattenMetrics;
+    subgraph.condense = holder->condenseMetrics;
+    subgraph.strip    = holder->stripMetrics;
+
+    subgraphs.append(subgraph);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Forgets all recorded stages and subgraphs.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::clearStages()
+{
+    stages.truncate(0);
+    subgraphs.truncate(0);
+    haveCache = FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the cost of the last recorded stage with the given name.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfReporter::getStageMetrics(const char *name, IfMetrics &metrics)
+{
+    for (int i = stages.getLength() - 1; i >= 0; i--) {
+	if (strcmp(stages[i].name, name) == 0) {
+	    metrics = stages[i].metrics;
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Sums the triangles and costs of all recorded subgraphs.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::getSubgraphTotals(int &numTris, IfMetrics &flatten,
+			      IfMetrics &condense, IfMetrics &strip)
+{
+    numTris  = 0;
+    flatten  = IfMetrics();
+    condense = IfMetrics();
+    strip    = IfMetrics();
+
+    for (int i = 0; i < subgraphs.getLength(); i++) {
+	flatten.add(subgraphs[i].flatten);
+	condense.add(subgraphs[i].condense);
+	strip.add(subgraphs[i].strip);
+	numTris += subgraphs[i].numTris;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Writes the recorded stages and subgraphs as a JSON object. The
+// subgraph totals are sums over all subgraphs, so their times may
+// add up to more than the wall time of the build stage when several
+// threads were used.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::writeStageReport(FILE *jsonFile, const char *inputName)
+{
+    int i;
+
+    fprintf(jsonFile, "{\n  \"input\": ");
+    writeJSONString(jsonFile, inputName != NULL ? inputName : "-");
+
+    fprintf(jsonFile, ",\n  \"stages\": [");
+    for (i = 0; i < stages.getLength(); i++) {
+	fprintf(jsonFile, "%s\n    { \"name\": ", i > 0 ? "," : "");
+	writeJSONString(jsonFile, stages[i].name);
+	fprintf(jsonFile, ", \"metrics\": ");
+	stages[i].metrics.writeJSON(jsonFile);
+	fprintf(jsonFile, " }");
+    }
+    fprintf(jsonFile, "\n  ],\n");
+
+    IfMetrics flatten, condense, strip;
+    int numTris;
+    getSubgraphTotals(numTris, flatten, condense, strip);
+
+    fprintf(jsonFile, "  \"subgraphTotals\": {\n");
+    fprintf(jsonFile, "    \"count\": %d,\n", subgraphs.getLength());
+    fprintf(jsonFile, "    \"triangles\": %d,\n", numTris);
+    fprintf(jsonFile, "    \"flatten\": ");
+    flatten.writeJSON(jsonFile);
+    fprintf(jsonFile, ",\n    \"condense\": ");
+    condense.writeJSON(jsonFile);
+    fprintf(jsonFile, ",\n    \"strip\": ");
+    strip.writeJSON(jsonFile);
+    fprintf(jsonFile, "\n  },\n");
+
+    if (haveCache)
+	fprintf(jsonFile, "  \"cache\": { \"hits\": %d, \"misses\": %d, "
+		"\"stored\": %d, \"evicted\": %d, \"bytes\": %lu },\n",
+		cacheHits, cacheMisses, cacheStored, cacheEvicted,
+		(unsigned long) cacheBytes);
+
+    fprintf(jsonFile, "  \"subgraphs\": [");
+    for (i = 0; i < subgraphs.getLength(); i++) {
+	const Subgraph &subgraph = subgraphs[i];
+	fprintf(jsonFile, "%s\n    { \"index\": %d, \"triangles\": %d,",
+		i > 0 ? "," : "", i, subgraph.numTris);
+	fprintf(jsonFile, "\n      \"flatten\": ");
+	subgraph.flatten.writeJSON(jsonFile);
+	fprintf(jsonFile, ",\n      \"condense\": ");
+	subgraph.condense.writeJSON(jsonFile);
+	fprintf(jsonFile, ",\n      \"strip\": ");
+	subgraph.strip.writeJSON(jsonFile);
+	fprintf(jsonFile, " }");
+    }
+    fprintf(jsonFile, "\n  ]\n}\n");
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Counts strips, triangles, and vertices in the triangles of a
+// holder, or of its chunks if it was split into chunks. Only the full
+// detail is counted.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::countHolder(IfHolder *holder, int &numStrips, int &numTris,
+			int &numVerts)
+{
+    numStrips = numTris = numVerts = 0;
+
+    countShapes(holder->root, numStrips, numTris, numVerts);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Adds the strips, triangles, and vertices in the shapes under a node
+// to the counts. Only the first child of an SoLOD is counted.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::countShapes(SoNode *node, int &numStrips, int &numTris,
+			int &numVerts)
+{
+    if (node->isOfType(SoLOD::getClassTypeId())) {
+	if (((SoLOD *) node)->getNumChildren() > 0)
+	    countShapes(((SoLOD *) node)->getChild(0),
+			numStrips, numTris, numVerts);
+	return;
+    }
+
+    if (node->isOfType(SoGroup::getClassTypeId())) {
+	SoGroup *group = (SoGroup *) node;
+	for (int i = 0; i < group->getNumChildren(); i++)
+	    countShapes(group->getChild(i), numStrips, numTris, numVerts);
+	return;
+    }
+
+    if (! node->isOfType(SoIndexedShape::getClassTypeId()))
+	return;
+
+    const SoIndexedShape *shape = (const SoIndexedShape *) node;
+    int ntc = shape->coordIndex.getNum();
+    const int32_t *ind = shape->coordIndex.getValues(0);
+
+    int vertsInStrip = 0;
+
+    for (int i = 0; i < ntc; i++) {
+
+	if (ind[i] < 0) {
+	    if (vertsInStrip > 2)
+		numStrips++;
+	    vertsInStrip = 0;
+	}
+
+	else {
+	    numVerts++;
+	    if (++vertsInStrip > 2)
+		numTris++;
+	}
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Writes a string as a JSON string, escaping characters as needed.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfReporter::writeJSONString(FILE *jsonFile, const char *str)
+{
+    putc('"', jsonFile);
+    for (const char *c = str; *c != '\0'; c++) {
+	if (*c == '"' || *c == '\\')
+	    fprintf(jsonFile, "\\%c", *c);
+	else if ((unsigned char) *c < 0x20)
+	    fprintf(jsonFile, "\\u%04x", (unsigned char) *c);
+	else
+	    putc(*c, jsonFile);
+    }
+    putc('"', jsonFile);
+}
@@ -45,6 +45,8 @@
 #define  _IF_REPORTER_
 
 #include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/lists/SbList.h>
+#include "IfMetrics.h"
 
 class IfHolder;
 class IfShapeList;
@@ -73,6 +75,101 @@ class IfReporter {
     // Reports a IfHolder
     static void		reportHolder(const char *msg, IfHolder *holder);
 
+    // Reports the result of checking the single-traversal collector
+    // against the path-based one. Mismatches are always reported.
+    static void		reportCollectionCheck(const char *msg,
+					      int numShapes,
+					      int numMismatches);
+
+    // Reports the number of property nodes found when collecting and
+    // the number left after interning
+    static void		reportInterning(const char *msg, int numNodes,
+					int numInterned);
+
+    // Reports the number of shapes merged into others, how many of
+    // them needed their material bindings promoted to
+    // PER_VERTEX_INDEXED (and the bytes of indices that added), and
+    // the number of merges rejected as too costly
+    static void		reportMerging(const char *msg, int numMerged,
+				      int numPromoted, int numPromotionBytes,
+				      int numRejected);
+
+    // Reports the number of material values before weeding, the
+    // number of distinct values among them, and the number kept
+    static void		reportMaterialWeeding(const char *msg,
+					      int numValues, int numUnique,
+					      int numUsed);
+
+    // Reports the number of shapes flattened in batches, the number of
+    // batches, and how many of those were started because of the
+    // vertex budget
+    static void		reportBatching(const char *msg, int numShapes,
+				       int numBatches, int numSplits);
+
+    // Reports the number of flattened subgraphs split into spatial
+    // chunks and the number of chunks they were split into
+    static void		reportChunks(const char *msg, int numGroups,
+				     int numChunks, SbBool isDetail = FALSE);
+
+    // Reports the number of flattened subgraphs given simplified
+    // levels of detail, the number of levels, and the number of
+    // triangles in their full detail and in all their levels
+    static void		reportLevelsOfDetail(const char *msg, int numGroups,
+					     int numLevels, int numTris,
+					     int numLevelTris,
+					     SbBool isDetail = FALSE);
+
+    // Reports the bytes saved by packing normals and texture
+    // coordinates, the largest normal error in degrees, and the
+    // largest texture coordinate error
+    static void		reportPacking(const char *msg, int bytesSaved,
+				      float maxNormalError,
+				      float maxTexCoordError);
+
+    // Reports how many flattened subgraphs were found in the cache,
+    // how many were not, how many were stored in it, and how many old
+    // ones were removed to keep it within its size, along with its
+    // total size. These are also written to the stage report.
+    static void		reportCache(const char *msg, int numHits,
+				    int numMisses, int numStored,
+				    int numEvicted, size_t numBytes);
+
+    // Reports the number of subgraphs flattened early in low-memory
+    // mode, and the number and size of those spilled to disk
+    static void		reportLowMemory(const char *msg, int numFlattened,
+					int numSpilled, size_t numBytes);
+
+    // Reports spilled subgraphs that could not be read back in
+    // low-memory mode. This is always reported.
+    static void		reportRestoreFailure(const char *msg, int numLost,
+					     int numSpilled);
+
+    // Reports the most memory used by the fields filled in by
+    // flattening, compared to growing them by doubling
+    static void		reportFlattenMemory(const char *msg,
+					    size_t peakBytes,
+					    size_t doublingBytes,
+					    SbBool isDetail = FALSE);
+
+    // Reports the results of welding coordinates
+    static void		reportWelding(const char *msg, int numWelded,
+				      int numDegenerate,
+				      SbBool isDetail = FALSE);
+
+    // Reports the average strip length and average vertex cache miss
+    // ratio (misses per triangle) of triangle strips
+    static void		reportStrips(const char *msg, int numStrips,
+				     int numTris, int numCacheMisses,
+				     SbBool isDetail = FALSE);
+
+    // Reports the average vertex cache miss ratio of triangle lists
+    // before and after optimizing them for the cache
+    static void		reportCacheOptimization(const char *msg,
+						int numTris,
+						int numMissesBefore,
+						int numMissesAfter,
+						SbBool isDetail = FALSE);
+
     // Reports a IfShapeList
     static void		reportShapeList(const char *msg,
 					IfShapeList *shapeList,
@@ -81,11 +178,83 @@ class IfReporter {
     // Reports on the number of nodes in the given graph
     static void		reportNodeCount(const char *msg, SoNode *root);
 
+    // Starts and finishes a stage of the pipeline. The message is
+    // reported as by startReport() and finishReport(), and the cost
+    // of the stage (see IfMetrics) is recorded under the given short
+    // name. If the message is NULL, nothing is reported, so that a
+    // stage can cover code that makes reports of its own. Stages do
+    // not nest.
+    static void		startStage(const char *name, const char *msg);
+    static void		finishStage();
+
+    // Records the cost of flattening, condensing, and stripping the
+    // graph in the given holder
+    static void		recordSubgraph(IfHolder *holder);
+
+    // Forgets all recorded stages and subgraphs, so that another
+    // run of the pipeline can be measured
+    static void		clearStages();
+
+    // Returns the cost of the most recently recorded stage with the
+    // given name. Returns FALSE if there is no such stage.
+    static SbBool	getStageMetrics(const char *name,
+					IfMetrics &metrics);
+
+    // Returns the number of triangles in all recorded subgraphs and
+    // the summed cost of flattening, condensing, and stripping them
+    static void		getSubgraphTotals(int &numTris, IfMetrics &flatten,
+					  IfMetrics &condense,
+					  IfMetrics &strip);
+
+    // Writes everything recorded by the above as a JSON object,
+    // along with the name of the input file
+    static void		writeStageReport(FILE *jsonFile,
+					 const char *inputName);
+
   private:
     static FILE		*fp;
     static SbBool	verbose;
     static SbBool	details;
 
+    // A recorded stage
+    struct Stage {
+	const char	*name;
+	const char	*msg;		// Reported message, or NULL
+	IfMetrics	metrics;
+    };
+
+    // A recorded level-5 subgraph
+    struct Subgraph {
+	int		numTris;
+	IfMetrics	flatten;
+	IfMetrics	condense;
+	IfMetrics	strip;
+    };
+
+    static SbList<Stage>	stages;
+    static SbList<Subgraph>	subgraphs;
+    static Stage		curStage;
+
+    // Cache statistics, if there was a cache
+    static SbBool		haveCache;
+    static int			cacheHits, cacheMisses;
+    static int			cacheStored, cacheEvicted;
+    static size_t		cacheBytes;
+
+    // Counts the strips, triangles, and vertices in a holder. If the
+    // holder was split into chunks, their shapes are counted instead,
+    // and if it has levels of detail, only the full detail is counted.
+    static void		countHolder(IfHolder *holder, int &numStrips,
+				    int &numTris, int &numVerts);
+
+    // Adds the strips, triangles, and vertices in the shapes under a
+    // node to the counts
+    static void		countShapes(SoNode *node, int &numStrips,
+				    int &numTris, int &numVerts);
+
+    // Writes a string as a JSON string
+    static void		writeJSONString(FILE *jsonFile, const char *str);
+
     // Callback for reportNodeCount
     static SoCallbackAction::Response countCB(void *userData,
 					      SoCallbackAction *,
@@ -0,0 +1,602 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <Inventor/SbColor.h>
+#include <Inventor/SbLinear.h>
+#include <Inventor/nodes/SoBaseColor.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoPackedColor.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoTriangleStripSet.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+
+#include "IfSceneMaker.h"
+
+// Names of the kinds of scenes, in the order of SceneType
+static const char *sceneNames[IfSceneMaker::NUM_SCENE_TYPES] = {
+    "parts",
+    "meshes",
+    "deep",
+    "materials",
+    "vp",
+};
+
+// Number of distinct shapes instanced by PARTS and MATERIALS scenes
+#define NUM_PART_SHAPES	8
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfSceneMaker::IfSceneMaker()
+{
+    seed	= 1;
+    random	= seed;
+    chainLength	= 4;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfSceneMaker::~IfSceneMaker()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a scene of the given kind with about the given number of
+// triangles.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoSeparator *
+IfSceneMaker::make(SceneType type, int numTris)
+{
+    random = seed;
+
+    if (numTris < 2)
+	numTris = 2;
+
+    switch (type) {
+      case PARTS:
+	return makeParts(numTris);
+      case MESHES:
+	return makeMeshes(numTris);
+      case DEEP:
+	return makeDeep(numTris);
+      case MATERIALS:
+	return makeMaterials(numTris);
+      case VERTEX_PROPERTY:
+	return makeVertexProperty(numTris);
+      default:
+	return NULL;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the short name of a kind of scene.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const char *
+IfSceneMaker::getName(SceneType type)
+{
+    return sceneNames[type];
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Finds the kind of scene with the given name.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfSceneMaker::getType(const char *name, SceneType &type)
+{
+    for (int i = 0; i < NUM_SCENE_TYPES; i++) {
+	if (strcmp(name, sceneNames[i]) == 0) {
+	    type = (SceneType) i;
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a scene of many small parts, each an instance of one of a
+// few shapes with one of a few materials. Most of them end up differing
+// only in transform.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoSeparator *
+IfSceneMaker::makeParts(int numTris)
+{
+    int i;
+
+    SoSeparator *shapes[NUM_PART_SHAPES];
+    for (i = 0; i < NUM_PART_SHAPES; i++)
+	shapes[i] = makeGrid(8, 8);
+
+    SoMaterial *materials[4];
+    for (i = 0; i < 4; i++) {
+	materials[i] = new SoMaterial;
+	materials[i]->diffuseColor.setValue(nextColor());
+    }
+
+    int numParts = numTris / (8 * 8 * 2);
+    if (numParts < 1)
+	numParts = 1;
+    float spread = 2.0 * powf((float) numParts, 1.0 / 3.0);
+
+    SoSeparator *root = new SoSeparator;
+    for (i = 0; i < numParts; i++) {
+	SoSeparator *part = new SoSeparator;
+	part->addChild(makeTransform(spread));
+	part->addChild(materials[(int) (nextRandom() * 4) & 3]);
+	part->addChild(shapes[i % NUM_PART_SHAPES]);
+	root->addChild(part);
+    }
+
+    return root;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a scene of four huge meshes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoSeparator *
+IfSceneMaker::makeMeshes(int numTris)
+{
+    // Each mesh has size * size quads
+    int size = (int) sqrtf(numTris / 8.0);
+    if (size < 1)
+	size = 1;
+
+    SoSeparator *root = new SoSeparator;
+    for (int i = 0; i < 4; i++) {
+	SoSeparator *mesh = new SoSeparator;
+	SoMaterial *material = new SoMaterial;
+	material->diffuseColor.setValue(nextColor());
+	mesh->addChild(material);
+	mesh->addChild(makeTransform(4.0));
+	mesh->addChild(makeGrid(size, size));
+	root->addChild(mesh);
+    }
+
+    return root;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a scene that is a deep binary tree of transforms, with a
+// small mesh of its own at each leaf.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoSeparator *
+IfSceneMaker::makeDeep(int numTris)
+{
+    int numLeaves = numTris / (4 * 4 * 2);
+    if (numLeaves < 1)
+	numLeaves = 1;
+
+    // A branch at depth 0 is a separator
+    return (SoSeparator *) makeBranch(numLeaves, 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a branch of a DEEP scene: a chain of nested levels, each
+// with a transform, ending in a leaf or in two more branches. Levels
+// at odd depths are plain SoGroups rather than SoSeparators, so their
+// transforms and materials carry over to their later siblings as well
+// as down the tree.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoGroup *
+IfSceneMaker::makeBranch(int numLeaves, int depth)
+{
+    SoGroup *branch = NULL, *group = NULL;
+
+    for (int i = 0; i < chainLength; i++, depth++) {
+	SoGroup *level;
+	if (depth & 1)
+	    level = new SoGroup;
+	else
+	    level = new SoSeparator;
+
+	level->addChild(makeTransform(1.0));
+
+	if (depth % 3 == 0) {
+	    SoMaterial *material = new SoMaterial;
+	    material->diffuseColor.setValue(nextColor());
+	    level->addChild(material);
+	}
+
+	if (group == NULL)
+	    branch = level;
+	else
+	    group->addChild(level);
+	group = level;
+    }
+
+    if (numLeaves == 1)
+	group->addChild(makeGrid(4, 4));
+    else {
+	int half = numLeaves / 2;
+	group->addChild(makeBranch(half, depth));
+	group->addChild(makeBranch(numLeaves - half, depth));
+    }
+
+    return branch;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a scene of many small parts, each with a different color. The
+// colors are given in turn by SoMaterial, SoBaseColor, SoPackedColor,
+// and SoMaterial with a color for each face.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoSeparator *
+IfSceneMaker::makeMaterials(int numTris)
+{
+    int i, j;
+
+    SoSeparator *shapes[NUM_PART_SHAPES];
+    for (i = 0; i < NUM_PART_SHAPES; i++)
+	shapes[i] = makeGrid(4, 4);
+
+    int numParts = numTris / (4 * 4 * 2);
+    if (numParts < 1)
+	numParts = 1;
+    float spread = 2.0 * powf((float) numParts, 1.0 / 3.0);
+
+    SoSeparator *root = new SoSeparator;
+    for (i = 0; i < numParts; i++) {
+	SoSeparator *part = new SoSeparator;
+	part->addChild(makeTransform(spread));
+
+	SbColor color = nextColor();
+
+	switch (i & 3) {
+	  case 0:
+	    {
+		SoMaterial *material = new SoMaterial;
+		material->diffuseColor.setValue(color);
+		part->addChild(material);
+	    }
+	    break;
+
+	  case 1:
+	    {
+		SoBaseColor *baseColor = new SoBaseColor;
+		baseColor->rgb.setValue(color);
+		part->addChild(baseColor);
+	    }
+	    break;
+
+	  case 2:
+	    {
+		SoPackedColor *packedColor = new SoPackedColor;
+		packedColor->orderedRGBA.setValue(color.getPackedValue());
+		part->addChild(packedColor);
+	    }
+	    break;
+
+	  case 3:
+	    {
+		SoMaterial *material = new SoMaterial;
+		material->diffuseColor.setNum(4 * 4);
+		SbColor *colors = material->diffuseColor.startEditing();
+		for (j = 0; j < 4 * 4; j++)
+		    colors[j] = nextColor();
+		material->diffuseColor.finishEditing();
+		SoMaterialBinding *binding = new SoMaterialBinding;
+		binding->value = SoMaterialBinding::PER_FACE;
+		part->addChild(material);
+		part->addChild(binding);
+	    }
+	    break;
+	}
+
+	part->addChild(shapes[i % NUM_PART_SHAPES]);
+	root->addChild(part);
+    }
+
+    return root;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a scene of small parts whose coordinates, normals, and
+// per-vertex colors are all in SoVertexProperty nodes. Half of them
+// are indexed face sets and half are triangle strip sets.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoSeparator *
+IfSceneMaker::makeVertexProperty(int numTris)
+{
+    const int	rows = 8, cols = 8;
+    const int	numPoints = (rows + 1) * (cols + 1);
+    int		i, r, c;
+
+    int numParts = numTris / (rows * cols * 2);
+    if (numParts < 1)
+	numParts = 1;
+    float spread = 2.0 * powf((float) numParts, 1.0 / 3.0);
+
+    SoMFVec3f points;
+    points.setContainer(NULL);
+
+    SoSeparator *root = new SoSeparator;
+    for (i = 0; i < numParts; i++) {
+	makeGridPoints(rows, cols, points);
+	const SbVec3f *p = points.getValues(0);
+
+	// Normals from the differences between neighboring points
+	SbVec3f normals[numPoints];
+	for (r = 0; r <= rows; r++) {
+	    for (c = 0; c <= cols; c++) {
+		int r0 = (r > 0 ? r - 1 : r), r1 = (r < rows ? r + 1 : r);
+		int c0 = (c > 0 ? c - 1 : c), c1 = (c < cols ? c + 1 : c);
+		SbVec3f dx = p[r * (cols+1) + c1] - p[r * (cols+1) + c0];
+		SbVec3f dy = p[r1 * (cols+1) + c] - p[r0 * (cols+1) + c];
+		normals[r * (cols+1) + c] = dx.cross(dy);
+		normals[r * (cols+1) + c].normalize();
+	    }
+	}
+
+	uint32_t colors[numPoints];
+	for (c = 0; c < numPoints; c++)
+	    colors[c] = nextColor().getPackedValue();
+
+	SoVertexProperty *vp = new SoVertexProperty;
+	SoSeparator *part = new SoSeparator;
+	part->addChild(makeTransform(spread));
+
+	if ((i & 1) == 0) {
+	    vp->vertex.setValues(0, numPoints, p);
+	    vp->normal.setValues(0, numPoints, normals);
+	    vp->orderedRGBA.setValues(0, numPoints, colors);
+	    vp->normalBinding	= SoVertexProperty::PER_VERTEX_INDEXED;
+	    vp->materialBinding = SoVertexProperty::PER_VERTEX_INDEXED;
+
+	    SoIndexedFaceSet *faceSet = new SoIndexedFaceSet;
+	    makeGridIndices(rows, cols, faceSet->coordIndex);
+	    faceSet->vertexProperty = vp;
+	    part->addChild(faceSet);
+	}
+
+	else {
+	    // One strip for each row of quads
+	    int numVerts = rows * (cols + 1) * 2;
+	    vp->vertex.setNum(numVerts);
+	    vp->normal.setNum(numVerts);
+	    vp->orderedRGBA.setNum(numVerts);
+	    SbVec3f  *v = vp->vertex.startEditing();
+	    SbVec3f  *n = vp->normal.startEditing();
+	    uint32_t *o = vp->orderedRGBA.startEditing();
+	    int k = 0;
+	    for (r = 0; r < rows; r++) {
+		for (c = 0; c <= cols; c++) {
+		    int above = (r + 1) * (cols + 1) + c;
+		    int below = r * (cols + 1) + c;
+		    v[k] = p[above];  n[k] = normals[above];
+		    o[k++] = colors[above];
+		    v[k] = p[below];  n[k] = normals[below];
+		    o[k++] = colors[below];
+		}
+	    }
+	    vp->vertex.finishEditing();
+	    vp->normal.finishEditing();
+	    vp->orderedRGBA.finishEditing();
+	    vp->normalBinding	= SoVertexProperty::PER_VERTEX;
+	    vp->materialBinding = SoVertexProperty::PER_VERTEX;
+
+	    SoTriangleStripSet *stripSet = new SoTriangleStripSet;
+	    stripSet->numVertices.setNum(rows);
+	    for (r = 0; r < rows; r++)
+		stripSet->numVertices.set1Value(r, (cols + 1) * 2);
+	    stripSet->vertexProperty = vp;
+	    part->addChild(stripSet);
+	}
+
+	root->addChild(part);
+    }
+
+    return root;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes the coordinates of a bumpy grid of rows by cols quads in the
+// unit square. The bumps are a product of sines with random
+// frequencies and phases.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSceneMaker::makeGridPoints(int rows, int cols, SoMFVec3f &points)
+{
+    float fx = 1.0 + 3.0 * nextRandom(), px = nextRandom();
+    float fy = 1.0 + 3.0 * nextRandom(), py = nextRandom();
+
+    points.setNum((rows + 1) * (cols + 1));
+    SbVec3f *p = points.startEditing();
+    for (int r = 0; r <= rows; r++) {
+	float y = (float) r / rows;
+	for (int c = 0; c <= cols; c++) {
+	    float x = (float) c / cols;
+	    float z = 0.1 * (sinf(2.0 * M_PI * (fx * x + px)) *
+			     cosf(2.0 * M_PI * (fy * y + py)));
+	    p[r * (cols + 1) + c].setValue(x, y, z);
+	}
+    }
+    points.finishEditing();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes the face set indices of a grid of rows by cols quads, in
+// counterclockwise order.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSceneMaker::makeGridIndices(int rows, int cols, SoMFInt32 &coordIndex)
+{
+    coordIndex.setNum(rows * cols * 5);
+    int32_t *ind = coordIndex.startEditing();
+    for (int r = 0; r < rows; r++) {
+	for (int c = 0; c < cols; c++) {
+	    int32_t v = r * (cols + 1) + c;
+	    *ind++ = v;
+	    *ind++ = v + 1;
+	    *ind++ = v + cols + 2;
+	    *ind++ = v + cols + 1;
+	    *ind++ = -1;
+	}
+    }
+    coordIndex.finishEditing();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a separator with the coordinates and face set of a grid.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoSeparator *
+IfSceneMaker::makeGrid(int rows, int cols)
+{
+    SoCoordinate3 *coords = new SoCoordinate3;
+    makeGridPoints(rows, cols, coords->point);
+
+    SoIndexedFaceSet *faceSet = new SoIndexedFaceSet;
+    makeGridIndices(rows, cols, faceSet->coordIndex);
+
+    SoSeparator *grid = new SoSeparator;
+    grid->addChild(coords);
+    grid->addChild(faceSet);
+    return grid;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a transform to a random spot within a cube of the given size,
+// with a random orientation.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoNode *
+IfSceneMaker::makeTransform(float spread)
+{
+    SoTransform *xf = new SoTransform;
+    xf->translation.setValue(nextVector() * spread);
+    SbVec3f axis = nextVector() + SbVec3f(0.0, 0.0, 0.6);
+    axis.normalize();
+    xf->rotation.setValue(SbRotation(axis, 2.0 * M_PI * nextRandom()));
+    return xf;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the next random number between 0 and 1, from a linear
+// congruential generator. This is used rather than rand() so that
+// scenes are the same on all platforms.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+float
+IfSceneMaker::nextRandom()
+{
+    random = random * 1664525 + 1013904223;
+    return (random >> 8) * (1.0 / 16777216.0);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns a random color. The components are drawn in order, so the
+// result does not depend on the order in which a compiler evaluates
+// function arguments.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbColor
+IfSceneMaker::nextColor()
+{
+    float r = nextRandom();
+    float g = nextRandom();
+    float b = nextRandom();
+    return SbColor(r, g, b);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns a random vector with components between -0.5 and 0.5.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbVec3f
+IfSceneMaker::nextVector()
+{
+    float x = nextRandom() - 0.5;
+    float y = nextRandom() - 0.5;
+    float z = nextRandom() - 0.5;
+    return SbVec3f(x, y, z);
+}
@@ -0,0 +1,140 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfSceneMaker class: procedurally generates scenes of a given size
+// and kind, for benchmarking ivfix. Each kind stresses a different
+// part of the pipeline:
+//
+//	PARTS		Many small instanced parts with a few materials
+//	MESHES		A few huge meshes
+//	DEEP		A deep hierarchy of separators, groups, and
+//			transforms
+//	MATERIALS	Many small parts, each with its own color
+//	VERTEX_PROPERTY	Colored parts with SoVertexProperty nodes, as
+//			both face sets and triangle strip sets
+//
+// The scenes are made from bumpy grids of quads, so their size is
+// given as an (approximate) number of triangles. The same seed always
+// produces the same scene.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_SCENE_MAKER_
+#define  _IF_SCENE_MAKER_
+
+#include <Inventor/SbColor.h>
+#include <Inventor/SbLinear.h>
+
+class SoGroup;
+class SoMFInt32;
+class SoMFVec3f;
+class SoNode;
+class SoSeparator;
+
+class IfSceneMaker {
+
+  public:
+    // Kinds of scenes
+    enum SceneType {
+	PARTS,
+	MESHES,
+	DEEP,
+	MATERIALS,
+	VERTEX_PROPERTY,
+	NUM_SCENE_TYPES
+    };
+
+    IfSceneMaker();
+    ~IfSceneMaker();
+
+    // Sets the seed for the random numbers used to vary the scenes.
+    // The default is 1.
+    void		setSeed(uint32_t s)		{ seed = s; }
+
+    // Sets the number of nested levels, each with its own transform,
+    // in each branch of a DEEP scene. The depth of the scene is this
+    // times the log of its size. The default is 4.
+    void		setChainLength(int n)	{ chainLength = (n < 1 ? 1 : n); }
+
+    // Makes a scene of the given kind with about the given number of
+    // triangles. The returned root is not ref'ed.
+    SoSeparator *	make(SceneType type, int numTris);
+
+    // Returns the short name of a kind of scene, or finds the kind of
+    // scene with the given name, returning FALSE if there is none
+    static const char *	getName(SceneType type);
+    static SbBool	getType(const char *name, SceneType &type);
+
+  private:
+    uint32_t		seed;
+    uint32_t		random;
+    int			chainLength;
+
+    // Each kind of scene
+    SoSeparator *	makeParts(int numTris);
+    SoSeparator *	makeMeshes(int numTris);
+    SoSeparator *	makeDeep(int numTris);
+    SoSeparator *	makeMaterials(int numTris);
+    SoSeparator *	makeVertexProperty(int numTris);
+
+    // Makes one branch of a DEEP scene with the given number of
+    // leaves, starting at the given depth
+    SoGroup *		makeBranch(int numLeaves, int depth);
+
+    // Makes a bumpy grid of rows by cols quads, as coordinates and as
+    // face set indices
+    void		makeGridPoints(int rows, int cols, SoMFVec3f &points);
+    static void		makeGridIndices(int rows, int cols,
+					SoMFInt32 &coordIndex);
+
+    // Makes a separator holding a coordinate node and a face set for
+    // a grid
+    SoSeparator *	makeGrid(int rows, int cols);
+
+    // Makes a transform that places something at a random spot with a
+    // random orientation
+    SoNode *		makeTransform(float spread);
+
+    // Returns the next random number between 0 and 1, and random
+    // colors and vectors (with components between -0.5 and 0.5)
+    float		nextRandom();
+    SbColor		nextColor();
+    SbVec3f		nextVector();
+};
+
+#endif /* _IF_SCENE_MAKER_ */
@@ -35,6 +35,7 @@
  */
 
 #include <string.h>
+#include <functional>
 
 #include <Inventor/SoLists.h>
 #include <Inventor/nodes/SoCamera.h>
@@ -134,6 +135,51 @@ IfShape::~IfShape()
 int
 IfShape::compare(const IfShape *s1, const IfShape *s2,
 		 int &level, DifferenceCode &diffCode)
+{
+    // Compare the properties at levels 1 through 4 in order. (The
+    // codes are in order of level.)
+    // NOTE: the material comparison has to come last within level 4
+    // so that the IfMerger stuff works properly.
+    for (int i = CAMERA; i <= MATERIAL; i++) {
+	DifferenceCode code = (DifferenceCode) i;
+	int c = compareProperty(s1, s2, code);
+	if (c != 0) {
+	    level    = getLevel(code);
+	    diffCode = code;
+	    return c;
+	}
+    }
+
+    // If nothing else differs, the shape must. We usually consider
+    // them to be the same in this case. However, if the shape is not
+    // really a shape (it may be a File or similar node), we need to
+    // make sure it is not "flattened" later on. To indicate this, we
+    // return a level 5 difference. (We can still return that they are
+    // the same, since the difference matters only after they have
+    // been sorted, when the levels are computed for real.)
+    if (s1->dontFlatten || s2->dontFlatten) {
+	level = 5;
+	return 0;
+    }
+
+    // If we got here, they're the same, except for the
+    // shape. Consider them to be the same, even though they actually
+    // differ at Level 5.
+    level = 0;
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Compares one property of two IfShape instances, returning a
+// comparison code (<0, 0, or >0). The property is given by its
+// difference code, which must be one of the codes for levels 1-4.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfShape::compareProperty(const IfShape *s1, const IfShape *s2,
+			 DifferenceCode code)
 {
     //////////////////////////////////////////////////////////////////
     //
@@ -144,156 +190,204 @@ IfShape::compare(const IfShape *s1, const IfShape *s2,
     // specially, using the other macros.
     //
 
-#define COMPARE_NODES(node, code)					      \
-    if (s1->node != s2->node) {						      \
-	diffCode = code;						      \
-	return s2->node - s1->node;					      \
-    }
+#define COMPARE_NODES(node)						      \
+    if (s1->node != s2->node)						      \
+	return comparePointers(s2->node, s1->node)
 
-#define COMPARE_LISTS(list, code)					      \
-    if (s1->list != s2->list) {						      \
-	int c = compareLists(s1->list, s2->list);			      \
-	if (c != 0) {							      \
-	    diffCode = code;						      \
-	    return c;							      \
-	}								      \
-    }
+#define COMPARE_LISTS(list)						      \
+    if (s1->list != s2->list)						      \
+	return compareLists(s1->list, s2->list)
 
-#define COMPARE_NULL_NODE_POINTERS(node, code)				      \
-	if (s1->node == NULL) {						      \
-	    diffCode = code;						      \
+#define COMPARE_NULL_NODE_POINTERS(node)				      \
+	if (s1->node == NULL)						      \
 	    return -1;							      \
-	}								      \
-	if (s2->node == NULL) {						      \
-	    diffCode = code;						      \
-	    return 1;							      \
-	}
+	if (s2->node == NULL)						      \
+	    return 1
 
-#define COMPARE_INT_FIELDS(node, field, code)				      \
-    if (s1->node->field.getValue() != s2->node->field.getValue()) {	      \
-	diffCode = code;						      \
+#define COMPARE_INT_FIELDS(node, field)					      \
+    if (s1->node->field.getValue() != s2->node->field.getValue())	      \
 	return ((int) s2->node->field.getValue() -			      \
-		(int) s1->node->field.getValue());			      \
-    }
+		(int) s1->node->field.getValue())
 
-#define COMPARE_FLOAT_FIELDS(node, field, code)				      \
+#define COMPARE_FLOAT_FIELDS(node, field)				      \
     if (s1->node->field.getValue() != s2->node->field.getValue()) {	      \
 	int c = compareFloats(s1->node->field.getValue(),		      \
 			      s2->node->field.getValue());		      \
-	if (c != 0) {							      \
-	    diffCode = code;						      \
+	if (c != 0)							      \
 	    return c;							      \
-	}								      \
     }
 
-#define COMPARE_MFLOAT_FIELDS(node, field, code)			      \
+#define COMPARE_MFLOAT_FIELDS(node, field)				      \
     if (s1->node->field.getNum() != s2->node->field.getNum())		      \
 	return s2->node->field.getNum() - s1->node->field.getNum();	      \
     if (s1->node->field.getNum() == 1) {				      \
 	int c = compareFloats(s1->node->field[0], s2->node->field[0]);	      \
-	if (c != 0) {							      \
-	    diffCode = code;						      \
+	if (c != 0)							      \
 	    return c;							      \
-	}								      \
     }									      \
-    else {								      \
-	diffCode = code;						      \
-	return s2->node - s1->node;					      \
-    }
+    else								      \
+	return comparePointers(s2->node, s1->node)
 
-#define COMPARE_MCOLOR_FIELDS(node, field, code)			      \
+#define COMPARE_MCOLOR_FIELDS(node, field)				      \
     if (s1->node->field.getNum() != s2->node->field.getNum())		      \
 	return s2->node->field.getNum() - s1->node->field.getNum();	      \
     if (s1->node->field.getNum() == 1) {				      \
 	int c = compareColors(s1->node->field[0], s2->node->field[0]);	      \
-	if (c != 0) {							      \
-	    diffCode = code;						      \
+	if (c != 0)							      \
 	    return c;							      \
-	}								      \
     }									      \
-    else {								      \
-	diffCode = code;						      \
-	return s2->node - s1->node;					      \
-    }
+    else								      \
+	return comparePointers(s2->node, s1->node)
 
     //////////////////////////////////////////////////////////////////
 
-    level = 1;
-    COMPARE_NODES(camera, CAMERA);
-
-    level = 2;
-    COMPARE_LISTS(lights, LIGHTS);
-    COMPARE_LISTS(clipPlanes, CLIP_PLANES);
-    COMPARE_NODES(environment, ENVIRONMENT);
-    COMPARE_NODES(lightModel, LIGHT_MODEL);
-
-    level = 3;
-    // Comparing textures uses the file names if they are set
-    if (s1->texture != s2->texture) {
-	COMPARE_NULL_NODE_POINTERS(texture, TEXTURE);
-	const SbString &name1 = s1->texture->filename.getValue();
-	const SbString &name2 = s2->texture->filename.getValue();
-	// If no names, use the texture nodes themselves
-	if (! name1)
-	    return s2->texture - s1->texture;
-	int c = strcmp(name1.getString(), name2.getString());
-	if (c != 0)
-	    return c;
-    }
-    
-    level = 4;
-    // Comparing draw style tests the values in the nodes
-    if (s1->drawStyle != s2->drawStyle) {
-	COMPARE_NULL_NODE_POINTERS(drawStyle, DRAW_STYLE);
-	COMPARE_INT_FIELDS(drawStyle,   style,		DRAW_STYLE);
-	COMPARE_FLOAT_FIELDS(drawStyle, pointSize,	DRAW_STYLE);
-	COMPARE_FLOAT_FIELDS(drawStyle, lineWidth,	DRAW_STYLE);
-	COMPARE_INT_FIELDS(drawStyle,   linePattern,	DRAW_STYLE);
-    }
-    // Comparing shape hints tests the values in the nodes
-    if (s1->shapeHints != s2->shapeHints) {
-	COMPARE_NULL_NODE_POINTERS(shapeHints, SHAPE_HINTS);
-	COMPARE_INT_FIELDS(shapeHints, vertexOrdering,	SHAPE_HINTS);
-	COMPARE_INT_FIELDS(shapeHints, shapeType,	SHAPE_HINTS);
-	COMPARE_INT_FIELDS(shapeHints, faceType,	SHAPE_HINTS);
-	COMPARE_FLOAT_FIELDS(shapeHints, creaseAngle,	SHAPE_HINTS);
-    }
-    COMPARE_LISTS(other, OTHER);
-
-    // Comparing materials tests the values in the nodes if there is
-    // only one material in each.
-    // NOTE: the material comparison has to come last within this
-    // level so that the IfMerger stuff works properly.
-    if (s1->material != s2->material) {
-	COMPARE_NULL_NODE_POINTERS(material, MATERIAL);
-	COMPARE_MCOLOR_FIELDS(material,  ambientColor, MATERIAL);
-	COMPARE_MCOLOR_FIELDS(material,  diffuseColor, MATERIAL);
-	COMPARE_MCOLOR_FIELDS(material, specularColor, MATERIAL);
-	COMPARE_MCOLOR_FIELDS(material, emissiveColor, MATERIAL);
-	COMPARE_MFLOAT_FIELDS(material,     shininess, MATERIAL);
-	COMPARE_MFLOAT_FIELDS(material,  transparency, MATERIAL);
-    }
+    switch (code) {
 
-    // If nothing else differs, the shape must. We usually consider
-    // them to be the same in this case. However, if the shape is not
-    // really a shape (it may be a File or similar node), we need to
-    // make sure it is not "flattened" later on. To indicate this, we
-    // return a level 5 difference. (We can still return that they are
-    // the same, since the difference matters only after they have
-    // been sorted, when the levels are computed for real.)
-    if (s1->dontFlatten || s2->dontFlatten) {
-	level = 5;
-	return 0;
+      case CAMERA:
+	COMPARE_NODES(camera);
+	break;
+
+      case LIGHTS:
+	COMPARE_LISTS(lights);
+	break;
+
+      case CLIP_PLANES:
+	COMPARE_LISTS(clipPlanes);
+	break;
+
+      case ENVIRONMENT:
+	COMPARE_NODES(environment);
+	break;
+
+      case LIGHT_MODEL:
+	COMPARE_NODES(lightModel);
+	break;
+
+      case TEXTURE:
+	// Comparing textures uses the file names if they are set
+	if (s1->texture != s2->texture) {
+	    COMPARE_NULL_NODE_POINTERS(texture);
+	    const SbString &name1 = s1->texture->filename.getValue();
+	    const SbString &name2 = s2->texture->filename.getValue();
+	    // If no names, use the texture nodes themselves. Textures
+	    // without names come before ones with names, so that
+	    // sorting is consistent.
+	    if (! name1 && ! name2)
+		return comparePointers(s2->texture, s1->texture);
+	    if (! name1)
+		return -1;
+	    if (! name2)
+		return 1;
+	    return strcmp(name1.getString(), name2.getString());
+	}
+	break;
+
+      case DRAW_STYLE:
+	// Comparing draw style tests the values in the nodes
+	if (s1->drawStyle != s2->drawStyle) {
+	    COMPARE_NULL_NODE_POINTERS(drawStyle);
+	    COMPARE_INT_FIELDS(drawStyle,   style);
+	    COMPARE_FLOAT_FIELDS(drawStyle, pointSize);
+	    COMPARE_FLOAT_FIELDS(drawStyle, lineWidth);
+	    COMPARE_INT_FIELDS(drawStyle,   linePattern);
+	}
+	break;
+
+      case SHAPE_HINTS:
+	// Comparing shape hints tests the values in the nodes
+	if (s1->shapeHints != s2->shapeHints) {
+	    COMPARE_NULL_NODE_POINTERS(shapeHints);
+	    COMPARE_INT_FIELDS(shapeHints, vertexOrdering);
+	    COMPARE_INT_FIELDS(shapeHints, shapeType);
+	    COMPARE_INT_FIELDS(shapeHints, faceType);
+	    COMPARE_FLOAT_FIELDS(shapeHints, creaseAngle);
+	}
+	break;
+
+      case OTHER:
+	COMPARE_LISTS(other);
+	break;
+
+      case MATERIAL:
+	// Comparing materials tests the values in the nodes if there
+	// is only one material in each
+	if (s1->material != s2->material) {
+	    COMPARE_NULL_NODE_POINTERS(material);
+	    COMPARE_MCOLOR_FIELDS(material,  ambientColor);
+	    COMPARE_MCOLOR_FIELDS(material,  diffuseColor);
+	    COMPARE_MCOLOR_FIELDS(material, specularColor);
+	    COMPARE_MCOLOR_FIELDS(material, emissiveColor);
+	    COMPARE_MFLOAT_FIELDS(material,     shininess);
+	    COMPARE_MFLOAT_FIELDS(material,  transparency);
+	}
+	break;
+
+      default:
+	ASSERT(FALSE);
+	break;
     }
 
-    // If we got here, they're the same, except for the
-    // shape. Consider them to be the same, even though they actually
-    // differ at Level 5.
-    level = 0;
     return 0;
-    
+
 #undef COMPARE_NODES
 #undef COMPARE_LISTS
+#undef COMPARE_NULL_NODE_POINTERS
+#undef COMPARE_INT_FIELDS
+#undef COMPARE_FLOAT_FIELDS
+#undef COMPARE_MFLOAT_FIELDS
+#undef COMPARE_MCOLOR_FIELDS
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the node or node list holding the property with the given
+// difference code (levels 1-4 only). Two shapes with the same
+// pointer here are always the same in that property.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const void *
+IfShape::getProperty(DifferenceCode code) const
+{
+    switch (code) {
+      case CAMERA:	return camera;
+      case LIGHTS:	return lights;
+      case CLIP_PLANES:	return clipPlanes;
+      case ENVIRONMENT:	return environment;
+      case LIGHT_MODEL:	return lightModel;
+      case TEXTURE:	return texture;
+      case DRAW_STYLE:	return drawStyle;
+      case SHAPE_HINTS:	return shapeHints;
+      case OTHER:	return other;
+      case MATERIAL:	return material;
+      default:		break;
+    }
+
+    ASSERT(FALSE);
+    return NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the level (1-5) of the given difference code, or 0 for
+// NONE or SHAPE.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfShape::getLevel(DifferenceCode code)
+{
+    if (code == NONE || code == SHAPE)
+	return 0;
+    if (code < LIGHTS)
+	return 1;
+    if (code < TEXTURE)
+	return 2;
+    if (code < DRAW_STYLE)
+	return 3;
+    if (code < COMPLEXITY)
+	return 4;
+    return 5;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -316,11 +410,29 @@ IfShape::compareLists(const SoNodeList *l1, const SoNodeList *l2)
 
     for (int i = 0; i < l1->getLength(); i++)
 	if ((*l1)[i] != (*l2)[i])
-	    return (*l2)[i] - (*l2)[i];
+	    return comparePointers((*l2)[i], (*l1)[i]);
 
     return 0;
 }
 
+/////////////////////////////////////////////////////////////////////////////
+//
+// Compares two pointers by address. This is used instead of
+// subtracting them, which can overflow an int.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfShape::comparePointers(const void *p1, const void *p2)
+{
+    if (std::less<const void *>()(p1, p2))
+	return -1;
+    else if (std::less<const void *>()(p2, p1))
+	return 1;
+    else
+	return 0;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // Compares two floating point numbers for equality.
@@ -485,3 +597,50 @@ IfShape::clearNodes()
 #undef CLEAR_NODE
 #undef CLEAR_LIST
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes this IfShape refer to the same nodes as another one.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfShape::copyNodes(const IfShape *from)
+{
+
+#define COPY_NODE(name)							      \
+    if ((name = from->name) != NULL)					      \
+	name->ref()
+#define COPY_LIST(name)							      \
+    name = (from->name != NULL ? new SoNodeList(*from->name) : NULL)
+
+    COPY_NODE(camera);
+    COPY_NODE(environment);
+    COPY_NODE(lightModel);
+    COPY_NODE(texture);
+    COPY_NODE(drawStyle);
+    COPY_NODE(shapeHints);
+    COPY_NODE(material);
+    COPY_NODE(complexity);
+    COPY_NODE(coords);
+    COPY_NODE(font);
+    COPY_NODE(materialBinding);
+    COPY_NODE(normals);
+    COPY_NODE(normalBinding);
+    COPY_NODE(profileCoords);
+    COPY_NODE(texCoords);
+    COPY_NODE(texCoordBinding);
+    COPY_NODE(shape);
+
+    COPY_LIST(lights);
+    COPY_LIST(clipPlanes);
+    COPY_LIST(other);
+    COPY_LIST(profiles);
+    COPY_LIST(textureTransforms);
+
+    transform	= from->transform;
+    dontFlatten	= from->dontFlatten;
+
+#undef COPY_NODE
+#undef COPY_LIST
+}
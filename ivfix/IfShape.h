@@ -231,10 +231,29 @@ class IfShape {
     static int		compare(const IfShape *s1, const IfShape *s2,
 				int &level, DifferenceCode &diffCode);
 
+    // Compares one property of two IfShape instances, returning a
+    // comparison code as above. The property is given by its
+    // difference code, which must be for one of levels 1-4.
+    static int		compareProperty(const IfShape *s1,
+					const IfShape *s2,
+					DifferenceCode code);
+
+    // Returns the node or node list holding the property with the
+    // given difference code (levels 1-4). Shapes that have the same
+    // pointer for a property compare equal in it.
+    const void *	getProperty(DifferenceCode code) const;
+
+    // Returns the level (1-5) of the given difference code, or 0 for
+    // NONE and SHAPE
+    static int		getLevel(DifferenceCode code);
+
     // Compares two node lists for equality
     static int		compareLists(const SoNodeList *l1,
 				     const SoNodeList *l2);
 
+    // Compares two pointers by address
+    static int		comparePointers(const void *p1, const void *p2);
+
     // Compares two floating point numbers for equality
     static int		compareFloats(float f1, float f2);
 
@@ -247,6 +266,11 @@ class IfShape {
 
     // Unref's non-NULL node pointers and sets them all to NULL
     void		clearNodes();
+
+    // Makes this IfShape refer to the same shape, properties, and
+    // transform as another one, ref'ing the nodes. Node lists are
+    // copied. This IfShape must not refer to any nodes yet.
+    void		copyNodes(const IfShape *from);
 };
 
 #endif /* _IF_SHAPE_ */
@@ -0,0 +1,791 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <algorithm>
+
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedShape.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+#include <Inventor/nodes/SoTextureCoordinateBinding.h>
+
+#include "IfAssert.h"
+#include "IfHolder.h"
+#include "IfSimplifier.h"
+
+// Planes through boundary edges are weighted by this times the
+// squared length of the edge, so that borders move much less than
+// surfaces
+#define BOUNDARY_WEIGHT		100.0
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// This is used with std::push_heap() and std::pop_heap() to keep the
+// cheapest collapse at the top of the heap.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+struct IfSimplifierCostMore {
+    template <class C>
+    bool	operator ()(const C &c1, const C &c2) const
+	{ return c1.cost > c2.cost; }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfSimplifier::IfSimplifier()
+{
+    numVerts = numTris = numAliveTris = 0;
+    numCollapses = 0;
+    coords       = NULL;
+    triVerts     = NULL;
+    triNormals   = NULL;
+    triTexCoords = NULL;
+    triMaterials = NULL;
+    triAlive     = NULL;
+    vertTriStart = NULL;
+    vertTris     = NULL;
+    nextMerged   = NULL;
+    stamp        = NULL;
+    locked       = NULL;
+    quadrics     = NULL;
+    marks        = NULL;
+    curMark      = 0;
+    heap         = NULL;
+    heapSize = heapCapacity = 0;
+    indexMap     = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfSimplifier::~IfSimplifier()
+{
+    cleanUp();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Simplifies the triangles in the holder to each of the given
+// fractions of its triangles, returning a new holder for each level.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::simplify(IfHolder *holder, int numLevels,
+		       const float *ratios, IfHolder **levels)
+{
+    numCollapses = 0;
+
+    setUp(holder);
+
+    for (int i = 0; i < numLevels; i++) {
+	ASSERT(i == 0 || ratios[i] < ratios[i - 1]);
+	int targetTris = (int) (ratios[i] * numTris);
+	simplifyTo(targetTris < 1 ? 1 : targetTris);
+	levels[i] = makeLevel(holder);
+    }
+
+    cleanUp();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Sets up the vertex and triangle data from the holder.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::setUp(IfHolder *holder)
+{
+    const SoIndexedShape *triSet = holder->triSet;
+    ASSERT(triSet->coordIndex.getNum() % 4 == 0);
+    numTris  = triSet->coordIndex.getNum() / 4;
+    numVerts = holder->coords->point.getNum();
+    coords   = holder->coords->point.getValues(0);
+    numAliveTris = numTris;
+
+    // Copy the indices of each corner, using the coordinate indices
+    // for fields that share them
+    const int32_t *coordIndices = triSet->coordIndex.getValues(0);
+    const int32_t *normalIndices = NULL, *texCoordIndices = NULL;
+    const int32_t *mtlIndices = NULL;
+    if (holder->doNormals)
+	normalIndices = (triSet->normalIndex.getNum() > 1 ?
+			 triSet->normalIndex.getValues(0) : coordIndices);
+    if (holder->doTexCoords)
+	texCoordIndices = (triSet->textureCoordIndex.getNum() > 1 ?
+			   triSet->textureCoordIndex.getValues(0) :
+			   coordIndices);
+    if (holder->materialBinding->value.getValue() !=
+	SoMaterialBinding::OVERALL)
+	mtlIndices = (triSet->materialIndex.getNum() > 1 ?
+		      triSet->materialIndex.getValues(0) : coordIndices);
+
+    triVerts = new int[3 * numTris];
+    triNormals   = (normalIndices   != NULL ? new int[3 * numTris] : NULL);
+    triTexCoords = (texCoordIndices != NULL ? new int[3 * numTris] : NULL);
+    triMaterials = (mtlIndices      != NULL ? new int[3 * numTris] : NULL);
+    triAlive = new SbBool[numTris];
+    int t, j, v;
+    for (t = 0; t < numTris; t++) {
+	for (j = 0; j < 3; j++) {
+	    triVerts[3 * t + j] = coordIndices[4 * t + j];
+	    if (triNormals != NULL)
+		triNormals[3 * t + j] = normalIndices[4 * t + j];
+	    if (triTexCoords != NULL)
+		triTexCoords[3 * t + j] = texCoordIndices[4 * t + j];
+	    if (triMaterials != NULL)
+		triMaterials[3 * t + j] = mtlIndices[4 * t + j];
+	}
+	triAlive[t] = TRUE;
+    }
+
+    // Find the triangles around each vertex
+    vertTriStart = new int[numVerts + 1];
+    vertTris     = new int[3 * numTris];
+    for (v = 0; v <= numVerts; v++)
+	vertTriStart[v] = 0;
+    for (t = 0; t < 3 * numTris; t++)
+	vertTriStart[triVerts[t] + 1]++;
+    for (v = 0; v < numVerts; v++)
+	vertTriStart[v + 1] += vertTriStart[v];
+    int *fill = new int[numVerts];
+    for (v = 0; v < numVerts; v++)
+	fill[v] = vertTriStart[v];
+    for (t = 0; t < 3 * numTris; t++)
+	vertTris[fill[triVerts[t]]++] = t / 3;
+    delete [] fill;
+
+    nextMerged = new int[numVerts];
+    stamp      = new int[numVerts];
+    locked     = new SbBool[numVerts];
+    marks      = new int[numVerts];
+    for (v = 0; v < numVerts; v++) {
+	nextMerged[v] = v;
+	stamp[v]      = 0;
+	locked[v]     = FALSE;
+	marks[v]      = 0;
+    }
+    curMark = 0;
+
+    findSeams();
+    computeQuadrics();
+
+    // The index map has to be big enough for any of the indexed fields
+    int mapSize = numVerts;
+    if (holder->doNormals && holder->normals->vector.getNum() > mapSize)
+	mapSize = holder->normals->vector.getNum();
+    if (holder->doTexCoords && holder->texCoords->point.getNum() > mapSize)
+	mapSize = holder->texCoords->point.getNum();
+    indexMap = new int[mapSize];
+    for (v = 0; v < mapSize; v++)
+	indexMap[v] = -1;
+
+    // Start with a candidate collapse for every edge
+    heapCapacity = 3 * numTris + 16;
+    heap = new Collapse[heapCapacity];
+    heapSize = 0;
+    for (v = 0; v < numVerts; v++)
+	addCollapses(v, TRUE);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Locks the vertices whose corners do not all have the same normal,
+// texture coordinate, and material indices.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::findSeams()
+{
+    int *attribs[3] = { triNormals, triTexCoords, triMaterials };
+    int *first = new int[numVerts];
+
+    for (int a = 0; a < 3; a++) {
+	if (attribs[a] == NULL)
+	    continue;
+	int v;
+	for (v = 0; v < numVerts; v++)
+	    first[v] = -1;
+	for (int c = 0; c < 3 * numTris; c++) {
+	    v = triVerts[c];
+	    if (first[v] < 0)
+		first[v] = attribs[a][c];
+	    else if (first[v] != attribs[a][c])
+		locked[v] = TRUE;
+	}
+    }
+
+    delete [] first;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Computes the quadric of each vertex from the planes of its
+// triangles and of any boundary edges.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::computeQuadrics()
+{
+    quadrics = new double[10 * numVerts];
+    for (int i = 0; i < 10 * numVerts; i++)
+	quadrics[i] = 0.0;
+
+    for (int t = 0; t < numTris; t++) {
+	const int *tri = &triVerts[3 * t];
+	SbVec3f normal = ((coords[tri[1]] - coords[tri[0]]).
+			  cross(coords[tri[2]] - coords[tri[0]]));
+	float length = normal.length();
+	if (length == 0.0)
+	    continue;
+	normal /= length;
+
+	int j;
+	for (j = 0; j < 3; j++)
+	    addPlane(tri[j], normal, coords[tri[0]], 0.5 * length);
+
+	// An edge that is in no other triangle is on a boundary
+	for (j = 0; j < 3; j++) {
+	    int v1 = tri[j], v2 = tri[(j + 1) % 3];
+	    int numShared = 0;
+	    for (int k = vertTriStart[v1]; k < vertTriStart[v1 + 1]; k++) {
+		const int *other = &triVerts[3 * vertTris[k]];
+		if (other[0] == v2 || other[1] == v2 || other[2] == v2)
+		    numShared++;
+	    }
+	    if (numShared > 1)
+		continue;
+
+	    SbVec3f edge = coords[v2] - coords[v1];
+	    SbVec3f edgeNormal = edge.cross(normal);
+	    if (edgeNormal.length() == 0.0)
+		continue;
+	    edgeNormal.normalize();
+	    double weight = BOUNDARY_WEIGHT * edge.dot(edge);
+	    addPlane(v1, edgeNormal, coords[v1], weight);
+	    addPlane(v2, edgeNormal, coords[v1], weight);
+	}
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Adds the plane with the given unit normal through the given point,
+// weighted, to the quadric of a vertex.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::addPlane(int v, const SbVec3f &normal, const SbVec3f &point,
+		       double weight)
+{
+    double a = normal[0], b = normal[1], c = normal[2];
+    double d = -(a * point[0] + b * point[1] + c * point[2]);
+    double *q = &quadrics[10 * v];
+
+    q[0] += weight * a * a;
+    q[1] += weight * a * b;
+    q[2] += weight * a * c;
+    q[3] += weight * a * d;
+    q[4] += weight * b * b;
+    q[5] += weight * b * c;
+    q[6] += weight * b * d;
+    q[7] += weight * c * c;
+    q[8] += weight * c * d;
+    q[9] += weight * d * d;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the error of the quadrics of two vertices, summed, at a
+// point: the weighted sum of the squared distances from the point to
+// all their planes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+double
+IfSimplifier::evaluate(int v1, int v2, const SbVec3f &p) const
+{
+    const double *q1 = &quadrics[10 * v1];
+    const double *q2 = &quadrics[10 * v2];
+    double q[10];
+    for (int i = 0; i < 10; i++)
+	q[i] = q1[i] + q2[i];
+
+    double x = p[0], y = p[1], z = p[2];
+    double error = (q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z +
+		    2.0 * q[3] * x + q[4] * y * y + 2.0 * q[5] * y * z +
+		    2.0 * q[6] * y + q[7] * z * z + 2.0 * q[8] * z + q[9]);
+
+    // Rounding can make it slightly negative
+    return (error > 0.0 ? error : 0.0);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Adds candidate collapses for the edges from the given vertex to
+// its neighbors. At the start, each edge is added from its lower
+// numbered vertex only.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::addCollapses(int v, SbBool onlyHigher)
+{
+    marks[v] = ++curMark;
+
+    // The triangles around v are those of all vertices merged into it
+    int m = v;
+    do {
+	for (int k = vertTriStart[m]; k < vertTriStart[m + 1]; k++) {
+	    int t = vertTris[k];
+	    if (! triAlive[t])
+		continue;
+	    for (int j = 0; j < 3; j++) {
+		int w = triVerts[3 * t + j];
+		if (marks[w] != curMark) {
+		    marks[w] = curMark;
+		    if (! onlyHigher || w > v)
+			addEdge(v, w);
+		}
+	    }
+	}
+	m = nextMerged[m];
+    } while (m != v);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Adds the cheaper of the two collapses of an edge, unless both of
+// its vertices are locked.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::addEdge(int v1, int v2)
+{
+    if (locked[v1] && locked[v2])
+	return;
+
+    Collapse c;
+    if (locked[v1] ||
+	(! locked[v2] &&
+	 evaluate(v1, v2, coords[v1]) < evaluate(v1, v2, coords[v2]))) {
+	c.from = v2;
+	c.to   = v1;
+    }
+    else {
+	c.from = v1;
+	c.to   = v2;
+    }
+    c.cost      = (float) evaluate(v1, v2, coords[c.to]);
+    c.fromStamp = stamp[c.from];
+    c.toStamp   = stamp[c.to];
+
+    pushCollapse(c);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Adds a collapse to the heap, growing it if necessary.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::pushCollapse(const Collapse &c)
+{
+    if (heapSize == heapCapacity) {
+	Collapse *newHeap = new Collapse[2 * heapCapacity];
+	for (int i = 0; i < heapSize; i++)
+	    newHeap[i] = heap[i];
+	delete [] heap;
+	heap = newHeap;
+	heapCapacity *= 2;
+    }
+
+    heap[heapSize++] = c;
+    std::push_heap(heap, heap + heapSize, IfSimplifierCostMore());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Removes the cheapest collapse from the heap and returns it.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfSimplifier::Collapse
+IfSimplifier::popCollapse()
+{
+    std::pop_heap(heap, heap + heapSize, IfSimplifierCostMore());
+    return heap[--heapSize];
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if moving vertex "from" onto "to" would turn any
+// triangle around "from" over. The triangles that have both vertices
+// are removed by the collapse, so they do not count.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfSimplifier::wouldFlip(int from, int to) const
+{
+    int m = from;
+    do {
+	for (int k = vertTriStart[m]; k < vertTriStart[m + 1]; k++) {
+	    int t = vertTris[k];
+	    if (! triAlive[t])
+		continue;
+	    const int *tri = &triVerts[3 * t];
+	    if (tri[0] == to || tri[1] == to || tri[2] == to)
+		continue;
+
+	    SbVec3f p[3], q[3];
+	    for (int j = 0; j < 3; j++) {
+		p[j] = coords[tri[j]];
+		q[j] = (tri[j] == from ? coords[to] : p[j]);
+	    }
+	    SbVec3f oldNormal = (p[1] - p[0]).cross(p[2] - p[0]);
+	    SbVec3f newNormal = (q[1] - q[0]).cross(q[2] - q[0]);
+	    if (oldNormal.dot(newNormal) <= 0.0)
+		return TRUE;
+	}
+	m = nextMerged[m];
+    } while (m != from);
+
+    return FALSE;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Moves vertex "from" onto "to". The triangles that have both are
+// removed. The corners of the others that were at "from" take the
+// normal, texture coordinate, and material of "to" on the side of the
+// collapsed edge; since "from" is not on a seam, these are all the
+// same.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::collapse(int from, int to)
+{
+    // Find the corner of "to" in a triangle on the collapsed edge
+    int toCorner = -1;
+    int m = from;
+    int k, j;
+    do {
+	for (k = vertTriStart[m]; k < vertTriStart[m + 1] && toCorner < 0;
+	     k++) {
+	    int t = vertTris[k];
+	    if (! triAlive[t])
+		continue;
+	    for (j = 0; j < 3; j++)
+		if (triVerts[3 * t + j] == to)
+		    toCorner = 3 * t + j;
+	}
+	m = nextMerged[m];
+    } while (m != from && toCorner < 0);
+    ASSERT(toCorner >= 0);
+
+    m = from;
+    do {
+	for (k = vertTriStart[m]; k < vertTriStart[m + 1]; k++) {
+	    int t = vertTris[k];
+	    if (! triAlive[t])
+		continue;
+	    int *tri = &triVerts[3 * t];
+	    if (tri[0] == to || tri[1] == to || tri[2] == to) {
+		triAlive[t] = FALSE;
+		numAliveTris--;
+		continue;
+	    }
+	    for (j = 0; j < 3; j++) {
+		if (tri[j] != from)
+		    continue;
+		int c = 3 * t + j;
+		tri[j] = to;
+		if (triNormals != NULL)
+		    triNormals[c] = triNormals[toCorner];
+		if (triTexCoords != NULL)
+		    triTexCoords[c] = triTexCoords[toCorner];
+		if (triMaterials != NULL)
+		    triMaterials[c] = triMaterials[toCorner];
+	    }
+	}
+	m = nextMerged[m];
+    } while (m != from);
+
+    // Merge the quadrics and the lists of merged vertices
+    double *qFrom = &quadrics[10 * from];
+    double *qTo   = &quadrics[10 * to];
+    for (k = 0; k < 10; k++)
+	qTo[k] += qFrom[k];
+    std::swap(nextMerged[from], nextMerged[to]);
+
+    stamp[from] = -1;
+    stamp[to]++;
+    numCollapses++;
+
+    addCollapses(to, FALSE);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Collapses edges, cheapest first, until there are at most the given
+// number of triangles left or no edge can be collapsed.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::simplifyTo(int targetTris)
+{
+    while (numAliveTris > targetTris && heapSize > 0) {
+	Collapse c = popCollapse();
+
+	// Skip collapses made before either vertex changed
+	if (stamp[c.from] != c.fromStamp || stamp[c.to] != c.toStamp)
+	    continue;
+
+	if (wouldFlip(c.from, c.to))
+	    continue;
+
+	collapse(c.from, c.to);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a holder for the triangles that are left, with only the
+// coordinates, normals, and texture coordinates they use. The
+// materials are shared with the original, so the material indices are
+// copied as they are.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfHolder *
+IfSimplifier::makeLevel(IfHolder *holder)
+{
+    IfHolder *level = new IfHolder(holder->origRoot, holder->doStrips,
+				   holder->doNormals, holder->doTexCoords);
+
+    SoIndexedShape *dst = level->triSet;
+    int numIndices = 4 * numAliveTris;
+    int *used = new int[numIndices];
+    int i, t, numUsed;
+
+    // Coordinates
+    dst->coordIndex.setNum(numIndices);
+    numUsed = remapIndices(triVerts, dst->coordIndex.startEditing(), used);
+    dst->coordIndex.finishEditing();
+    level->coords->point.setNum(numUsed);
+    SbVec3f *newCoords = level->coords->point.startEditing();
+    for (i = 0; i < numUsed; i++)
+	newCoords[i] = coords[used[i]];
+    level->coords->point.finishEditing();
+
+    // Normals
+    if (holder->doNormals) {
+	level->normalBinding->value = holder->normalBinding->value;
+	dst->normalIndex.setNum(numIndices);
+	numUsed = remapIndices(triNormals, dst->normalIndex.startEditing(),
+			       used);
+	dst->normalIndex.finishEditing();
+	const SbVec3f *normals = holder->normals->vector.getValues(0);
+	level->normals->vector.setNum(numUsed);
+	SbVec3f *newNormals = level->normals->vector.startEditing();
+	for (i = 0; i < numUsed; i++)
+	    newNormals[i] = normals[used[i]];
+	level->normals->vector.finishEditing();
+	if (sameIndices(&dst->coordIndex, &dst->normalIndex))
+	    dst->normalIndex = -1;
+    }
+
+    // Texture coordinates
+    if (holder->doTexCoords) {
+	level->texCoordBinding->value = holder->texCoordBinding->value;
+	dst->textureCoordIndex.setNum(numIndices);
+	numUsed = remapIndices(triTexCoords,
+			       dst->textureCoordIndex.startEditing(), used);
+	dst->textureCoordIndex.finishEditing();
+	const SbVec2f *texCoords = holder->texCoords->point.getValues(0);
+	level->texCoords->point.setNum(numUsed);
+	SbVec2f *newTexCoords = level->texCoords->point.startEditing();
+	for (i = 0; i < numUsed; i++)
+	    newTexCoords[i] = texCoords[used[i]];
+	level->texCoords->point.finishEditing();
+	if (sameIndices(&dst->coordIndex, &dst->textureCoordIndex))
+	    dst->textureCoordIndex = -1;
+    }
+
+    // Materials
+    level->materialBinding->value = holder->materialBinding->value;
+    if (triMaterials == NULL)
+	dst->materialIndex = holder->triSet->materialIndex;
+    else {
+	dst->materialIndex.setNum(numIndices);
+	int32_t *newMtlIndices = dst->materialIndex.startEditing();
+	for (t = 0; t < numTris; t++) {
+	    if (! triAlive[t])
+		continue;
+	    for (int j = 0; j < 3; j++)
+		*newMtlIndices++ = triMaterials[3 * t + j];
+	    *newMtlIndices++ = -1;
+	}
+	dst->materialIndex.finishEditing();
+	if (sameIndices(&dst->coordIndex, &dst->materialIndex))
+	    dst->materialIndex = -1;
+    }
+
+    delete [] used;
+
+    return level;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Stores the new indices of the corners of the triangles that are
+// left, numbering the old indices in order of first use. Returns the
+// number of distinct indices, storing the old ones in used[]. The
+// index map is left all -1 again.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfSimplifier::remapIndices(const int *oldIndices, int32_t *newIndices,
+			   int *used)
+{
+    int numUsed = 0;
+
+    for (int t = 0; t < numTris; t++) {
+	if (! triAlive[t])
+	    continue;
+	for (int j = 0; j < 3; j++) {
+	    int index = oldIndices[3 * t + j];
+	    if (indexMap[index] < 0) {
+		indexMap[index] = numUsed;
+		used[numUsed++] = index;
+	    }
+	    *newIndices++ = indexMap[index];
+	}
+	*newIndices++ = -1;
+    }
+
+    for (int k = 0; k < numUsed; k++)
+	indexMap[used[k]] = -1;
+
+    return numUsed;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if the two sets of indices are the same.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfSimplifier::sameIndices(const SoMFInt32 *indexField1,
+			  const SoMFInt32 *indexField2)
+{
+    int num1 = indexField1->getNum();
+    int num2 = indexField2->getNum();
+
+    if (num1 != num2)
+	return FALSE;
+
+    const int32_t *ind1 = indexField1->getValues(0);
+    const int32_t *ind2 = indexField2->getValues(0);
+
+    for (int i = 0; i < num1; i++)
+	if (ind1[i] != ind2[i])
+	    return FALSE;
+
+    return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Frees everything set up for simplifying.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSimplifier::cleanUp()
+{
+    delete [] triVerts;
+    delete [] triNormals;
+    delete [] triTexCoords;
+    delete [] triMaterials;
+    delete [] triAlive;
+    delete [] vertTriStart;
+    delete [] vertTris;
+    delete [] nextMerged;
+    delete [] stamp;
+    delete [] locked;
+    delete [] quadrics;
+    delete [] marks;
+    delete [] heap;
+    delete [] indexMap;
+
+    triVerts     = NULL;
+    triNormals   = NULL;
+    triTexCoords = NULL;
+    triMaterials = NULL;
+    triAlive     = NULL;
+    vertTriStart = NULL;
+    vertTris     = NULL;
+    nextMerged   = NULL;
+    stamp        = NULL;
+    locked       = NULL;
+    quadrics     = NULL;
+    marks        = NULL;
+    heap         = NULL;
+    indexMap     = NULL;
+    heapSize = heapCapacity = 0;
+}
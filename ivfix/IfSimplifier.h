@@ -0,0 +1,170 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfSimplifier class: makes simplified versions of the triangles in a
+// condensed IfHolder, for use as levels of detail.
+//
+// The triangles are simplified by collapsing edges in order of the
+// quadric error metric of Garland and Heckbert: each vertex has a
+// quadric that sums the squared distances to the planes of the
+// triangles around it (weighted by area), plus planes perpendicular
+// to any boundary edges to keep open borders in place. An edge is
+// collapsed by moving one of its vertices onto the other (a half-edge
+// collapse), so the remaining vertices keep their original positions,
+// normals, and texture coordinates. The cost of a collapse is the sum
+// of the two quadrics at the position of the vertex that is kept.
+//
+// Vertices where normals, texture coordinates, or materials change
+// (creases, seams, and material borders) are never moved, and
+// collapses that would flip a triangle are skipped.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_SIMPLIFIER_
+#define  _IF_SIMPLIFIER_
+
+#include <Inventor/SbLinear.h>
+
+class IfHolder;
+class SoMFInt32;
+
+class IfSimplifier {
+
+  public:
+    IfSimplifier();
+    ~IfSimplifier();
+
+    // Simplifies the triangles in the holder, which must be as left
+    // by IfCondenser, to each of the given fractions of its
+    // triangles. The fractions must be decreasing; each level is made
+    // by simplifying the one before it further. Returns a new holder
+    // for each level in levels[], each sharing the original root of
+    // the given holder, which is not changed.
+    void		simplify(IfHolder *holder, int numLevels,
+				 const float *ratios, IfHolder **levels);
+
+    // Returns the number of edges collapsed by the last simplify()
+    int			getNumCollapses() const		{ return numCollapses; }
+
+  private:
+    // One candidate collapse of vertex "from" onto vertex "to". It is
+    // out of date if either vertex has changed since it was made.
+    struct Collapse {
+	float	cost;
+	int	from, to;
+	int	fromStamp, toStamp;
+    };
+
+    int			numVerts, numTris, numAliveTris;
+    int			numCollapses;
+    const SbVec3f	*coords;
+    int			*triVerts;	// 3 vertices of each triangle
+    int			*triNormals;	// Normal index of each corner
+    int			*triTexCoords;	// Texture coord index of each corner
+    int			*triMaterials;	// Material index of each corner
+    SbBool		*triAlive;	// FALSE once a triangle collapses
+    int			*vertTriStart;	// Triangles using each vertex are
+    int			*vertTris;	// in vertTris[start[v]..start[v+1])
+    int			*nextMerged;	// Circular list of vertices merged
+    int			*stamp;		// Changes with vertex, -1 once gone
+    SbBool		*locked;	// Vertex may not be moved
+    double		*quadrics;	// 10 coefficients per vertex
+    int			*marks;		// Used to visit each neighbor once
+    int			curMark;
+    Collapse		*heap;		// Candidate collapses, cheapest first
+    int			heapSize, heapCapacity;
+    int			*indexMap;	// Old index to new index, or -1
+
+    // Sets up the vertex and triangle data from the holder
+    void		setUp(IfHolder *holder);
+
+    // Finds the vertices whose corners do not all have the same
+    // normal, texture coordinate, and material indices
+    void		findSeams();
+
+    // Computes the quadric of each vertex
+    void		computeQuadrics();
+
+    // Adds the plane with the given unit normal through the given
+    // point, weighted, to the quadric of a vertex
+    void		addPlane(int v, const SbVec3f &normal,
+				 const SbVec3f &point, double weight);
+
+    // Returns the error of the given quadrics summed at a point
+    double		evaluate(int v1, int v2, const SbVec3f &p) const;
+
+    // Adds candidate collapses for the edges from the given vertex to
+    // its neighbors, only to those with higher numbers if asked
+    void		addCollapses(int v, SbBool onlyHigher);
+
+    // Adds the cheaper of the two collapses of an edge, if any
+    void		addEdge(int v1, int v2);
+
+    // Adds a collapse to, or removes the cheapest one from, the heap
+    void		pushCollapse(const Collapse &c);
+    Collapse		popCollapse();
+
+    // Returns TRUE if moving vertex "from" onto "to" would flip a
+    // triangle around "from"
+    SbBool		wouldFlip(int from, int to) const;
+
+    // Moves vertex "from" onto "to", removing the triangles between
+    void		collapse(int from, int to);
+
+    // Simplifies until there are at most the given number of
+    // triangles left, or no edge can be collapsed
+    void		simplifyTo(int targetTris);
+
+    // Makes a holder for the triangles that are left
+    IfHolder *		makeLevel(IfHolder *holder);
+
+    // Stores the new indices of the corners of the triangles that are
+    // left, numbering the old indices in order of first use. Returns
+    // the number of distinct indices, storing the old ones in used[].
+    int			remapIndices(const int *oldIndices,
+				     int32_t *newIndices, int *used);
+
+    // Returns TRUE if the two sets of indices are the same
+    static SbBool	sameIndices(const SoMFInt32 *indexField1,
+				    const SoMFInt32 *indexField2);
+
+    // Frees everything set up for simplifying
+    void		cleanUp();
+};
+
+#endif /* _IF_SIMPLIFIER_ */
@@ -34,12 +34,56 @@
  *
  */
 
-#include <stdlib.h>
+#include <algorithm>
+#include <functional>
+
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/threads/SbThread.h>
+
 #include "IfAssert.h"
 #include "IfShape.h"
 #include "IfSorter.h"
 
-IfSorter	*IfSorter::curSorter;	// Saves "this" during qsort
+/////////////////////////////////////////////////////////////////////////////
+//
+// These are used with std::sort() to order shapes (given by their
+// indices) by the pointer to one of their properties, by the value of
+// one of their properties, or by their keys.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+struct IfSorterPointerLess {
+    IfShape		**shapes;
+    IfShape::DifferenceCode	code;
+
+    bool	operator ()(int i1, int i2) const
+	{ return std::less<const void *>()(shapes[i1]->getProperty(code),
+					    shapes[i2]->getProperty(code)); }
+};
+
+struct IfSorterPropertyLess {
+    IfShape		**shapes;
+    IfShape::DifferenceCode	code;
+
+    bool	operator ()(int i1, int i2) const
+	{ return IfShape::compareProperty(shapes[i1], shapes[i2], code) < 0; }
+};
+
+struct IfSorterKeyLess {
+    const int	*keys;
+    int		numKeys;
+
+    // Shapes with the same key stay in their original order
+    bool	operator ()(int i1, int i2) const
+	{
+	    const int *k1 = &keys[i1 * numKeys];
+	    const int *k2 = &keys[i2 * numKeys];
+	    for (int i = 0; i < numKeys; i++)
+		if (k1[i] != k2[i])
+		    return k1[i] < k2[i];
+	    return i1 < i2;
+	}
+};
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -49,6 +93,12 @@ IfSorter	*IfSorter::curSorter;	// Saves "this" during qsort
 
 IfSorter::IfSorter()
 {
+    numThreads = 1;
+    shapes     = NULL;
+    numShapes  = 0;
+    keys       = NULL;
+    order      = NULL;
+    jobMutex   = NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -64,25 +114,62 @@ IfSorter::~IfSorter()
 /////////////////////////////////////////////////////////////////////////////
 //
 // This sorts the given IfShapeList by various properties. The list is
-// sorted in place.
+// sorted in place. The order is the same as sorting with
+// IfShape::compare(), with shapes that compare the same left in their
+// original order.
 //
 /////////////////////////////////////////////////////////////////////////////
 
 void
 IfSorter::sort(IfShapeList &shapeList)
 {
-    curSorter = this;
-    curShapeList = &shapeList;
+    // This assumes that the shapeList is a contiguous array of
+    // pointers to IfShape instances
+    shapes    = shapeList.getArray();
+    numShapes = shapeList.getLength();
+
+    if (numShapes == 0)
+	return;
+
+    // Compute the key of each shape, one property at a time
+    keys = new int[numShapes * NUM_PROPERTIES];
+    runJobs(&IfSorter::rankProperty, NUM_PROPERTIES);
+
+    // Sort the shape indices by key. Each thread sorts one section,
+    // and then pairs of sorted sections are merged until there is
+    // only one left.
+    int i;
+    order = new int[numShapes];
+    for (i = 0; i < numShapes; i++)
+	order[i] = i;
+
+    numSections = (numThreads < numShapes ? numThreads : numShapes);
+    sectionSize = (numShapes + numSections - 1) / numSections;
+    runJobs(&IfSorter::sortSection, numSections);
+
+    while (sectionSize < numShapes) {
+	int numPairs = (numShapes + 2 * sectionSize - 1) / (2 * sectionSize);
+	runJobs(&IfSorter::mergeSections, numPairs);
+	sectionSize *= 2;
+    }
+
+    // Rearrange the shapes into the sorted order
+    IfShape **oldShapes = new IfShape *[numShapes];
+    for (i = 0; i < numShapes; i++)
+	oldShapes[i] = shapes[i];
+    for (i = 0; i < numShapes; i++)
+	shapes[i] = oldShapes[order[i]];
+    delete [] oldShapes;
 
-    // Use quicksort. This assumes that the shapeList is a contiguous
-    // array of pointers to IfShape instances.
-    IfShape **shapes = shapeList.getArray();
-    qsort(shapes, shapeList.getLength(), sizeof(IfShape *), compareCB);
+    delete [] keys;
+    delete [] order;
+    keys  = NULL;
+    order = NULL;
 
     // Once the shapes have been sorted, compare all neighbors to
     // determine the level at which they differ
     shapeList[0]->differenceLevel = 0;
-    for (int i = 1; i < shapeList.getLength(); i++)
+    for (i = 1; i < shapeList.getLength(); i++)
 	IfShape::compare(shapeList[i-1], shapeList[i],
 		       shapeList[i]->differenceLevel,
 		       shapeList[i]->differenceCode);
@@ -90,14 +177,173 @@ IfSorter::sort(IfShapeList &shapeList)
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Compares 2 shapes for qsort.
+// Ranks the values of one property in all shapes, storing the ranks
+// in the keys. Shapes that have the same node (or node list) for the
+// property are grouped together first, so only one shape from each
+// group has to be compared by value. Groups with equal values get the
+// same rank.
 //
 /////////////////////////////////////////////////////////////////////////////
 
-int
-IfSorter::compare(const IfShape *shape1, const IfShape *shape2)
+void
+IfSorter::rankProperty(int prop)
+{
+    IfShape::DifferenceCode code =
+	(IfShape::DifferenceCode) (FIRST_PROPERTY + prop);
+    int i, j;
+
+    // Group the shapes by pointer
+    int *byPointer = new int[numShapes];
+    for (i = 0; i < numShapes; i++)
+	byPointer[i] = i;
+    IfSorterPointerLess pointerLess;
+    pointerLess.shapes = shapes;
+    pointerLess.code   = code;
+    std::sort(byPointer, byPointer + numShapes, pointerLess);
+
+    // Find the first shape of each group. An extra entry marks the
+    // end of the last group.
+    int *groupStart = new int[numShapes + 1];
+    int numGroups = 0;
+    for (i = 0; i < numShapes; i++) {
+	if (i == 0 || (shapes[byPointer[i]]->getProperty(code) !=
+		       shapes[byPointer[i - 1]]->getProperty(code)))
+	    groupStart[numGroups++] = i;
+    }
+    groupStart[numGroups] = numShapes;
+
+    // Sort the first shapes of the groups by value
+    int *groupShapes = new int[numGroups];
+    for (i = 0; i < numGroups; i++)
+	groupShapes[i] = byPointer[groupStart[i]];
+    IfSorterPropertyLess propertyLess;
+    propertyLess.shapes = shapes;
+    propertyLess.code   = code;
+    std::sort(groupShapes, groupShapes + numGroups, propertyLess);
+
+    // Rank the groups. The rank of each group is stored in the key of
+    // its first shape, then copied to the rest of the group.
+    int rank = 0;
+    for (i = 0; i < numGroups; i++) {
+	if (i > 0 && IfShape::compareProperty(shapes[groupShapes[i - 1]],
+					      shapes[groupShapes[i]],
+					      code) != 0)
+	    rank++;
+	keys[groupShapes[i] * NUM_PROPERTIES + prop] = rank;
+    }
+    for (i = 0; i < numGroups; i++) {
+	int groupRank = keys[byPointer[groupStart[i]] * NUM_PROPERTIES + prop];
+	for (j = groupStart[i] + 1; j < groupStart[i + 1]; j++)
+	    keys[byPointer[j] * NUM_PROPERTIES + prop] = groupRank;
+    }
+
+    delete [] byPointer;
+    delete [] groupStart;
+    delete [] groupShapes;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Sorts one section of the shape indices by key.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSorter::sortSection(int section)
 {
-    int level;
-    IfShape::DifferenceCode dCode;
-    return IfShape::compare(shape1, shape2, level, dCode);
+    int start = section * sectionSize;
+    int end   = start + sectionSize;
+    if (end > numShapes)
+	end = numShapes;
+
+    IfSorterKeyLess keyLess;
+    keyLess.keys    = keys;
+    keyLess.numKeys = NUM_PROPERTIES;
+    std::sort(order + start, order + end, keyLess);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Merges a pair of adjacent sorted sections of the shape indices.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSorter::mergeSections(int pair)
+{
+    int start = pair * 2 * sectionSize;
+    int mid   = start + sectionSize;
+    int end   = mid + sectionSize;
+    if (mid >= numShapes)
+	return;
+    if (end > numShapes)
+	end = numShapes;
+
+    IfSorterKeyLess keyLess;
+    keyLess.keys    = keys;
+    keyLess.numKeys = NUM_PROPERTIES;
+    std::inplace_merge(order + start, order + mid, order + end, keyLess);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Runs jobs 0 to n-1 with the given method, on up to numThreads
+// threads. The calling thread does its share of the work.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSorter::runJobs(JobMethod method, int n)
+{
+    jobMethod = method;
+    numJobs   = n;
+    nextJob   = 0;
+
+    int numWorkers = (numThreads < numJobs ? numThreads : numJobs) - 1;
+
+    if (numWorkers <= 0) {
+	for (int i = 0; i < numJobs; i++)
+	    (this->*jobMethod)(i);
+	return;
+    }
+
+    jobMutex = new SbMutex;
+
+    int i;
+    SbThread **workers = new SbThread *[numWorkers];
+    for (i = 0; i < numWorkers; i++)
+	workers[i] = SbThread::create(jobThreadCB, this);
+
+    processJobs();
+
+    for (i = 0; i < numWorkers; i++) {
+	workers[i]->join();
+	SbThread::destroy(workers[i]);
+    }
+    delete [] workers;
+
+    delete jobMutex;
+    jobMutex = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Takes jobs and runs them until there are no more. This is run by
+// each thread.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfSorter::processJobs()
+{
+    while (TRUE) {
+	jobMutex->lock();
+	int job = nextJob++;
+	jobMutex->unlock();
+
+	if (job >= numJobs)
+	    break;
+
+	(this->*jobMethod)(job);
+    }
 }
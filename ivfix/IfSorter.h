@@ -40,14 +40,20 @@
 // properties. The resulting list is then easily examined to see which
 // shapes can be processed together.
 //
+// Rather than comparing shapes property by property while sorting,
+// this first ranks the distinct values of each property, giving each
+// shape a key of small integers. The keys are then compared while
+// sorting, which may be done on several threads.
+//
 /////////////////////////////////////////////////////////////////////////////
 
 #ifndef  _IF_SORTER_
 #define  _IF_SORTER_
 
+#include "IfShape.h"
 #include "IfShapeList.h"
 
-class IfShape;
+class SbMutex;
 
 class IfSorter {
 
@@ -55,19 +61,61 @@ class IfSorter {
     IfSorter();
     ~IfSorter();
 
+    // Sets the number of threads used to sort. The default is 1. The
+    // result does not depend on the number of threads.
+    void	setNumThreads(int n)	{ numThreads = (n < 1 ? 1 : n); }
+
     void	sort(IfShapeList &shapeList);
 
   private:
-    static IfSorter	*curSorter;	// Saves "this" during qsort
-    IfShapeList		*curShapeList;	// For verification
+    // The properties compared when sorting, which are those at
+    // levels 1-4, in order
+    enum {
+	FIRST_PROPERTY = IfShape::CAMERA,
+	NUM_PROPERTIES = IfShape::MATERIAL - IfShape::CAMERA + 1
+    };
+
+    int		numThreads;	// Threads used for sorting
+    IfShape	**shapes;	// Shapes being sorted
+    int		numShapes;
+
+    // The sort key of each shape: NUM_PROPERTIES ranks per shape.
+    // Two shapes compare the same way as their keys do.
+    int		*keys;
+
+    // Indices of shapes, which are sorted by key
+    int		*order;
+
+    // Ranks of the values of one property in all shapes
+    void	rankProperty(int prop);
+
+    // Sorts one section of order[], or merges two sorted sections
+    void	sortSection(int section);
+    void	mergeSections(int pair);
+
+    // Used to divide the sort into sections
+    int		numSections;
+    int		sectionSize;
+
+    //////////////////////////////////////////////////////////////////
+    //
+    // Threads: these run the jobs numbered 0 to numJobs-1 with the
+    // given method, on up to numThreads threads.
+    //
+
+    typedef void (IfSorter::*JobMethod)(int job);
+
+    JobMethod	jobMethod;
+    int		numJobs;
+    int		nextJob;
+    SbMutex	*jobMutex;
 
-    // Compares 2 shapes for qsort
-    int		compare(const IfShape *shape1, const IfShape *shape2);
+    void	runJobs(JobMethod method, int n);
+    void	processJobs();
 
-    // qsort callback for comparing items
-    static int	compareCB(const void *p1, const void *p2)
-	{ return curSorter->compare(* (const IfShape **) p1,
-				    * (const IfShape **) p2); }
+    static void *	jobThreadCB(void *userData)
+	{ ((IfSorter *) userData)->processJobs();
+	  return NULL; }
 };
 
 #endif /* _IF_SORTER_ */
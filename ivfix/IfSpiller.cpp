@@ -0,0 +1,139 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <stdlib.h>
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoNode.h>
+
+#include "IfSpiller.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfSpiller::IfSpiller()
+{
+    fp       = NULL;
+    numBytes = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor. Closing the temporary file removes it.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfSpiller::~IfSpiller()
+{
+    if (fp != NULL)
+	fclose(fp);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Writes a graph to the end of the file. Each graph is written with
+// its own SoOutput, so it has its own header and can be read back by
+// itself.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfSpiller::spill(SoNode *root)
+{
+    if (fp == NULL && (fp = tmpfile()) == NULL)
+	return -1;
+
+    if (fseek(fp, 0, SEEK_END) != 0)
+	return -1;
+    long offset = ftell(fp);
+
+    root->ref();
+    {
+	SoOutput out;
+	out.setFilePointer(fp);
+	out.setBinary(TRUE);
+	SoWriteAction wa(&out);
+	wa.apply(root);
+    }
+    root->unrefNoDelete();
+
+    if (fflush(fp) != 0)
+	return -1;
+    long size = ftell(fp) - offset;
+
+    offsets.append(offset);
+    sizes.append(size);
+    numBytes += size;
+
+    return offsets.getLength() - 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Reads back a graph. Its bytes are read into memory and parsed from
+// there, so that SoInput does not read past the end of the graph.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SoNode *
+IfSpiller::restore(int id)
+{
+    if (fp == NULL || id < 0 || id >= offsets.getLength())
+	return NULL;
+
+    size_t size = sizes[id];
+    char *buf = new char[size];
+    if (fseek(fp, offsets[id], SEEK_SET) != 0 ||
+	fread(buf, 1, size, fp) != size) {
+	delete [] buf;
+	return NULL;
+    }
+
+    SoNode *root = NULL;
+    SoInput in;
+    in.setBuffer(buf, size);
+    if (! SoDB::read(&in, root))
+	root = NULL;
+
+    delete [] buf;
+    return root;
+}
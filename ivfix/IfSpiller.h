@@ -0,0 +1,81 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfSpiller class: keeps graphs in a temporary binary Inventor file
+// rather than in memory. IfBuilder uses this in low-memory mode to
+// spill flattened subgraphs while the rest of the scene is still
+// being built, and restores them when it is done. The file is removed
+// when the spiller is deleted.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_SPILLER_
+#define  _IF_SPILLER_
+
+#include <stdio.h>
+#include <Inventor/SbBasic.h>
+#include <Inventor/lists/SbList.h>
+
+class SoNode;
+
+class IfSpiller {
+
+  public:
+    IfSpiller();
+    ~IfSpiller();
+
+    // Writes a graph to the file, returning an id with which to
+    // restore it, or -1 if it could not be written
+    int			spill(SoNode *root);
+
+    // Reads back the graph with the given id. The returned node is
+    // not ref'ed. Returns NULL on error.
+    SoNode *		restore(int id);
+
+    // Returns the number of graphs and bytes written
+    int			getNumSpilled() const	{ return offsets.getLength(); }
+    size_t		getNumBytes() const	{ return numBytes; }
+
+  private:
+    FILE		*fp;		// Temporary file, opened when needed
+    SbList<long>	offsets;	// Where each graph starts...
+    SbList<long>	sizes;		// ... and how many bytes it has
+    size_t		numBytes;
+};
+
+#endif /* _IF_SPILLER_ */
@@ -34,13 +34,13 @@
  *
  */
 
-#include <Inventor/SbDict.h>
 #include <Inventor/nodes/SoCoordinate3.h>
 #include <Inventor/nodes/SoIndexedTriangleStripSet.h>
 
 #include "IfAssert.h"
 #include "IfStripper.h"
 #include "IfHolder.h"
+#include "IfVertexCache.h"
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -51,6 +51,12 @@
 IfStripper::IfStripper()
 {
     holder = NULL;
+    method = GREEDY;
+    cacheSize = 16;
+    vertexCornerStart = NULL;
+    vertexCorners = NULL;
+    vertexNumUnused = NULL;
+    cornerPos = NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -116,11 +122,16 @@ IfStripper::strip(IfHolder *_holder)
     vertexPtrList = new SbPList(numTriangles * 2);
 
     // Create strips from the connected triangles
-    createStrips();
+    if (method == CACHE)
+	createCacheStrips();
+    else
+	createStrips();
 
     // Change the indices in the triangle strip
     adjustIndices();
 
+    computeStatistics();
+
     // Clean up
     delete [] vertices;
     delete [] triangles;
@@ -279,136 +290,137 @@ IfStripper::createTriangleList()
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Finds adjacent triangles
+// Finds the corners of the triangles using each vertex, stored in one
+// array, sorted by vertex and then by triangle. All of the triangles
+// are unused to start with.
 //
 /////////////////////////////////////////////////////////////////////////////
 
 void
-IfStripper::findNeighborTriangles()
+IfStripper::createVertexCornerLists()
 {
-    // Allocate edge structures
-    StripEdge *edges = new StripEdge[3 * numTriangles];
-
-    // Create a dictionary for finding edges
-    edgeDict = new SbDict(1235);
-
-    // Run through triangles, storing edge structures and finding neighbors
-    StripEdge *edge = edges;
-    for (int i = 0; i < numTriangles; i++) {
-
-	StripTriangle *tri = &triangles[i];
-
-	// Look for a neighbor edge for each of the 3 edges. If found,
-	// mark the two triangles as neighbors and remove the neighbor
-	// edge from the list of unpaired edges. If not found, add the
-	// edge to the list.
-
-#define DO_EDGE(VA, VB, WHICH)						      \
-	edge->v1 = tri->v[VA];						      \
-	edge->v2 = tri->v[VB];						      \
-	edge->tri = tri;						      \
-	edge->which = WHICH;						      \
-	edge->next  = NULL;						      \
-	addEdge(edge);							      \
-	edge++
-
-	DO_EDGE(1, 2,  0);
-	DO_EDGE(2, 0,  1);
-	DO_EDGE(0, 1,  2);
-
-#undef DO_EDGE
+    int i, j;
+
+    // Count the corners at each vertex
+    vertexCornerStart = new int[numVertices + 1];
+    for (i = 0; i <= numVertices; i++)
+	vertexCornerStart[i] = 0;
+    for (i = 0; i < numTriangles; i++)
+	for (j = 0; j < 3; j++)
+	    vertexCornerStart[triangles[i].v[j]->uniqueID + 1]++;
+
+    // Turn the counts into starting positions
+    vertexNumUnused = new int[numVertices];
+    for (i = 0; i < numVertices; i++) {
+	vertexCornerStart[i + 1] += vertexCornerStart[i];
+	vertexNumUnused[i] = 0;
     }
 
-    // We created the edges only to set up the neighbor relationships
-    // in triangles. Now that that is done, we don't need the edges
-    // any more
-    delete [] edges;
-    delete edgeDict;
+    // Store the corners, in increasing order for each vertex
+    vertexCorners = new int[3 * numTriangles];
+    cornerPos = new int[3 * numTriangles];
+    for (i = 0; i < numTriangles; i++) {
+	for (j = 0; j < 3; j++) {
+	    int v = triangles[i].v[j]->uniqueID;
+	    int pos = vertexCornerStart[v] + vertexNumUnused[v]++;
+	    vertexCorners[pos] = 3 * i + j;
+	    cornerPos[3 * i + j] = pos;
+	}
+    }
 }
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Adds an edge to the list of edges, checking for neighbors
+// Finds adjacent triangles. Each edge is paired with the first edge
+// (in order of triangles, then edges) that runs in the opposite
+// direction between the same two vertices and has not been paired
+// yet. The unpaired edges are kept in a hash table keyed on their
+// vertices, so each edge takes constant time.
 //
 /////////////////////////////////////////////////////////////////////////////
 
 void
-IfStripper::addEdge(StripEdge *newEdge)
+IfStripper::findNeighborTriangles()
 {
-    // See if any edges like this one are already in the dictionary
-    uint32_t key = hashEdge(newEdge);
-    void *listPtr;
-    if (edgeDict->find(key, listPtr)) {
-
-	// Look through edge list for a neighbor
-	SbBool foundNeighbor = FALSE;
-	StripEdge *prevEdge = NULL;
-	for (StripEdge *edge = (StripEdge *) listPtr;
-	     edge != NULL;
-	     edge = edge->next) {
-
-	    // See if the edges are neighbors
-	    if (edge->v1 == newEdge->v2 && edge->v2 == newEdge->v1) {
-
-		// Store the neighbor relationship in both triangles
-		edge->tri->t[edge->which]	= newEdge->tri;
-		newEdge->tri->t[newEdge->which]	= edge->tri;
-
-		// Remove the neighbor edge from the dictionary
-		if (prevEdge != NULL)
-		    prevEdge->next = edge->next;
-		else {
-		    listPtr = edge->next;
-
-		    // If nothing left in list, remove the whole list
-		    // from dictionary
-		    if (listPtr == NULL)
-			edgeDict->remove(key);
-		}
-
-		// No need to keep looking
-		foundNeighbor = TRUE;
-		break;
+    // There is at most one slot per edge
+    int numEdges = 3 * numTriangles;
+    uint32_t tableSize = 16;
+    while (tableSize < (uint32_t) numEdges * 2)
+	tableSize <<= 1;
+    uint32_t mask = tableSize - 1;
+    EdgeSlot *table = new EdgeSlot[tableSize];
+    for (uint32_t s = 0; s < tableSize; s++)
+	table[s].from = -1;
+
+    int *nextEdge = new int[numEdges];
+
+    for (int i = 0; i < numTriangles; i++) {
+
+	StripTriangle *tri = &triangles[i];
+
+	// Edge 0 runs from vertex 1 to vertex 2, edge 1 from 2 to 0,
+	// and edge 2 from 0 to 1
+	for (int which = 0; which < 3; which++) {
+
+	    int id1 = tri->v[(which + 1) % 3]->uniqueID;
+	    int id2 = tri->v[(which + 2) % 3]->uniqueID;
+
+	    // Look for an unpaired edge running the other way. If
+	    // found, mark the two triangles as neighbors.
+	    EdgeSlot *slot = &table[findEdgeSlot(table, mask, id2, id1)];
+	    if (slot->from >= 0 && slot->first >= 0) {
+		int e = slot->first;
+		slot->first = nextEdge[e];
+		if (slot->first < 0)
+		    slot->last = -1;
+
+		StripTriangle *neighbor = &triangles[e / 3];
+		neighbor->t[e % 3] = tri;
+		tri->t[which] = neighbor;
+		continue;
 	    }
 
-	    prevEdge = edge;
+	    // Otherwise, add this edge to the end of its own list
+	    int e = 3 * i + which;
+	    nextEdge[e] = -1;
+	    slot = &table[findEdgeSlot(table, mask, id1, id2)];
+	    if (slot->from < 0) {
+		slot->from  = id1;
+		slot->to    = id2;
+		slot->first = -1;
+		slot->last  = -1;
+	    }
+	    if (slot->last >= 0)
+		nextEdge[slot->last] = e;
+	    else
+		slot->first = e;
+	    slot->last = e;
 	}
-
-	// Add the new edge to the end of the list if no neighbor was found
-	if (! foundNeighbor)
-	    prevEdge->next = newEdge;
     }
 
-    // If no list exists yet for this hash key, create a new one
-    else
-	edgeDict->enter(key, newEdge);
+    delete [] table;
+    delete [] nextEdge;
 }
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Hash function for edges. This function is guaranteed to return the
-// same value for two edges containing the same vertices, regardless
-// of direction; i.e., it's symmetric.
+// Returns the slot of the edge table with the given vertex IDs, or
+// the empty slot where it belongs.
 //
 /////////////////////////////////////////////////////////////////////////////
 
 uint32_t
-IfStripper::hashEdge(StripEdge *edge)
+IfStripper::findEdgeSlot(const EdgeSlot *table, uint32_t mask,
+			 int from, int to)
 {
-    // Use the unique ID in each vertex to create the hashing key.
-    // Since we have to maintain symmetry, use the smaller index first.
-    int i1 = edge->v1->uniqueID;
-    int i2 = edge->v2->uniqueID;
-    if (i2 < i1) {
-	int t = i1;
-	i1 = i2;
-	i2 = t;
-    }
+    uint32_t h = ((uint32_t) from * 73856093) ^ ((uint32_t) to * 19349663);
 
-    // Note: this function is not guaranteed to produce all unique
-    // keys (if there are > 65536 unique vertices), but that's no
-    // problem, because there is a list of edges in each hash slot.
-    return (i1 << 16) + i2;
+    uint32_t s;
+    for (s = h & mask; table[s].from >= 0; s = (s + 1) & mask)
+	if (table[s].from == from && table[s].to == to)
+	    break;
+
+    return s;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -538,6 +550,181 @@ IfStripper::createStrips()
     }
 }
 
+/////////////////////////////////////////////////////////////////////////////
+//
+// Creates strips from the connected triangles, using the CACHE
+// method. Each strip is limited to 2 less triangles than the cache
+// size, so that it uses no more vertices than the cache holds. The
+// next strip can then reuse the vertices along one side of it. Each
+// strip starts next to vertices that are in the cache, and all
+// possible directions from the starting triangle are tried. The one
+// that causes the fewest cache misses per triangle is used.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfStripper::createCacheStrips()
+{
+    IfVertexCache cache(cacheSize, numVertices);
+
+    int maxTris = cacheSize - 2;
+    if (maxTris < 1)
+	maxTris = 1;
+
+    int i;
+    createVertexCornerLists();
+    triStamp = new int[numTriangles];
+    for (i = 0; i < numTriangles; i++)
+	triStamp[i] = 0;
+    curStamp = 0;
+
+    // Two sets of buffers, one for the best strip so far and one for
+    // the strip being tried
+    StripVertex   **verts[2];
+    StripTriangle **tris[2];
+    for (i = 0; i < 2; i++) {
+	verts[i] = new StripVertex *[maxTris + 2];
+	tris[i]  = new StripTriangle *[maxTris];
+    }
+    int *ids = new int[maxTris + 2];
+
+    StripTriangle *tri;
+
+    // Repeat until there are no more unmarked triangles
+    while (chooseCacheStartTriangle(&cache, tri)) {
+
+	int best = -1, cur = 0;
+	int bestTris = 0, bestMisses = 0;
+
+	// Try each unused neighbor as the first shared edge. Try no
+	// shared edge only if there are no unused neighbors.
+	for (int shared = 0; shared < 4; shared++) {
+
+	    if (shared < 3) {
+		if (tri->t[shared] == NULL || tri->t[shared]->isUsed)
+		    continue;
+	    }
+	    else if (best >= 0)
+		break;
+
+	    curStamp++;
+	    int n = tryStrip(tri, shared, maxTris, verts[cur], tris[cur]);
+
+	    for (i = 0; i < n + 2; i++)
+		ids[i] = verts[cur][i]->uniqueID;
+	    int misses = cache.countMisses(ids, n + 2);
+
+	    // Compare misses per triangle, preferring longer strips
+	    if (best < 0 ||
+		misses * bestTris < bestMisses * n ||
+		(misses * bestTris == bestMisses * n && n > bestTris)) {
+		best       = cur;
+		bestTris   = n;
+		bestMisses = misses;
+		cur        = 1 - cur;
+	    }
+	}
+
+	// Add the best strip
+	for (i = 0; i < bestTris; i++)
+	    markTriangleUsed(tris[best][i]);
+	for (i = 0; i < bestTris + 2; i++) {
+	    vertexPtrList->append(verts[best][i]);
+	    cache.access(verts[best][i]->uniqueID);
+	}
+	vertexPtrList->append(NULL);
+    }
+
+    for (i = 0; i < 2; i++) {
+	delete [] verts[i];
+	delete [] tris[i];
+    }
+    delete [] ids;
+    delete [] triStamp;
+    delete [] vertexCornerStart;
+    delete [] vertexCorners;
+    delete [] vertexNumUnused;
+    delete [] cornerPos;
+    vertexCornerStart = NULL;
+    vertexCorners = NULL;
+    vertexNumUnused = NULL;
+    cornerPos = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Builds (but does not use) a strip starting with the given triangle
+// and first shared edge (3 if none). Returns the number of triangles.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfStripper::tryStrip(StripTriangle *tri, int shared, int maxTris,
+		     StripVertex **verts, StripTriangle **tris)
+{
+    int nv = 0, nt = 0;
+
+    // Add 3 vertices of triangle, starting with vertex opposite
+    // shared edge, the same way createStrips() does
+    switch (shared) {
+      case 0:
+	verts[nv++] = tri->v[0];
+	verts[nv++] = tri->v[1];
+	verts[nv++] = tri->v[2];
+	break;
+      case 1:
+	verts[nv++] = tri->v[1];
+	verts[nv++] = tri->v[2];
+	verts[nv++] = tri->v[0];
+	break;
+      case 2:
+      case 3:
+	verts[nv++] = tri->v[2];
+	verts[nv++] = tri->v[0];
+	verts[nv++] = tri->v[1];
+	break;
+    }
+
+    tris[nt++] = tri;
+    triStamp[tri->index] = curStamp;
+
+    if (shared == 3)
+	return nt;
+
+    SbBool oddFace = TRUE;
+
+    while (nt < maxTris) {
+
+	StripTriangle *nextTri = tri->t[shared];
+
+	if (nextTri == NULL || isTaken(nextTri))
+	    break;
+
+	if (nextTri->t[0] == tri) {
+	    verts[nv++] = nextTri->v[0];
+	    shared = (oddFace ? 2 : 1);
+	}
+	else if (nextTri->t[1] == tri) {
+	    verts[nv++] = nextTri->v[1];
+	    shared = (oddFace ? 0 : 2);
+	}
+	else if (nextTri->t[2] == tri) {
+	    verts[nv++] = nextTri->v[2];
+	    shared = (oddFace ? 1 : 0);
+	}
+	else
+	    break;
+
+	tris[nt++] = nextTri;
+	triStamp[nextTri->index] = curStamp;
+
+	tri = nextTri;
+	oddFace = ! oddFace;
+    }
+
+    return nt;
+}
+
 ////////////////////////////////////////////////////////////////////////
 //
 // Chooses and returns a good starting triangle for tstrip generation.
@@ -561,6 +748,55 @@ IfStripper::chooseStartTriangle(StripTriangle *&tri)
     return FALSE;
 }
 
+/////////////////////////////////////////////////////////////////////////////
+//
+// Chooses a starting triangle for the CACHE method. Of the unused
+// triangles around the vertices in the cache, this picks the one with
+// the most cached vertices, then the fewest unused neighbors, then
+// the oldest cached vertex, then the lowest index. Only the unused
+// triangles around each cached vertex are looked at, so this takes
+// time proportional to their number, which is small except around
+// vertices used by very many triangles. If there are none, this falls
+// back to chooseStartTriangle().
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfStripper::chooseCacheStartTriangle(const IfVertexCache *cache,
+				     StripTriangle *&tri)
+{
+    int bestScore = -1, bestCached = -1;
+    tri = NULL;
+
+    for (int i = 0; i < cache->getNumCached(); i++) {
+	int v = cache->getCached(i);
+	int start = vertexCornerStart[v];
+
+	for (int j = start; j < start + vertexNumUnused[v]; j++) {
+	    StripTriangle *t = &triangles[vertexCorners[j] / 3];
+
+	    int numCached = 0;
+	    for (int k = 0; k < 3; k++)
+		if (cache->isCached(t->v[k]->uniqueID))
+		    numCached++;
+
+	    int score = 4 * numCached + (3 - t->numUnusedNeighbors);
+	    if (score > bestScore ||
+		(score == bestScore && bestCached == i &&
+		 t->index < tri->index)) {
+		bestScore  = score;
+		bestCached = i;
+		tri = t;
+	    }
+	}
+    }
+
+    if (tri != NULL)
+	return TRUE;
+
+    return chooseStartTriangle(tri);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // Marks a triangle as used, removing it from the pending list and
@@ -578,6 +814,22 @@ IfStripper::markTriangleUsed(StripTriangle *tri)
     // Remove it from its current list
     removeTriangle(tri, tri->numUnusedNeighbors);
 
+    // Move its corners past the unused ones at each vertex, if they
+    // are being kept
+    if (vertexNumUnused != NULL) {
+	for (int k = 0; k < 3; k++) {
+	    int c = 3 * tri->index + k;
+	    int v = tri->v[k]->uniqueID;
+	    int last = vertexCornerStart[v] + --vertexNumUnused[v];
+	    int pos = cornerPos[c];
+	    int other = vertexCorners[last];
+	    vertexCorners[pos] = other;
+	    cornerPos[other] = pos;
+	    vertexCorners[last] = c;
+	    cornerPos[c] = last;
+	}
+    }
+
     // Decrement the numUnusedNeighbors in all neighbors and move them
     // to the correct list
     for (int i = 0; i < 3; i++) {
@@ -679,3 +931,28 @@ IfStripper::adjustIndices()
 	holder->stripSet->materialIndex.finishEditing();
     }
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Stores strip and vertex cache statistics in the holder.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfStripper::computeStatistics()
+{
+    IfVertexCache cache(cacheSize, numVertices);
+
+    int numStrips = 0;
+    for (int i = 0; i < vertexPtrList->getLength(); i++) {
+	StripVertex *vert = (StripVertex *) (*vertexPtrList)[i];
+	if (vert == NULL)
+	    numStrips++;
+	else
+	    cache.access(vert->uniqueID);
+    }
+
+    holder->numStrips	   = numStrips;
+    holder->numOutputTris  = numTriangles;
+    holder->numCacheMisses = cache.getNumMisses();
+}
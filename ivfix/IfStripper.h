@@ -39,6 +39,13 @@
 // IfStripper class: takes a condensed scene graph and creates longer
 // triangle strips in the SoIndexedTriangleStripSet.
 //
+// There are two methods of choosing strips. GREEDY starts each strip
+// at the triangle with the fewest unused neighbors and makes it as
+// long as possible. CACHE keeps strips short enough that the next
+// strip can reuse their vertices from a FIFO vertex cache of a given
+// size, and starts each strip next to vertices that are still in the
+// cache.
+//
 /////////////////////////////////////////////////////////////////////////////
 
 #ifndef  _IF_STRIPPER_
@@ -47,14 +54,28 @@
 #include <Inventor/SbPList.h>
 
 class IfHolder;
-class SbDict;
+class IfVertexCache;
 
 class IfStripper {
 
   public:
+    // Methods of creating strips
+    enum Method {
+	GREEDY,			// Longest strips (the default)
+	CACHE			// Best vertex cache reuse
+    };
+
     IfStripper();
     ~IfStripper();
 
+    // Sets the method used to create strips
+    void	setMethod(Method m)		{ method = m; }
+
+    // Sets the size of the FIFO vertex cache to optimize for with the
+    // CACHE method. This is also used to compute the average cache
+    // miss ratio that is stored in the IfHolder. The default is 16.
+    void	setCacheSize(int size)		{ cacheSize = size; }
+
     void	strip(IfHolder *_holder);
 
   private:
@@ -79,15 +100,9 @@ class IfStripper {
 	StripTriangle	*prev, *next;	// For doubly-linked lists
     };
 
-    // An edge of a triangle
-    struct StripEdge {
-	StripVertex	*v1, *v2;	// Two vertices of edge, in order
-	StripTriangle	*tri;		// Triangle containing edge
-	int		which;		// Which edge of triangle (0, 1, or 2)
-	StripEdge	*next;		// Used to create lists
-    };
-
     IfHolder		*holder;	// Holds most important stuff
+    Method		method;		// Method of creating strips
+    int			cacheSize;	// Vertex cache size
     int			numVertices;	// Number of distinct vertices
     int			numTriangles;	// # of triangles in original strips
     SbBool		haveMaterials;	// TRUE if material indices exist
@@ -102,7 +117,32 @@ class IfStripper {
     int			*vertexMap;
 
     StripTriangle	*triangles;	// Array of StripTriangle structures
-    SbDict		*edgeDict;	// Dictionary storing edges
+
+    // A slot in the hash table of edges that have no neighbor yet,
+    // used by findNeighborTriangles(). It holds a list (through an
+    // array of next edges) of the unpaired edges from one vertex to
+    // another, oldest first. Edge e is edge e % 3 of triangle e / 3.
+    struct EdgeSlot {
+	int		from, to;	// Unique IDs of vertices, or -1
+	int		first, last;	// First and last edge in list, or -1
+    };
+
+    // The corners of the triangles using each vertex, for the CACHE
+    // method. Corner c is vertex c % 3 of triangle c / 3. The corners
+    // at vertex i are vertexCorners[vertexCornerStart[i]] through
+    // vertexCorners[vertexCornerStart[i+1] - 1], and the first
+    // vertexNumUnused[i] of them belong to unused triangles.
+    // cornerPos[c] is the position of corner c in vertexCorners.
+    int			*vertexCornerStart;
+    int			*vertexCorners;
+    int			*vertexNumUnused;
+    int			*cornerPos;
+
+    // Used by the CACHE method to try out strips before choosing one.
+    // A triangle is part of the strip being tried if its entry in
+    // triStamp is equal to curStamp.
+    int			*triStamp;
+    int			curStamp;
 
     // List of pointers to StripVertex structures representing
     // strips. The end of a strip is indicated by a NULL pointer.
@@ -120,25 +160,48 @@ class IfStripper {
     void		createVertexList();
     void		createTriangleList();
     
+    // Finds the corners of the triangles using each vertex
+    void		createVertexCornerLists();
+
     // Finds adjacent triangles
     void		findNeighborTriangles();
+
+    // Returns the slot of the edge table with the given vertex IDs,
+    // or the empty slot where it belongs
+    static uint32_t	findEdgeSlot(const EdgeSlot *table, uint32_t mask,
+				     int from, int to);
     
     // Sets up the pending triangle lists
     void		setUpPendingTriangleLists();
 
-    // Adds an edge to the list of edges, checking for neighbors
-    void		addEdge(StripEdge *newEdge);
-
-    // Hash function for edges
-    uint32_t		hashEdge(StripEdge *edge);
-
     // Creates strips from the connected triangles
     void		createStrips();
 
+    // Does the same, using the CACHE method
+    void		createCacheStrips();
+
     // Chooses and returns a good starting triangle for tstrip
     // generation. Returns FALSE if none.
     SbBool		chooseStartTriangle(StripTriangle *&tri);
 
+    // Does the same for the CACHE method, preferring triangles that
+    // use vertices in the given cache
+    SbBool		chooseCacheStartTriangle(const IfVertexCache *cache,
+						 StripTriangle *&tri);
+
+    // Returns TRUE if the triangle is used or is in the strip being
+    // tried
+    SbBool		isTaken(const StripTriangle *tri) const
+	{ return tri->isUsed || triStamp[tri->index] == curStamp; }
+
+    // Builds (but does not use) a strip starting with the given
+    // triangle and first shared edge (3 if none). The strip is limited
+    // to maxTris triangles. The vertices and triangles of the strip
+    // are stored in the given arrays, and the number of triangles is
+    // returned.
+    int			tryStrip(StripTriangle *tri, int shared, int maxTris,
+				 StripVertex **verts, StripTriangle **tris);
+
     // Marks a triangle as used, removing it from the pending list and
     // changing the status of all neighbor triangles
     void		markTriangleUsed(StripTriangle *tri);
@@ -149,6 +212,9 @@ class IfStripper {
 
     // Changes the indices in the triangle strip
     void		adjustIndices();
+
+    // Stores strip and vertex cache statistics in the holder
+    void		computeStatistics();
 };
 
 #endif /* _IF_STRIPPER_ */
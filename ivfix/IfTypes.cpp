@@ -36,15 +36,30 @@
 
 #include <Inventor/SoLists.h>
 #include <Inventor/nodes/SoArray.h>
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/nodes/SoClipPlane.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoDrawStyle.h>
+#include <Inventor/nodes/SoEnvironment.h>
 #include <Inventor/nodes/SoFile.h>
+#include <Inventor/nodes/SoFont.h>
 #include <Inventor/nodes/SoIndexedLineSet.h>
 #include <Inventor/nodes/SoLOD.h>
 #include <Inventor/nodes/SoLevelOfDetail.h>
+#include <Inventor/nodes/SoLight.h>
+#include <Inventor/nodes/SoLightModel.h>
 #include <Inventor/nodes/SoLineSet.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
 #include <Inventor/nodes/SoMultipleCopy.h>
+#include <Inventor/nodes/SoNormalBinding.h>
 #include <Inventor/nodes/SoPointSet.h>
 #include <Inventor/nodes/SoShape.h>
+#include <Inventor/nodes/SoShapeHints.h>
 #include <Inventor/nodes/SoText2.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoTexture2Transform.h>
+#include <Inventor/nodes/SoTextureCoordinateBinding.h>
 #include <Inventor/nodes/SoWWWAnchor.h>
 #include <Inventor/nodes/SoWWWInline.h>
 
@@ -116,3 +131,30 @@ IfTypes::isShape(const SoType &type)
 	    type.isDerivedFrom(SoMultipleCopy::getClassTypeId())	||
 	    type.isDerivedFrom(SoWWWInline::getClassTypeId()));
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns TRUE if the given type is a property whose effect depends
+// only on its field values.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfTypes::isInternableType(const SoType &type)
+{
+    return (type.isDerivedFrom(SoCamera::getClassTypeId())		||
+	    type.isDerivedFrom(SoClipPlane::getClassTypeId())		||
+	    type.isDerivedFrom(SoComplexity::getClassTypeId())		||
+	    type.isDerivedFrom(SoDrawStyle::getClassTypeId())		||
+	    type.isDerivedFrom(SoEnvironment::getClassTypeId())		||
+	    type.isDerivedFrom(SoFont::getClassTypeId())			||
+	    type.isDerivedFrom(SoLight::getClassTypeId())			||
+	    type.isDerivedFrom(SoLightModel::getClassTypeId())		||
+	    type.isDerivedFrom(SoMaterial::getClassTypeId())		||
+	    type.isDerivedFrom(SoMaterialBinding::getClassTypeId())	||
+	    type.isDerivedFrom(SoNormalBinding::getClassTypeId())		||
+	    type.isDerivedFrom(SoShapeHints::getClassTypeId())		||
+	    type.isDerivedFrom(SoTexture2::getClassTypeId())		||
+	    type.isDerivedFrom(SoTexture2Transform::getClassTypeId())	||
+	    type.isDerivedFrom(SoTextureCoordinateBinding::getClassTypeId()));
+}
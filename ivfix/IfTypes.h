@@ -64,6 +64,11 @@ class IfTypes {
 
     // Returns TRUE if the given type should be considered a shape
     static SbBool	isShape(const SoType &type);
+
+    // Returns TRUE if the given type is a property whose effect
+    // depends only on its field values, so that nodes of the type
+    // with the same values can be replaced by one of them
+    static SbBool	isInternableType(const SoType &type);
 };
 
 #endif /* _IF_TYPES_ */
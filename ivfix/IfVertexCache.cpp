@@ -0,0 +1,175 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include "IfAssert.h"
+#include "IfVertexCache.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfVertexCache::IfVertexCache(int cacheSize, int numVertices)
+{
+    ASSERT(cacheSize > 0);
+
+    size     = cacheSize;
+    numVerts = numVertices;
+
+    stamp      = new int[numVerts];
+    entries    = new int[size];
+    trialMark  = new int[numVerts];
+    trialStamp = new int[numVerts];
+
+    for (int i = 0; i < numVerts; i++)
+	trialMark[i] = 0;
+    trialID = 0;
+
+    reset();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfVertexCache::~IfVertexCache()
+{
+    delete [] stamp;
+    delete [] entries;
+    delete [] trialMark;
+    delete [] trialStamp;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Empties the cache and clears the miss count.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void
+IfVertexCache::reset()
+{
+    for (int i = 0; i < numVerts; i++)
+	stamp[i] = 0;
+    clock = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Sends a vertex through the cache. Returns TRUE if it was a miss.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+SbBool
+IfVertexCache::access(int vertex)
+{
+    ASSERT(vertex >= 0 && vertex < numVerts);
+
+    if (isCached(vertex))
+	return FALSE;
+
+    // The clock counts misses, so a vertex stays in the cache until
+    // size more vertices have been loaded after it
+    entries[clock % size] = vertex;
+    stamp[vertex] = ++clock;
+
+    return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the number of misses that sending the given vertices
+// through the cache would cause, without changing the cache.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfVertexCache::countMisses(const int *vertices, int num)
+{
+    // Use a new trial ID so marks from earlier trials are ignored
+    trialID++;
+
+    int numMisses = 0;
+
+    for (int i = 0; i < num; i++) {
+	int v = vertices[i];
+	ASSERT(v >= 0 && v < numVerts);
+
+	SbBool cached;
+
+	// Vertices loaded earlier in this trial
+	if (trialMark[v] == trialID)
+	    cached = (numMisses - trialStamp[v] < size);
+
+	// Vertices in the real cache age by one for each miss so far
+	else
+	    cached = (stamp[v] > 0 && clock + numMisses - stamp[v] < size);
+
+	if (! cached) {
+	    trialMark[v]  = trialID;
+	    trialStamp[v] = ++numMisses;
+	}
+    }
+
+    return numMisses;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the number of misses when sending the given indices
+// through an empty cache.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfVertexCache::countMisses(int cacheSize, const int32_t *indices,
+			   int numIndices)
+{
+    int i, maxIndex = -1;
+    for (i = 0; i < numIndices; i++)
+	if (indices[i] > maxIndex)
+	    maxIndex = indices[i];
+
+    IfVertexCache cache(cacheSize, maxIndex + 1);
+    for (i = 0; i < numIndices; i++)
+	if (indices[i] >= 0)
+	    cache.access(indices[i]);
+
+    return cache.getNumMisses();
+}
@@ -0,0 +1,106 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfVertexCache class: simulates a FIFO post-transform vertex cache of
+// a given size. This is used to measure how well an ordering of
+// vertices reuses the cache (the average cache miss ratio, or ACMR,
+// is the number of misses per triangle), and to help choose orderings
+// that reuse it well. All operations take constant time per vertex.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_VERTEX_CACHE_
+#define  _IF_VERTEX_CACHE_
+
+#include <Inventor/SbBasic.h>
+
+class IfVertexCache {
+
+  public:
+    // Creates an empty cache with the given number of entries, for
+    // vertices numbered 0 through numVertices-1
+    IfVertexCache(int cacheSize, int numVertices);
+    ~IfVertexCache();
+
+    // Empties the cache and clears the miss count
+    void		reset();
+
+    // Sends a vertex through the cache. Returns TRUE if it was a miss
+    // (which loads the vertex into the cache).
+    SbBool		access(int vertex);
+
+    // Returns TRUE if the vertex is currently in the cache
+    SbBool		isCached(int vertex) const
+	{ return (stamp[vertex] > 0 && clock - stamp[vertex] < size); }
+
+    // Returns the number of vertices currently in the cache, and the
+    // i'th of them. Index 0 is the oldest one, which is the next to
+    // be dropped.
+    int			getNumCached() const
+	{ return (clock < size ? clock : size); }
+    int			getCached(int i) const
+	{ return entries[(clock - getNumCached() + i) % size]; }
+
+    // Returns the number of misses that sending the given vertices
+    // through the cache would cause, without changing the cache
+    int			countMisses(const int *vertices, int num);
+
+    // Returns the number of misses so far
+    int			getNumMisses() const	{ return clock; }
+
+    // Returns the number of misses when sending a triangle strip set
+    // or face set described by the given indices through an empty
+    // cache. Negative indices separate strips or faces and are
+    // skipped.
+    static int		countMisses(int cacheSize, const int32_t *indices,
+				    int numIndices);
+
+  private:
+    int			size;		// Number of cache entries
+    int			numVerts;	// Number of possible vertices
+    int			clock;		// Number of misses so far
+    int			*stamp;		// Clock when vertex loaded (or 0)
+    int			*entries;	// Ring of cached vertices
+
+    // Used by countMisses() to track vertices loaded during the trial
+    int			trialID;
+    int			*trialMark;
+    int			*trialStamp;
+};
+
+#endif /* _IF_VERTEX_CACHE_ */
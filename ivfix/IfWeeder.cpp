@@ -34,6 +34,8 @@
  *
  */
 
+#include <string.h>
+
 #include <Inventor/actions/SoSearchAction.h>
 #include <Inventor/nodes/SoMaterial.h>
 #include <Inventor/nodes/SoSeparator.h>
@@ -54,6 +56,9 @@
 
 IfWeeder::IfWeeder()
 {
+    numMaterialValues  = 0;
+    numUniqueMaterials = 0;
+    numUsedMaterials   = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -290,312 +295,210 @@ IfWeeder::weedMaterial(SoNode *root, IfWeederMaterialEntry *entry)
     }
 
     // Remove all material values from the material node that are
-    // not used by any dependent shapes. Adjust the indices in the
-    // dependent shapes accordingly.
-    removeDuplicateMaterials(entry);
-
-    // Now remove all material values that are not used by any
-    // dependent shapes. Again, adjust the indices in the dependent
-    // shapes.
-    removeUnusedMaterials(entry);
+    // duplicates of others or are not used by any dependent shapes.
+    // Adjust the indices in the dependent shapes accordingly.
+    removeDuplicateAndUnusedMaterials(entry);
 }
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Finds and removes duplicate materials, adjusting material
-// indices in all dependent shapes.
+// Finds the first material value that is the same as each value of
+// the given material.
+//
+// The parts of each value that can differ (the diffuse color, and
+// the other fields only if they have more than one value) are packed
+// into one contiguous buffer of keys, one key per value. The keys are
+// compared by their bits, so they can be hashed and compared a word
+// at a time. They are looked up in an open-addressing hash table that
+// holds the index of the first value with each key.
 //
 /////////////////////////////////////////////////////////////////////////////
 
-void
-IfWeeder::removeDuplicateMaterials(IfWeederMaterialEntry *entry)
+int
+IfWeeder::findDuplicateMaterials(const SoMaterial *material, int *canonical)
 {
-    ////////////////////////////////////////////
-    //
-    // To find duplicate materials, we create a hash table of material
-    // values. Each entry in the hash table contains an index into the
-    // material node's values. The entries in the table use the
-    // material values as the hash key, so that duplicate materials
-    // will be in the same slot in the table. If we find a duplicate,
-    // we store that fact in a table of index duplicates. For example,
-    // if material index 32 is the same as material index 21, we store
-    // 21 in entry 32 in the duplicates array. When we are done with
-    // the hash table, the duplicates array will tell us which
-    // material values we need to keep in the material node and also
-    // how to adjust the material indices in the SoIndexedShapes.
-    //
+    int numMaterials = material->diffuseColor.getNum();
 
-    // Instances of this structure is stored in the hash table.
-    struct IfWeederMaterialInfo {
-	int			index;	// Index of material value
-	IfWeederMaterialInfo	*next;	// For making lists in the hash table
+    const SoMFColor *colorFields[4] = {
+	&material->diffuseColor,  &material->ambientColor,
+	&material->specularColor, &material->emissiveColor,
+    };
+    const SoMFFloat *floatFields[2] = {
+	&material->shininess, &material->transparency,
     };
 
-    // Access the fields of the material node for faster referencing
-    curMaterial = entry->material;
-    ambi = curMaterial->ambientColor.getValues(0);
-    diff = curMaterial->diffuseColor.getValues(0);
-    spec = curMaterial->specularColor.getValues(0);
-    emis = curMaterial->emissiveColor.getValues(0);
-    shin = curMaterial->shininess.getValues(0);
-    tran = curMaterial->transparency.getValues(0);
-
-    int numMaterials = curMaterial->diffuseColor.getNum();
-
-    // Create an array of structures to insert into the table
-    IfWeederMaterialInfo *infos = new IfWeederMaterialInfo[numMaterials];
-
-    // Create an array to hold the duplicate info
-    int *duplicates = new int [numMaterials];
-
-    // Create a hash table of a reasonable size
-    SbDict *hashTable = new SbDict(1 + numMaterials / 4);
-
-    // Add each material index to the hash table, looking for
-    // duplicates
-    int i, numMatches = 0;
-
+    // Figure out the number of words in each key
+    int f, i, stride = 0;
+    for (f = 0; f < 4; f++)
+	if (f == 0 || colorFields[f]->getNum() > 1)
+	    stride += 3;
+    for (f = 0; f < 2; f++)
+	if (floatFields[f]->getNum() > 1)
+	    stride++;
+
+    // Pack the keys, one field at a time. A field with fewer values
+    // than the diffuse color repeats its last value.
+    uint32_t *keys = new uint32_t[numMaterials * stride];
+    int offset = 0;
+    for (f = 0; f < 4; f++) {
+	int num = colorFields[f]->getNum();
+	if (f > 0 && num <= 1)
+	    continue;
+	const SbColor *colors = colorFields[f]->getValues(0);
+	for (i = 0; i < numMaterials; i++)
+	    memcpy(&keys[i * stride + offset],
+		   colors[i < num ? i : num - 1].getValue(), 3 * sizeof(float));
+	offset += 3;
+    }
+    for (f = 0; f < 2; f++) {
+	int num = floatFields[f]->getNum();
+	if (num <= 1)
+	    continue;
+	const float *floats = floatFields[f]->getValues(0);
+	for (i = 0; i < numMaterials; i++)
+	    memcpy(&keys[i * stride + offset],
+		   &floats[i < num ? i : num - 1], sizeof(float));
+	offset++;
+    }
+    ASSERT(offset == stride);
+
+    // The table is a power of 2 at least twice the number of values,
+    // so probe sequences stay short
+    int tableSize = 1;
+    while (tableSize < 2 * numMaterials)
+	tableSize <<= 1;
+    int *table = new int[tableSize];
+    for (i = 0; i < tableSize; i++)
+	table[i] = -1;
+
+    int numUnique = 0;
     for (i = 0; i < numMaterials; i++) {
-
-	// Assume that there is no duplicate. We'll overwrite this if
-	// we find one below
-	duplicates[i] = -1;
-
-	// Prepare an info instance to insert
-	infos[i].index = i;
-	infos[i].next  = NULL;
-
-	// Compute a hash value for the material based on the material
-	// values
-	uint32_t hashKey = computeMaterialHashKey(i);
-
-	// See if there is anything in the hash table with that key
-	void *entry;
-	if (hashTable->find(hashKey, entry)) {
-	    // Look for an exact match
-	    IfWeederMaterialInfo *info, *prevInfo = NULL;
-	    for (info = (IfWeederMaterialInfo *) entry;
-		 info != NULL; info = info->next) {
-
-		// If there's a match, record the duplicate
-		if (isSameMaterial(info->index, i)) {
-		    duplicates[i] = info->index;
-		    numMatches++;
-		    break;
-		}
-
-		prevInfo = info;
+	const uint32_t *key = &keys[i * stride];
+
+	// FNV-1a on words
+	uint32_t hash = 2166136261u;
+	for (int k = 0; k < stride; k++)
+	    hash = (hash ^ key[k]) * 16777619u;
+	hash ^= hash >> 16;
+
+	int slot = hash & (tableSize - 1);
+	while (TRUE) {
+	    int j = table[slot];
+	    if (j < 0) {
+		table[slot] = i;
+		canonical[i] = i;
+		numUnique++;
+		break;
 	    }
-
-	    // If we didn't find a duplicate, add a new entry to the
-	    // end of the list
-	    if (duplicates[i] == -1) {
-		ASSERT(prevInfo != NULL);
-		prevInfo->next = &infos[i];
+	    if (memcmp(&keys[j * stride], key, stride * sizeof(uint32_t)) == 0) {
+		canonical[i] = j;
+		break;
 	    }
+	    slot = (slot + 1) & (tableSize - 1);
 	}
-
-	// If there was nothing in the table for this key, add a new entry
-	else
-	    hashTable->enter(hashKey, &infos[i]);
     }
 
-    // We're done with the hash table
-    delete hashTable;
-    delete [] infos;
+    delete [] table;
+    delete [] keys;
 
-    // Now we can adjust the material indices in the shapes affected
-    // by the material. Don't bother doing this unless we weeded at
-    // least one material.
-    if (numMatches > 0) {
-
-	for (i = 0; i < entry->shapes.getLength(); i++) { 
-
-	    // Adjust material indices to use only original materials,
-	    // not duplicates
-	    SoIndexedShape *iShape = (SoIndexedShape *) entry->shapes[i];
-	    int num = iShape->materialIndex.getNum();
-	    int32_t *m = iShape->materialIndex.startEditing();
-	    for (int i = 0; i < num; i++) {
-
-		// If the material index is off the end, cycle it
-		if (m[i] >= numMaterials)
-		    m[i] %= numMaterials;
-
-		// Now check for duplicates
-		if (m[i] >= 0 && duplicates[m[i]] != -1)
-		    m[i] = duplicates[m[i]];
-	    }
-	    iShape->materialIndex.finishEditing();
-	}
-    }
-
-    delete [] duplicates;
+    return numUnique;
 }
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Computes a hash key for the material value with the given index.
+// Removes duplicate and unused material values from the material in
+// the given entry, and updates the indices in all dependent shapes.
 //
-/////////////////////////////////////////////////////////////////////////////
-
-uint32_t
-IfWeeder::computeMaterialHashKey(int index)
-{
-    // Just use the diffuse color to compute a key, since it's most
-    // likely to vary between materials
-
-    // Since we care only about exact matches, we can use any hash
-    // function we like here. Just pick one that distributes the
-    // materials in the range 0-10000. We can do this because we know
-    // the color values range from 0 to 1.
-
-    return (uint32_t) (diff[index][0] * 8871 +
-		       diff[index][1] * 1104 +
-		       diff[index][2] *   25);
-}
-
-/////////////////////////////////////////////////////////////////////////////
-//
-// Returns TRUE if the two material values with the given indices
-// are the same.
-//
-/////////////////////////////////////////////////////////////////////////////
-
-SbBool
-IfWeeder::isSameMaterial(int i1, int i2)
-{
-    // Trivial case of same indices
-    if (i1 == i2)
-	return TRUE;
-
-    // Diffuse colors always have to be the same
-    if (diff[i1] != diff[i2])
-	return FALSE;
-
-#define TEST_FIELD(FIELD,VAR)						      \
-    if (curMaterial->FIELD.getNum() > 1 && VAR[i1] != VAR[i2])		      \
-	return FALSE
-
-    // The rest depends on what varies
-    TEST_FIELD(ambientColor,  ambi);
-    TEST_FIELD(specularColor, spec);
-    TEST_FIELD(emissiveColor, emis);
-    TEST_FIELD(shininess,     shin);
-    TEST_FIELD(transparency,  tran);
-
-#undef TEST_FIELD
-
-    // If we got here, they're the same
-    return TRUE;
-}
-
-/////////////////////////////////////////////////////////////////////////////
-//
-// Removes any unused material values and updates the indices in all
-// dependent shapes.
+// Each value is mapped to the first value that is the same as it, and
+// the shapes are scanned once to see which of those are used. A
+// single table then maps each old index to its new one, and it is
+// applied to the indices of each shape in one pass.
 //
 /////////////////////////////////////////////////////////////////////////////
 
 void
-IfWeeder::removeUnusedMaterials(IfWeederMaterialEntry *entry)
+IfWeeder::removeDuplicateAndUnusedMaterials(IfWeederMaterialEntry *entry)
 {
     SoMaterial *material = entry->material;
     int numMaterials = material->diffuseColor.getNum();
     if (numMaterials == 0)
 	return;
 
+    int *canonical = new int[numMaterials];
+    int numUnique = findDuplicateMaterials(material, canonical);
+
     ////////////////////////////////////////////
     //
     // Scan the lists of material indices in each shape to see which
-    // (and how many) materials are used. Store the results in an
-    // array of flags and a counter.
+    // distinct materials are used. Material indices off the end
+    // cycle around.
 
-    int i, numUsed = 0;
+    int i, j;
     SbBool *materialUsed = new SbBool[numMaterials];
     for (i = 0; i < numMaterials; i++)
 	materialUsed[i] = FALSE;
-    for (i = 0; i < entry->shapes.getLength(); i++) { 
+
+    for (i = 0; i < entry->shapes.getLength(); i++) {
 	SoIndexedShape *iShape = (SoIndexedShape *) entry->shapes[i];
 	int numIndices = iShape->materialIndex.getNum();
-	const int32_t *oldIndices = iShape->materialIndex.getValues(0);
-	if (numIndices == 1) {
+	const int32_t *indices = iShape->materialIndex.getValues(0);
 
-	    // If there is only one material index, that means the
-	    // shape uses overall material binding, so we can set the
-	    // materialIndex field to the default value and skip the
-	    // shape.
-	    if (! materialUsed[0]) {
-		materialUsed[0] = TRUE;
-		numUsed++;
-	    }
-	    iShape->materialIndex = -1;
-	    iShape->materialIndex.setDefault(TRUE);
+	// If there is only one material index, that means the shape
+	// uses overall material binding, which uses the first value
+	if (numIndices == 1) {
+	    materialUsed[0] = TRUE;
 	    continue;
 	}
-	for (int j = 0; j < numIndices; j++) {
-	    int mi = oldIndices[j];
-	    // The material index should have already been brought
-	    // into the correct range
-	    ASSERT(mi < numMaterials);
-	    if (mi >= 0 && ! materialUsed[mi]) {
-		materialUsed[mi] = TRUE;
-		numUsed++;
-	    }
-	}
-    }
 
-    // If all materials are used, stop
-    ASSERT(numUsed <= numMaterials);
-    if (numUsed == numMaterials) {
-	delete [] materialUsed;
-	return;
+	for (j = 0; j < numIndices; j++)
+	    if (indices[j] >= 0)
+		materialUsed[canonical[indices[j] % numMaterials]] = TRUE;
     }
 
     ////////////////////////////////////////////
     //
-    // Set up an array of correspondences from old material indices
-    // to new ones. Store -1 for those materials that are not used.
+    // Set up the table from old material indices to new ones. The
+    // used distinct values keep their order. Duplicates map to the
+    // new index of the value they duplicate, and unused values to -1.
 
-    int *materialIndex = new int[numMaterials];
-    int curNewIndex = 0;
+    int *remap = new int[numMaterials];
+    int numUsed = 0;
     for (i = 0; i < numMaterials; i++) {
-	if (materialUsed[i])
-	    materialIndex[i] = curNewIndex++;
+	if (canonical[i] == i)
+	    remap[i] = (materialUsed[i] ? numUsed++ : -1);
 	else
-	    materialIndex[i] = -1;
+	    remap[i] = remap[canonical[i]];
     }
-    ASSERT(curNewIndex == numUsed);
+
+    numMaterialValues  += numMaterials;
+    numUniqueMaterials += numUnique;
+    numUsedMaterials   += numUsed;
 
     ////////////////////////////////////////////
     //
-    // Update the material indices in the shapes
+    // Update the material indices in the shapes. Shapes with overall
+    // binding get the default index.
+
+    SbBool changed = (numUsed < numMaterials);
 
-    for (i = 0; i < entry->shapes.getLength(); i++) { 
+    for (i = 0; i < entry->shapes.getLength(); i++) {
 	SoIndexedShape *iShape = (SoIndexedShape *) entry->shapes[i];
 	int numIndices = iShape->materialIndex.getNum();
+
 	if (numIndices == 1) {
+	    iShape->materialIndex = -1;
+	    iShape->materialIndex.setDefault(TRUE);
+	    continue;
+	}
 
-	    // If there is only one material index and its value is 0
-	    // or default, that means the shape uses overall material
-	    // binding, so we can skip the shape.
-	    if (iShape->materialIndex.isDefault() ||
-		iShape->materialIndex[0] == 0)
-		continue;
+	if (! changed)
+	    continue;
 
-	    numIndices = iShape->coordIndex.getNum();
-	    iShape->materialIndex.setValues(0, numIndices,
-					    iShape->coordIndex.getValues(0));
-	}
-	int32_t *newIndices = iShape->materialIndex.startEditing();
-	for (i = 0; i < numIndices; i++) {
-	    int mi = newIndices[i];
-	    if (mi >= 0) {
-		// The material index should have already been brought
-		// into the correct range
-		ASSERT(mi < numMaterials);
-		newIndices[i] = materialIndex[mi];
-		ASSERT(newIndices[i] >= 0);
+	int32_t *indices = iShape->materialIndex.startEditing();
+	for (j = 0; j < numIndices; j++) {
+	    if (indices[j] >= 0) {
+		indices[j] = remap[indices[j] % numMaterials];
+		ASSERT(indices[j] >= 0);
 	    }
 	}
 	iShape->materialIndex.finishEditing();
@@ -604,52 +507,44 @@ IfWeeder::removeUnusedMaterials(IfWeederMaterialEntry *entry)
     ////////////////////////////////////////////
     //
     // Now we need to compress the material values themselves. Save
-    // the existing fields, then copy the needed values into the real
+    // the existing fields, then copy the kept values into the real
     // fields. Do each field that has more than 1 value.
     //
 
-    SoMFColor saveColors;
-    SoMFFloat saveFloats;
-    saveColors.setContainer(NULL);
-    saveFloats.setContainer(NULL);
-
-#define COMPRESS_COLOR(FIELD)						      \
-    if (material->FIELD.getNum() > 1) {					      \
-	saveColors = material->FIELD;					      \
-	material->FIELD.setNum(numUsed);				      \
-	const SbColor *oldColors = saveColors.getValues(0);		      \
-	SbColor *newColors = material->FIELD.startEditing();		      \
-	curNewIndex = 0;						      \
-	for (i = 0; i < numMaterials; i++)				      \
-	    if (materialUsed[i])					      \
-		newColors[curNewIndex++] = oldColors[i];		      \
-	material->FIELD.finishEditing();				      \
-    }
+    if (changed) {
+	SoMFColor saveColors;
+	SoMFFloat saveFloats;
+	saveColors.setContainer(NULL);
+	saveFloats.setContainer(NULL);
+	int curNewIndex;
+
+#define COMPRESS_FIELD(FIELD, SAVE, TYPE)				      \
+	if (material->FIELD.getNum() > 1) {				      \
+	    SAVE = material->FIELD;					      \
+	    int num = SAVE.getNum();					      \
+	    material->FIELD.setNum(numUsed);				      \
+	    const TYPE *oldValues = SAVE.getValues(0);			      \
+	    TYPE *newValues = material->FIELD.startEditing();		      \
+	    curNewIndex = 0;						      \
+	    for (i = 0; i < numMaterials; i++)				      \
+		if (canonical[i] == i && materialUsed[i])		      \
+		    newValues[curNewIndex++] =				      \
+			oldValues[i < num ? i : num - 1];		      \
+	    material->FIELD.finishEditing();				      \
+	}
 
-#define COMPRESS_FLOAT(FIELD)						      \
-    if (material->FIELD.getNum() > 1) {					      \
-	saveFloats = material->FIELD;					      \
-	material->FIELD.setNum(numUsed);				      \
-	const float *oldFloats = saveFloats.getValues(0);		      \
-	float *newFloats = material->FIELD.startEditing();		      \
-	curNewIndex = 0;						      \
-	for (i = 0; i < numMaterials; i++)				      \
-	    if (materialUsed[i])					      \
-		newFloats[curNewIndex++] = oldFloats[i];		      \
-	material->FIELD.finishEditing();				      \
-    }
+	COMPRESS_FIELD(ambientColor,  saveColors, SbColor);
+	COMPRESS_FIELD(diffuseColor,  saveColors, SbColor);
+	COMPRESS_FIELD(specularColor, saveColors, SbColor);
+	COMPRESS_FIELD(emissiveColor, saveColors, SbColor);
+	COMPRESS_FIELD(shininess,     saveFloats, float);
+	COMPRESS_FIELD(transparency,  saveFloats, float);
 
-    COMPRESS_COLOR(ambientColor);
-    COMPRESS_COLOR(diffuseColor);
-    COMPRESS_COLOR(specularColor);
-    COMPRESS_COLOR(emissiveColor);
-    COMPRESS_FLOAT(shininess);
-    COMPRESS_FLOAT(transparency);
+#undef COMPRESS_FIELD
+    }
 
     // Clean up
+    delete [] canonical;
     delete [] materialUsed;
-    delete [] materialIndex;
-
-#undef COMPRESS_COLOR
-#undef COMPRESS_FLOAT
+    delete [] remap;
 }
@@ -44,6 +44,7 @@
 #ifndef  _IF_WEEDER_
 #define  _IF_WEEDER_
 
+class  SoMaterial;
 class  SoNode;
 struct IfWeederMaterialEntry;
 
@@ -55,18 +56,18 @@ class IfWeeder {
 
     void	weed(SoNode *root);
 
+    // Returns the number of material values in the weeded SoMaterial
+    // nodes before weeding, the number left after removing duplicates,
+    // and the number left after also removing unused ones
+    int		getNumMaterialValues() const	{ return numMaterialValues; }
+    int		getNumUniqueMaterials() const	{ return numUniqueMaterials; }
+    int		getNumUsedMaterials() const	{ return numUsedMaterials; }
+
   private:
     SbPList	*materialList;		// Stores materials & dependent shapes
-
-    // These are all used during removeDuplicateMaterials. They save
-    // the components of an SoMaterial being weeded.
-    SoMaterial		*curMaterial;
-    const SbColor	*ambi;
-    const SbColor	*diff;
-    const SbColor	*spec;
-    const SbColor	*emis;
-    const float		*shin;
-    const float		*tran;
+    int		numMaterialValues;	// Statistics for all materials
+    int		numUniqueMaterials;
+    int		numUsedMaterials;
 
     // This weeds out values in SoMaterial nodes that are not used by
     // any shape. It also removes duplicate material values.
@@ -79,20 +80,16 @@ class IfWeeder {
     // on them
     void	findMaterialsAndShapes(SoNode *root);
 
-    // Finds and removes duplicate materials, adjusting material
-    // indices in all dependent shapes
-    void	removeDuplicateMaterials(IfWeederMaterialEntry *entry);
-
-    // Computes a hash key for the material value with the given index
-    uint32_t	computeMaterialHashKey(int index);
-
-    // Returns TRUE if the two material values with the given indices
-    // are the same.
-    SbBool	isSameMaterial(int i1, int i2);
+    // Finds the first material value that is the same as each value
+    // of the given material, storing its index in canonical[]. Returns
+    // the number of distinct values.
+    static int	findDuplicateMaterials(const SoMaterial *material,
+				       int *canonical);
 
-    // Removes any unused material values and updates the indices in
-    // all dependent shapes
-    void	removeUnusedMaterials(IfWeederMaterialEntry *entry);
+    // Removes duplicate and unused material values from the material
+    // in the given entry, and updates the indices in all dependent
+    // shapes
+    void	removeDuplicateAndUnusedMaterials(IfWeederMaterialEntry *entry);
 };
 
 #endif /* _IF_WEEDER_ */
@@ -0,0 +1,226 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+#include <math.h>
+
+#include <Inventor/SbBox.h>
+#include <Inventor/fields/SoMFVec3f.h>
+
+#include "IfAssert.h"
+#include "IfWelder.h"
+
+// Returns TRUE if the given value is neither infinite nor NaN
+static inline SbBool
+isFinite(float f)
+{
+    return (f - f == 0.0f);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Constructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfWelder::IfWelder(float _tolerance)
+{
+    tolerance = _tolerance;
+    cells = NULL;
+    next  = NULL;
+    mask  = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Destructor.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+IfWelder::~IfWelder()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Welds the coordinates in the given field. Returns the number of
+// coordinates that were welded.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int
+IfWelder::weld(SoMFVec3f *coords, int32_t *newIndex)
+{
+    ASSERT(tolerance > 0.0);
+
+    int numCoords = coords->getNum();
+    SbVec3f *c = coords->startEditing();
+
+    // Find the extent of the finite coordinates so cell positions are
+    // relative to the minimum corner. Coordinates that are not finite
+    // are left out, since they would make the extent infinite.
+    SbBox3f box;
+    int i;
+    for (i = 0; i < numCoords; i++)
+	if (isFinite(c[i][0]) && isFinite(c[i][1]) && isFinite(c[i][2]))
+	    box.extendBy(c[i]);
+
+    // If none are finite, there is nothing to weld
+    if (box.isEmpty()) {
+	coords->finishEditing();
+	for (i = 0; i < numCoords; i++)
+	    newIndex[i] = i;
+	return 0;
+    }
+
+    const SbVec3f &min = box.getMin();
+
+    // If the cells would be so small that their positions overflow,
+    // make them bigger. This can only make the search slower.
+    float cellSize = tolerance;
+    SbVec3f size;
+    box.getSize(size[0], size[1], size[2]);
+    for (i = 0; i < 3; i++)
+	while (size[i] / cellSize > 1.0e9)
+	    cellSize *= 2.0;
+    float invCellSize = 1.0f / cellSize;
+    float tol2 = tolerance * tolerance;
+
+    // There is at most one cell per coordinate
+    uint32_t tableSize = 16;
+    while (tableSize < (uint32_t) numCoords * 2)
+	tableSize <<= 1;
+    mask = tableSize - 1;
+    cells = new Cell[tableSize];
+    for (uint32_t s = 0; s < tableSize; s++)
+	cells[s].first = -1;
+
+    next = new int32_t[numCoords];
+
+    int numKept = 0;
+
+    for (i = 0; i < numCoords; i++) {
+
+	const SbVec3f &p = c[i];
+
+	// Coordinates that are not finite can't be placed in the grid,
+	// so they are always kept
+	if (! (isFinite(p[0]) && isFinite(p[1]) && isFinite(p[2]))) {
+	    c[numKept] = p;
+	    newIndex[i] = numKept++;
+	    continue;
+	}
+
+	int32_t cx = (int32_t) floor((p[0] - min[0]) * invCellSize);
+	int32_t cy = (int32_t) floor((p[1] - min[1]) * invCellSize);
+	int32_t cz = (int32_t) floor((p[2] - min[2]) * invCellSize);
+
+	// Look for a kept coordinate within the tolerance in this
+	// cell or any of its neighbors
+	int found = -1;
+	for (int dx = -1; dx <= 1 && found < 0; dx++) {
+	    for (int dy = -1; dy <= 1 && found < 0; dy++) {
+		for (int dz = -1; dz <= 1 && found < 0; dz++) {
+		    uint32_t s = findCell(cx + dx, cy + dy, cz + dz);
+		    for (int k = cells[s].first; k >= 0; k = next[k]) {
+			if ((c[k] - p).sqrLength() <= tol2) {
+			    found = k;
+			    break;
+			}
+		    }
+		}
+	    }
+	}
+
+	if (found >= 0) {
+	    newIndex[i] = found;
+	    continue;
+	}
+
+	// Keep this one, adding it to the end of its cell's list so
+	// that earlier coordinates are found first
+	c[numKept] = p;
+	newIndex[i] = numKept;
+
+	uint32_t s = findCell(cx, cy, cz);
+	next[numKept] = -1;
+	if (cells[s].first < 0) {
+	    cells[s].x = cx;
+	    cells[s].y = cy;
+	    cells[s].z = cz;
+	    cells[s].first = numKept;
+	}
+	else {
+	    int k = cells[s].first;
+	    while (next[k] >= 0)
+		k = next[k];
+	    next[k] = numKept;
+	}
+
+	numKept++;
+    }
+
+    coords->finishEditing();
+    coords->setNum(numKept);
+
+    delete [] cells;
+    delete [] next;
+    cells = NULL;
+    next  = NULL;
+
+    return numCoords - numKept;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Returns the table slot of the given cell, or the empty slot where
+// it belongs.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+IfWelder::findCell(int32_t x, int32_t y, int32_t z) const
+{
+    uint32_t h = ((uint32_t) x * 73856093) ^
+		 ((uint32_t) y * 19349663) ^
+		 ((uint32_t) z * 83492791);
+
+    uint32_t s;
+    for (s = h & mask; cells[s].first >= 0; s = (s + 1) & mask)
+	if (cells[s].x == x && cells[s].y == y && cells[s].z == z)
+	    break;
+
+    return s;
+}
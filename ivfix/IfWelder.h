@@ -0,0 +1,86 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// IfWelder class: merges coordinates that lie within a given distance
+// of each other. Coordinates are processed in order, and each one is
+// either kept or welded to the first kept coordinate found within the
+// tolerance. Kept coordinates are stored in a uniform grid with cells
+// the size of the tolerance, so only the 27 cells around a coordinate
+// have to be searched.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef  _IF_WELDER_
+#define  _IF_WELDER_
+
+#include <Inventor/SbLinear.h>
+
+class SoMFVec3f;
+
+class IfWelder {
+
+  public:
+    IfWelder(float tolerance);
+    ~IfWelder();
+
+    // Welds the coordinates in the given field, which is changed to
+    // hold only the kept coordinates (in their original order). The
+    // passed array, which must have room for one entry per original
+    // coordinate, is filled in with the new index of each original
+    // coordinate. Returns the number of coordinates that were welded.
+    int			weld(SoMFVec3f *coords, int32_t *newIndex);
+
+  private:
+    // A grid cell containing at least one kept coordinate. The kept
+    // coordinates in a cell form a list through the next array.
+    struct Cell {
+	int32_t		x, y, z;	// Cell position in grid
+	int32_t		first;		// First kept coord in cell, or -1
+    };
+
+    float		tolerance;	// Welding distance
+    Cell		*cells;		// Hash table of grid cells
+    uint32_t		mask;		// Table size - 1 (size is 2^n)
+    int32_t		*next;		// Next kept coord in same cell
+
+    // Returns the table slot of the given cell. If the cell is not
+    // there yet, this returns the empty slot where it belongs.
+    uint32_t		findCell(int32_t x, int32_t y, int32_t z) const;
+};
+
+#endif /* _IF_WELDER_ */
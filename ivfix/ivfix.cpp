@@ -62,6 +62,9 @@
 
 #include "../make/Common.h"  // Windows porting
 
+// The most levels of detail that can be given with -D
+#define MAX_LOD_LEVELS  8
+
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -75,8 +78,25 @@ typedef struct {
     SbBool      doAnyNormals;
     SbBool      doAnyTexCoords;
     SbBool      writeStrips;
+    IfFixer::StripMethod stripMethod;
+    int         cacheSize;
+    SbBool      optimizeFaces;
     SbBool      writeVertexProperty;
+    SbBool      packVertexProperty;
     SbBool      useSoTransform;
+    int         numThreads;
+    float       weldTolerance;
+    int         maxPromotionBytes;
+    int         maxBatchVertices;
+    int         maxChunkTriangles;
+    int         numLODLevels;
+    float       lodRatios[MAX_LOD_LEVELS];
+    SbBool      checkCollection;
+    const char* jsonFileName;
+    const char* cacheDirName;
+    int         maxCacheMegabytes;
+    SbBool      lowMemory;
+    int         maxResidentMegabytes;
     const char* inFileName;
     const char* outFileName;
     SoInput     inFile;
@@ -91,6 +111,7 @@ typedef struct {
 
 static void printUsage();
 static void parseArgs(int argc, char **argv, OptionInfo &options);
+static SbBool parseLODRatios(const char *list, OptionInfo &options);
 static void initOptions(OptionInfo &options);
 
 /////////////////////////////////////////////////////////////////////////////
@@ -106,6 +127,7 @@ int main(int argc, char **argv)
   updateProgName(argv[0]);
 
   SoInteraction::init();
+  SoPackedVertexProperty::initClass();
 
   OptionInfo options;
 
@@ -127,36 +149,65 @@ int main(int argc, char **argv)
   IfFixer fixer;
   fixer.setReportLevel(options.reportLevel, stderr);
   fixer.setStripFlag(options.writeStrips);
+  fixer.setStripMethod(options.stripMethod);
+  fixer.setCacheSize(options.cacheSize);
+  fixer.setOptimizeFacesFlag(options.optimizeFaces);
   fixer.setNormalFlag(options.doAnyNormals);
   fixer.setTextureCoordFlag(options.doAnyTexCoords);
   fixer.setVertexPropertyFlag(options.writeVertexProperty);
+  fixer.setPackVertexPropertyFlag(options.packVertexProperty);
   fixer.setUseSoTransform(options.useSoTransform);
+  fixer.setNumThreads(options.numThreads);
+  fixer.setWeldTolerance(options.weldTolerance);
+  fixer.setMaxPromotionBytes(options.maxPromotionBytes);
+  fixer.setMaxBatchVertices(options.maxBatchVertices);
+  fixer.setMaxChunkTriangles(options.maxChunkTriangles);
+  fixer.setLODRatios(options.numLODLevels, options.lodRatios);
+  fixer.setCheckCollection(options.checkCollection);
+  fixer.setCacheDirectory(options.cacheDirName);
+  fixer.setMaxCacheBytes((size_t) options.maxCacheMegabytes * 1024 * 1024);
+  fixer.setLowMemory(options.lowMemory);
+  fixer.setMaxResidentBytes((size_t) options.maxResidentMegabytes *
+                            1024 * 1024);
 
   // Read stuff:
-  IfReporter::startReport("Reading file");
+  IfReporter::startStage("read", "Reading file");
   SoSeparator *root = SoDB::readAll(&options.inFile);
   if (root == NULL) {
     FILE_READ_ERROR(options.inFileName, progname);
   }
-  IfReporter::finishReport();
+  IfReporter::finishStage();
 
   // We don't need to ref the root since we want the IfFixer to get
   // rid of the scene graph when it's done with it
   SoNode *resultRoot = fixer.fix(root);
   if (resultRoot == NULL) {
-    fprintf(stderr, "%s: No shapes found in data\n", progname);
+    fprintf(stderr, "%s: No shapes found in data, or they could not "
+            "be fixed\n", progname);
     return 1;
   }
 
   resultRoot->ref();
 
   // Write out the results
-  IfReporter::startReport("Writing result");
+  IfReporter::startStage("write", "Writing result");
   SoWriteAction wa(&options.outFile);
   if (! options.writeAscii)
     wa.getOutput()->setBinary(TRUE);
   wa.apply(resultRoot);
-  IfReporter::finishReport();
+  IfReporter::finishStage();
+
+  // Write the cost of each stage, if requested
+  if (options.jsonFileName != NULL) {
+    FILE *jsonFile = fopen(options.jsonFileName, "w");
+    if (jsonFile == NULL) {
+      fprintf(stderr, "%s: Cannot write stage report to %s\n",
+              progname, options.jsonFileName);
+      return 1;
+    }
+    IfReporter::writeStageReport(jsonFile, options.inFileName);
+    fclose(jsonFile);
+  }
 
   // Clean up
   CLOSE_INPUT_FILE(&options.inFile, options.inFileName);
@@ -178,14 +229,47 @@ printUsage()
   fprintf(stderr, "Usage: %s [options] [infile] [outfile]\n", progname);
   fprintf(stderr,
     "\t-a     : Write out an ascii file.  Default is binary\n"
+    "\t-B num : Pre-transform shapes that differ only in transform into\n"
+    "\t         batches of at most 'num' vertices. Default is no limit\n"
+    "\t-C     : Check shape collection against the slower path-based\n"
+    "\t         collector (for regression testing)\n"
+    "\t-c num : Vertex cache size to optimize for and report. Default is 16\n"
+    "\t-D list: Add simplified levels of detail to large subgraphs, with\n"
+    "\t         the given decreasing fractions of the triangles, such\n"
+    "\t         as '0.5,0.25,0.1'. Default is none\n"
     "\t-d dir : Add 'dir' to the list of directories to search\n"
     "\t-f     : Produce independent faces rather than tri strips\n"
     "\t-h     : Print this message (help)\n"
+    "\t-j num : Sort and flatten using 'num' threads. Default is 1\n"
+    "\t-J file: Write the time and memory used by each stage and\n"
+    "\t         subgraph to 'file' as JSON\n"
+    "\t-K dir : Reuse flattened subgraphs cached in directory 'dir'\n"
+    "\t         from earlier runs, and cache new ones there\n"
+    "\t-k num : Limit the cache to 'num' megabytes. Default is 256\n"
+    "\t-L     : Low-memory mode: flatten each subgraph as soon as it is\n"
+    "\t         complete and free its source nodes\n"
+    "\t-M num : Merge shapes by promoting their material bindings to\n"
+    "\t         indexed if that adds at most 'num' bytes of indices per\n"
+    "\t         shape saved. 0 disables promotion. Default is 4096\n"
+    "\t-l     : Produce independent faces (triangle lists) whose order\n"
+    "\t         is optimized for the vertex cache\n"
     "\t-n     : Do not generate any normals\n"
+    "\t-P num : Split flattened subgraphs into spatial chunks of at most\n"
+    "\t         'num' triangles, each culled separately. Default is none\n"
     "\t-p     : Do not produce SoVertexProperty nodes for properties\n"
+    "\t-q     : Pack normals and texture coordinates at reduced\n"
+    "\t         precision in SoPackedVertexProperty nodes, which only\n"
+    "\t         readers that register that node can read. No effect\n"
+    "\t         with -p\n"
     "\t-t     : Do not generate any texture coordinates\n"
+    "\t-S how : Create strips that are as long as possible ('greedy',\n"
+    "\t         the default) or that reuse the vertex cache ('cache')\n"
     "\t-m     : Use SoTransform instead of SoMatrixTransform\n"
     "\t         (better file readability of acsii formats).\n"
+    "\t-w tol : Weld coordinates closer than 'tol' together\n"
+    "\t-X num : Like -L, but keep at most 'num' megabytes of flattened\n"
+    "\t         subgraphs in memory, spilling the rest to a temporary\n"
+    "\t         file until the end. Default is no limit\n"
     "\t-v     : (Verbose) Display status info during processing\n"
     "\t-V     : (Very verbose) Display more detailed status info\n"
     "If no input or output file name is specified, stdin and stdout are used.\n"
@@ -206,29 +290,101 @@ parseArgs(int argc, char **argv, OptionInfo &options)
   SbBool uhoh = FALSE;
   int c;
   
-  while ((c = getopt(argc, argv, "ad:fhnptmvV")) != -1) {
+  while ((c = getopt(argc, argv, "aB:Cc:D:d:fhj:J:k:K:lLM:nP:pqtmS:vVw:X:")) != -1) {
     switch(c) {
     case 'a':
       options.writeAscii = TRUE;
       break;
+    case 'B':
+      options.maxBatchVertices = atoi(optarg);
+      if (options.maxBatchVertices < 1)
+        uhoh = TRUE;
+      break;
+    case 'C':
+      options.checkCollection = TRUE;
+      break;
+    case 'c':
+      options.cacheSize = atoi(optarg);
+      if (options.cacheSize < 3)
+        uhoh = TRUE;
+      break;
+    case 'D':
+      if (! parseLODRatios(optarg, options))
+        uhoh = TRUE;
+      break;
     case 'd':
       options.inFile.addDirectoryLast(optarg);
       break;
     case 'f':
       options.writeStrips = FALSE;
       break;
+    case 'j':
+      options.numThreads = atoi(optarg);
+      if (options.numThreads < 1)
+        uhoh = TRUE;
+      break;
+    case 'J':
+      options.jsonFileName = optarg;
+      break;
+    case 'k':
+      options.maxCacheMegabytes = atoi(optarg);
+      if (options.maxCacheMegabytes < 1)
+        uhoh = TRUE;
+      break;
+    case 'K':
+      options.cacheDirName = optarg;
+      break;
+    case 'L':
+      options.lowMemory = TRUE;
+      break;
+    case 'l':
+      options.writeStrips = FALSE;
+      options.optimizeFaces = TRUE;
+      break;
+    case 'M':
+      options.maxPromotionBytes = atoi(optarg);
+      if (options.maxPromotionBytes < 0)
+        uhoh = TRUE;
+      break;
     case 'n':
       options.doAnyNormals = FALSE;
       break;
+    case 'P':
+      options.maxChunkTriangles = atoi(optarg);
+      if (options.maxChunkTriangles < 1)
+        uhoh = TRUE;
+      break;
     case 'p':
       options.writeVertexProperty = FALSE;
       break;
+    case 'q':
+      options.packVertexProperty = TRUE;
+      break;
     case 't':
       options.doAnyTexCoords = FALSE;
       break;
     case 'm':
       options.useSoTransform = TRUE;
       break;
+    case 'S':
+      if (! strcmp(optarg, "greedy"))
+        options.stripMethod = IfFixer::GREEDY_STRIPS;
+      else if (! strcmp(optarg, "cache"))
+        options.stripMethod = IfFixer::CACHE_STRIPS;
+      else
+        uhoh = TRUE;
+      break;
+    case 'w':
+      options.weldTolerance = atof(optarg);
+      if (options.weldTolerance <= 0.0)
+        uhoh = TRUE;
+      break;
+    case 'X':
+      options.maxResidentMegabytes = atoi(optarg);
+      options.lowMemory = TRUE;
+      if (options.maxResidentMegabytes < 1)
+        uhoh = TRUE;
+      break;
     case 'v':
       options.reportLevel = IfFixer::LOW;
       break;
@@ -254,6 +410,37 @@ parseArgs(int argc, char **argv, OptionInfo &options)
     printUsage();
 }
 
+/////////////////////////////////////////////////////////////////////////////
+//
+// Parses a comma-separated list of decreasing fractions of triangles
+// for levels of detail. Returns FALSE if the list is bad.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static SbBool
+parseLODRatios(const char *list, OptionInfo &options)
+{
+  options.numLODLevels = 0;
+
+  const char *s = list;
+  while (TRUE) {
+    char *end;
+    double ratio = strtod(s, &end);
+    if (end == s || ratio <= 0.0 || ratio >= 1.0 ||
+        options.numLODLevels == MAX_LOD_LEVELS ||
+        (options.numLODLevels > 0 &&
+         ratio >= options.lodRatios[options.numLODLevels - 1]))
+      return FALSE;
+    options.lodRatios[options.numLODLevels++] = (float) ratio;
+
+    if (*end == '\0')
+      return TRUE;
+    if (*end != ',')
+      return FALSE;
+    s = end + 1;
+  }
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // Initializes an OptionInfo structure.
@@ -268,6 +455,22 @@ initOptions(OptionInfo &options)
   options.doAnyNormals  = TRUE;
   options.doAnyTexCoords  = TRUE;
   options.writeStrips    = TRUE;
+  options.stripMethod    = IfFixer::GREEDY_STRIPS;
+  options.cacheSize    = 16;
+  options.optimizeFaces  = FALSE;
   options.writeVertexProperty  = TRUE;
+  options.packVertexProperty  = FALSE;
   options.useSoTransform  = FALSE;
+  options.numThreads  = 1;
+  options.weldTolerance  = 0.0;
+  options.maxPromotionBytes  = 4096;
+  options.maxBatchVertices  = 0;
+  options.maxChunkTriangles  = 0;
+  options.numLODLevels  = 0;
+  options.checkCollection  = FALSE;
+  options.jsonFileName  = NULL;
+  options.cacheDirName  = NULL;
+  options.maxCacheMegabytes  = 256;
+  options.lowMemory  = FALSE;
+  options.maxResidentMegabytes  = 0;
 }
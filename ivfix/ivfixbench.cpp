@@ -0,0 +1,363 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// ivfixbench: times parts of the ivfix code on real data. The given
+// scene is flattened into triangles the same way ivfix flattens each
+// subgraph, and then the coordinates, normals, and texture
+// coordinates are condensed repeatedly using the old SbDict-based
+// IfHasher and the open-addressing IfOpenHasher. The results of the
+// two are checked to be identical. First, IfWelder is checked on a
+// few coordinates, some of them not finite.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <float.h>
+#include <stdlib.h>
+
+#include <Inventor/SbBox.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoInteraction.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedShape.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+
+#include "IfFlattener.h"
+#include "IfHasher.h"
+#include "IfHolder.h"
+#include "IfOpenHasher.h"
+#include "IfWelder.h"
+
+#include "../make/Common.h"  // Windows porting
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Forward references.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void printUsage();
+static SbBool checkWelder();
+static SbBool benchHashers(const char *name, const SoMFInt32 &indexField,
+			   const SoMFVec3f *vec3Field,
+			   const SoMFVec2f *vec2Field,
+			   const SbVec3f &min, const SbVec3f &scale,
+			   int numReps);
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Mainline.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+  updateProgName(argv[0]);
+
+  SoInteraction::init();
+
+  // Parse arguments
+  int numReps = 5;
+  SbBool uhoh = FALSE;
+  int c;
+
+  while ((c = getopt(argc, argv, "hr:")) != -1) {
+    switch(c) {
+    case 'r':
+      numReps = atoi(optarg);
+      if (numReps < 1)
+        uhoh = TRUE;
+      break;
+    case 'h':  // Help
+    default:
+      uhoh = TRUE;
+      break;
+    }
+  }
+
+  const char *inFileName = (optind < argc) ? argv[optind++] : NULL;
+  if (optind < argc || uhoh)
+    printUsage();
+
+  SoTexture2noLoad::override();
+  SoTexture3noLoad::override();
+  SoVRMLImageTextureNoLoad::override();
+
+  // Read the scene
+  SoInput in;
+  OPEN_INPUT_FILE(&in, inFileName, FALSE, printUsage);
+  SoSeparator *root = SoDB::readAll(&in);
+  if (root == NULL) {
+    FILE_READ_ERROR(inFileName, progname);
+  }
+  CLOSE_INPUT_FILE(&in, inFileName);
+  root->ref();
+
+  // Flatten the whole scene into one holder
+  IfHolder *holder = new IfHolder(root, FALSE, TRUE, TRUE);
+  IfFlattener *flattener = new IfFlattener;
+  flattener->flatten(holder);
+  delete flattener;
+  root->unref();
+
+  SoIndexedShape *triSet = holder->triSet;
+  fprintf(stderr, "%s: %d triangles, %d repetitions\n", progname,
+	  triSet->coordIndex.getNum() / 4, numReps);
+
+  fprintf(stderr, "\n%-10s %10s %10s %16s %16s %8s\n",
+	  "", "vectors", "unique", "IfHasher ms", "IfOpenHasher ms",
+	  "speedup");
+
+  SbBool ok = TRUE;
+
+  if (! checkWelder()) {
+    fprintf(stderr, "%s: welder produced wrong results\n", progname);
+    ok = FALSE;
+  }
+
+  // Coordinates, using the bounding box to scale for the old hasher
+  // the same way IfCondenser used to
+  const SoMFVec3f &coords = holder->coords->point;
+  SbBox3f box;
+  int i;
+  for (i = 0; i < coords.getNum(); i++)
+    box.extendBy(coords[i]);
+  SbVec3f scale;
+  box.getSize(scale[0], scale[1], scale[2]);
+  for (i = 0; i < 3; i++)
+    scale[i] = (scale[i] == 0.f ? 1.f : 1.f / scale[i]);
+  ok &= benchHashers("coords", triSet->coordIndex, &coords, NULL,
+		     box.getMin(), scale, numReps);
+
+  // Normals always lie between -1 and 1, texture coordinates
+  // (mostly) between 0 and 1
+  ok &= benchHashers("normals", triSet->normalIndex,
+		     &holder->normals->vector, NULL,
+		     SbVec3f(-1.0, -1.0, -1.0), SbVec3f(0.5, 0.5, 0.5),
+		     numReps);
+  ok &= benchHashers("texCoords", triSet->textureCoordIndex,
+		     NULL, &holder->texCoords->point,
+		     SbVec3f(0.0, 0.0, 0.0), SbVec3f(1.0, 1.0, 1.0),
+		     numReps);
+
+  delete holder;
+
+  if (! ok) {
+    fprintf(stderr, "%s: hashers produced different results\n", progname);
+    return 1;
+  }
+
+  return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Prints usage message and exits.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void
+printUsage()
+{
+  fprintf(stderr, "Usage: %s [options] [infile]\n", progname);
+  fprintf(stderr,
+    "\t-h     : Print this message (help)\n"
+    "\t-r num : Time each test 'num' times and report the best. Default is 5\n"
+    "If no input file name is specified, stdin is used.\n"
+    );
+
+  exit(99);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Condenses the vectors in one of the given fields (whichever is not
+// NULL) using both hashers, the same way IfCondenser does, and
+// reports the best times. Returns FALSE if the results differ.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static SbBool
+benchHashers(const char *name, const SoMFInt32 &indexField,
+	     const SoMFVec3f *vec3Field, const SoMFVec2f *vec2Field,
+	     const SbVec3f &min, const SbVec3f &scale, int numReps)
+{
+    int numIndices = indexField.getNum();
+    const int32_t *origIndices = indexField.getValues(0);
+
+    int32_t *oldIndices = new int32_t[numIndices];
+    int32_t *newIndices = new int32_t[numIndices];
+
+    SoMFVec3f oldUnique3, newUnique3;
+    SoMFVec2f oldUnique2, newUnique2;
+    oldUnique3.setContainer(NULL);
+    newUnique3.setContainer(NULL);
+    oldUnique2.setContainer(NULL);
+    newUnique2.setContainer(NULL);
+
+    double oldTime = 0.0, newTime = 0.0;
+    int i;
+
+    for (int rep = 0; rep < numReps; rep++) {
+
+	// Old hasher
+	SbTime start = SbTime::getTimeOfDay();
+	if (vec3Field != NULL) {
+	    const SbVec3f *v = vec3Field->getValues(0);
+	    IfHasher hasher(&oldUnique3, numIndices, min, scale);
+	    for (i = 0; i < numIndices; i++)
+		oldIndices[i] = (origIndices[i] < 0 ? origIndices[i] :
+				 hasher.addVector(v[origIndices[i]]));
+	    hasher.finish();
+	}
+	else {
+	    const SbVec2f *v = vec2Field->getValues(0);
+	    IfHasher hasher(&oldUnique2, numIndices,
+			    SbVec2f(min[0], min[1]),
+			    SbVec2f(scale[0], scale[1]));
+	    for (i = 0; i < numIndices; i++)
+		oldIndices[i] = (origIndices[i] < 0 ? origIndices[i] :
+				 hasher.addVector(v[origIndices[i]]));
+	    hasher.finish();
+	}
+	double t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < oldTime)
+	    oldTime = t;
+
+	// New hasher
+	start = SbTime::getTimeOfDay();
+	if (vec3Field != NULL) {
+	    const SbVec3f *v = vec3Field->getValues(0);
+	    IfOpenHasher hasher(&newUnique3, numIndices);
+	    for (i = 0; i < numIndices; i++)
+		newIndices[i] = (origIndices[i] < 0 ? origIndices[i] :
+				 hasher.addVector(v[origIndices[i]]));
+	    hasher.finish();
+	}
+	else {
+	    const SbVec2f *v = vec2Field->getValues(0);
+	    IfOpenHasher hasher(&newUnique2, numIndices);
+	    for (i = 0; i < numIndices; i++)
+		newIndices[i] = (origIndices[i] < 0 ? origIndices[i] :
+				 hasher.addVector(v[origIndices[i]]));
+	    hasher.finish();
+	}
+	t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < newTime)
+	    newTime = t;
+    }
+
+    // Both hashers assign indices in order of first use, so the
+    // resulting indices must be exactly the same
+    int numVectors, numUnique;
+    SbBool same;
+    if (vec3Field != NULL) {
+	numVectors = vec3Field->getNum();
+	numUnique  = newUnique3.getNum();
+	same = (oldUnique3.getNum() == numUnique);
+    }
+    else {
+	numVectors = vec2Field->getNum();
+	numUnique  = newUnique2.getNum();
+	same = (oldUnique2.getNum() == numUnique);
+    }
+    for (i = 0; same && i < numIndices; i++)
+	same = (oldIndices[i] == newIndices[i]);
+
+    fprintf(stderr, "%-10s %10d %10d %16.2f %16.2f %7.2fx%s\n",
+	    name, numVectors, numUnique, oldTime * 1000.0, newTime * 1000.0,
+	    (newTime > 0.0 ? oldTime / newTime : 0.0),
+	    same ? "" : "  MISMATCH");
+
+    delete [] oldIndices;
+    delete [] newIndices;
+
+    return same;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Welds a few coordinates, including infinite and NaN ones, which
+// must be kept as they are without affecting the welding of the
+// others. Returns FALSE if the result is not the expected one.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static SbBool
+checkWelder()
+{
+    float inf = FLT_MAX * 2.0f;
+    float nan = inf - inf;
+
+    SoMFVec3f coords;
+    coords.setContainer(NULL);
+    coords.set1Value(0, SbVec3f(0.0,   0.0, 0.0));
+    coords.set1Value(1, SbVec3f(inf,   0.0, 0.0));
+    coords.set1Value(2, SbVec3f(0.005, 0.0, 0.0));
+    coords.set1Value(3, SbVec3f(1.0,   1.0, 1.0));
+    coords.set1Value(4, SbVec3f(0.0,   nan, 0.0));
+    coords.set1Value(5, SbVec3f(1.0,   1.0, 1.005));
+    coords.set1Value(6, SbVec3f(0.0,  -inf, 0.0));
+
+    // Kept coordinates: 0, inf, 1, NaN, -inf
+    static const int32_t expected[7] = { 0, 1, 0, 2, 3, 2, 4 };
+
+    int32_t newIndex[7];
+    IfWelder welder(0.01f);
+    int numWelded = welder.weld(&coords, newIndex);
+
+    SbBool ok = (numWelded == 2 && coords.getNum() == 5);
+    for (int i = 0; ok && i < 7; i++)
+	ok = (newIndex[i] == expected[i]);
+
+    // A field with no finite coordinates is left alone
+    SoMFVec3f allInf;
+    allInf.setContainer(NULL);
+    allInf.set1Value(0, SbVec3f(inf, inf, inf));
+    allInf.set1Value(1, SbVec3f(inf, inf, inf));
+    ok = ok && (welder.weld(&allInf, newIndex) == 0 &&
+		allInf.getNum() == 2 && newIndex[0] == 0 && newIndex[1] == 1);
+
+    fprintf(stderr, "%s: welder check %s\n", progname,
+	    ok ? "passed" : "FAILED");
+
+    return ok;
+}
@@ -0,0 +1,321 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// ivfixscale: measures how the time taken by ivfix grows with the size
+// of a scene. Scenes of each kind made by IfSceneMaker are generated
+// at a series of sizes and fixed with IfFixer, and the throughput in
+// triangles per second and the time of each stage are printed as one
+// row per scene, so they can be plotted against the size. Since the
+// process's peak resident memory only ever rises, the memory column is
+// how far a scene raised it above its peak before the scene. The scenes
+// can also be written out, to be used as a corpus for ivfix itself.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInteraction.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoGetPrimitiveCountAction.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+#include "IfFixer.h"
+#include "IfMetrics.h"
+#include "IfReporter.h"
+#include "IfSceneMaker.h"
+
+#include "../make/Common.h"  // Windows porting
+
+typedef struct {
+    SbBool	allTypes;
+    IfSceneMaker::SceneType type;
+    int		minTris;
+    int		maxTris;
+    int		growth;
+    int		numReps;
+    int		numThreads;
+    int		chainLength;
+    const char	*outDirName;
+} OptionInfo;
+
+// The stages reported, as recorded by IfFixer
+static const char *stageNames[] = {
+    "replace", "collect", "sort", "merge", "build", "weed",
+};
+#define NUM_STAGES ((int) (sizeof(stageNames) / sizeof(stageNames[0])))
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Forward references.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void printUsage();
+static void parseArgs(int argc, char **argv, OptionInfo &options);
+static void benchScene(IfSceneMaker::SceneType type, int numTris,
+		       const OptionInfo &options);
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Mainline.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+  updateProgName(argv[0]);
+
+  SoInteraction::init();
+
+  OptionInfo options;
+  parseArgs(argc, argv, options);
+
+  // Header: times are in milliseconds. The build stage includes
+  // flattening, condensing, and stripping, which are also given
+  // separately (summed over all subgraphs). The rssGrowth column is
+  // in bytes.
+  printf("%-10s %10s %10s %10s %10s", "scene", "inTris", "outTris",
+	 "totalMs", "triPerSec");
+  for (int i = 0; i < NUM_STAGES; i++)
+    printf(" %9s", stageNames[i]);
+  printf(" %9s %9s %9s %12s\n", "flatten", "condense", "strip", "rssGrowth");
+
+  for (int t = 0; t < IfSceneMaker::NUM_SCENE_TYPES; t++) {
+    IfSceneMaker::SceneType type = (IfSceneMaker::SceneType) t;
+    if (! options.allTypes && type != options.type)
+      continue;
+
+    for (double n = options.minTris; n <= options.maxTris;
+         n *= options.growth) {
+      benchScene(type, (int) n, options);
+      fflush(stdout);
+    }
+  }
+
+  return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Prints usage message and exits.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void
+printUsage()
+{
+  fprintf(stderr, "Usage: %s [options]\n", progname);
+  fprintf(stderr,
+    "\t-d num : Nest 'num' levels in each branch of deep scenes.\n"
+    "\t         Default is 4\n"
+    "\t-g num : Multiply the size of each scene by 'num'. Default is 4\n"
+    "\t-h     : Print this message (help)\n"
+    "\t-j num : Fix using 'num' threads. Default is 1\n"
+    "\t-n num : Size of the smallest scene in triangles. Default is 10000\n"
+    "\t-N num : Size of the largest scene in triangles. Default is 1000000\n"
+    "\t-o dir : Also write each scene to 'dir' as <scene>-<size>.iv\n"
+    "\t-r num : Fix each scene 'num' times and report the fastest.\n"
+    "\t         Default is 1\n"
+    "\t-t type: Make only scenes of the given type: parts, meshes, deep,\n"
+    "\t         materials, or vp. Default is all of them\n"
+    );
+
+  exit(99);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Parses input options, filling in an OptionInfo structure.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void
+parseArgs(int argc, char **argv, OptionInfo &options)
+{
+  options.allTypes   = TRUE;
+  options.type       = IfSceneMaker::PARTS;
+  options.minTris    = 10000;
+  options.maxTris    = 1000000;
+  options.growth     = 4;
+  options.numReps    = 1;
+  options.numThreads = 1;
+  options.chainLength = 4;
+  options.outDirName = NULL;
+
+  SbBool uhoh = FALSE;
+  int c;
+
+  while ((c = getopt(argc, argv, "d:g:hj:n:N:o:r:t:")) != -1) {
+    switch(c) {
+    case 'd':
+      options.chainLength = atoi(optarg);
+      if (options.chainLength < 1)
+        uhoh = TRUE;
+      break;
+    case 'g':
+      options.growth = atoi(optarg);
+      if (options.growth < 2)
+        uhoh = TRUE;
+      break;
+    case 'j':
+      options.numThreads = atoi(optarg);
+      if (options.numThreads < 1)
+        uhoh = TRUE;
+      break;
+    case 'n':
+      options.minTris = atoi(optarg);
+      if (options.minTris < 2)
+        uhoh = TRUE;
+      break;
+    case 'N':
+      options.maxTris = atoi(optarg);
+      break;
+    case 'o':
+      options.outDirName = optarg;
+      break;
+    case 'r':
+      options.numReps = atoi(optarg);
+      if (options.numReps < 1)
+        uhoh = TRUE;
+      break;
+    case 't':
+      options.allTypes = FALSE;
+      if (! IfSceneMaker::getType(optarg, options.type))
+        uhoh = TRUE;
+      break;
+    case 'h':  // Help
+    default:
+      uhoh = TRUE;
+      break;
+    }
+  }
+
+  if (optind < argc || options.maxTris < options.minTris || uhoh)
+    printUsage();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Makes a scene of the given kind and size, fixes it, and prints a row
+// of results for it. The scene is made anew for each repetition, since
+// fixing consumes it.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static void
+benchScene(IfSceneMaker::SceneType type, int numTris,
+	   const OptionInfo &options)
+{
+  IfSceneMaker maker;
+  maker.setChainLength(options.chainLength);
+  IfFixer fixer;
+  fixer.setReportLevel(IfFixer::NONE, stderr);
+  fixer.setNumThreads(options.numThreads);
+
+  double	bestTime = 0.0;
+  int		numInTris = 0, numOutTris = 0;
+  size_t	rssGrowth = 0;
+  IfMetrics	stages[NUM_STAGES], flatten, condense, strip;
+  int		i;
+
+  // The peak RSS covers the life of the process, so measure against
+  // the peak before this scene. Anything below an earlier, larger
+  // scene's peak does not show up.
+  size_t	baseRSS = IfMetrics::getPeakRSS();
+
+  for (int rep = 0; rep < options.numReps; rep++) {
+
+    SoSeparator *root = maker.make(type, numTris);
+    root->ref();
+
+    if (rep == 0) {
+      SoGetPrimitiveCountAction pca;
+      pca.apply(root);
+      numInTris = pca.getTriangleCount();
+
+      if (options.outDirName != NULL) {
+        char fileName[1024];
+        sprintf(fileName, "%s/%s-%d.iv", options.outDirName,
+                IfSceneMaker::getName(type), numTris);
+        SoOutput out;
+        if (! out.openFile(fileName)) {
+          fprintf(stderr, "%s: Cannot write %s\n", progname, fileName);
+          exit(1);
+        }
+        SoWriteAction wa(&out);
+        wa.apply(root);
+        out.closeFile();
+      }
+    }
+
+    IfReporter::clearStages();
+
+    IfMetrics total;
+    total.start();
+    SoNode *resultRoot = fixer.fix(root);
+    total.finish();
+
+    root->unref();
+    if (resultRoot != NULL) {
+      resultRoot->ref();
+      resultRoot->unref();
+    }
+
+    if (total.peakRSS > baseRSS && total.peakRSS - baseRSS > rssGrowth)
+      rssGrowth = total.peakRSS - baseRSS;
+
+    if (rep > 0 && total.wallTime >= bestTime)
+      continue;
+
+    bestTime = total.wallTime;
+    for (i = 0; i < NUM_STAGES; i++)
+      IfReporter::getStageMetrics(stageNames[i], stages[i]);
+    IfReporter::getSubgraphTotals(numOutTris, flatten, condense, strip);
+  }
+
+  printf("%-10s %10d %10d %10.1f %10.0f", IfSceneMaker::getName(type),
+	 numInTris, numOutTris, bestTime * 1000.0,
+	 bestTime > 0.0 ? numInTris / bestTime : 0.0);
+  for (i = 0; i < NUM_STAGES; i++)
+    printf(" %9.1f", stages[i].wallTime * 1000.0);
+  printf(" %9.1f %9.1f %9.1f %12lu\n", flatten.cpuTime * 1000.0,
+	 condense.cpuTime * 1000.0, strip.cpuTime * 1000.0,
+	 (unsigned long) rssGrowth);
+}
@@ -38,6 +38,9 @@
 // Code for the edges class, that supports fast querying of the faces
 // around an edge.
 //
+// ivnorm now uses MeshTopology (see Topology.h) instead; this is kept
+// to compare the two in ivnormbench.
+//
 
 struct Edge
 {
@@ -41,11 +41,19 @@
 #include <assert.h>
 #include <math.h>
 #include "Faces.h"
-#include "Edges.h"
+#include "Normals.h"
+#include "Topology.h"
 
+#include <Inventor/SbTime.h>
 #include <Inventor/nodes/SoNormal.h>
 #include <Inventor/nodes/SoIndexedFaceSet.h>
 
+#if defined(__SSE__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FACES_USE_SSE
+#include <xmmintrin.h>
+#endif
+
 //
 // Find a face's normal, assuming its vertices are in
 // counter-clockwise order.
@@ -73,6 +81,17 @@ Face::findNormal(const SbVec3f *verts)
 	normal[1] += (v1[2] - v2[2])*(v1[0] + v2[0]);
 	normal[2] += (v1[0] - v2[0])*(v1[1] + v2[1]);
     }
+
+    finishNormal();
+}
+
+//
+// Turn the sum from Newell's method into the face's normal, and
+// decide whether the face is degenerate
+//
+void
+Face::finishNormal()
+{
     if (orientation == Face::CW) normal.negate();
 
     if (normal.length() < 0.00001)
@@ -123,22 +142,26 @@ FaceList::FaceList()
 {
     verts = NULL;
     faceSet = NULL;
-    ed = NULL;
-    vd = NULL;
+    topo = NULL;
+    faceArray = NULL;
+    vnArray = NULL;
     convex = TRUE;
     solid = TRUE;
     verbose = FALSE;
+    legacyNormals = FALSE;
 }
 
-FaceList::FaceList(const SbVec3f *v, EdgeDict *e)
+FaceList::FaceList(const SbVec3f *v, MeshTopology *t)
 {
     verts = v;
-    ed = e;
-    vd = NULL;
+    topo = t;
+    faceArray = NULL;
+    vnArray = NULL;
     faceSet = NULL;
     convex = TRUE;
     solid = TRUE;
     verbose = FALSE;
+    legacyNormals = FALSE;
 }
 
 FaceList::FaceList(const SbVec3f *v, SoIndexedFaceSet *fs, SbBool vrb)
@@ -147,27 +170,36 @@ FaceList::FaceList(const SbVec3f *v, SoIndexedFaceSet *fs, SbBool vrb)
     faceSet = fs; fs->ref();
     convex = TRUE;
     solid = TRUE;
-    vd = NULL;
+    vnArray = NULL;
     verbose = vrb;
-    
-    ed = new EdgeDict(1000);
+    legacyNormals = FALSE;
 
     SoMFInt32 *coord_indices = &faceSet->coordIndex;
-    //int ni = coord_indices->getNum();
+    int ni = coord_indices->getNum();
 
     int32_t *indices = coord_indices->startEditing();
 
+    // Count the faces, so that they can all be allocated at once
+    int n_faces = 0;
+    int i;
+    for (i = 0; i < ni; i++)
+    {
+	if (indices[i] == SO_END_FACE_INDEX || i == ni-1)
+	    ++n_faces;
+    }
+    faceArray = new Face[n_faces];
+
     int start_o_face = 0;
 
-    // Now fill in face and edge structures
+    // Now fill in face structures
     int n_degenerate_faces = 0;
     int n_degenerate_edges = 0;
-    for (int i = 0, ct=0; i < coord_indices->getNum(); i++)
+    int ct;
+    for (i = 0, ct=0; i < ni; i++)
     {
-	if (indices[i] == SO_END_FACE_INDEX
-	    || i == coord_indices->getNum()-1)
+	if (indices[i] == SO_END_FACE_INDEX || i == ni-1)
 	{
-	    Face *f = new Face;
+	    Face *f = faceArray + getLength();
 	    if (indices[i] == SO_END_FACE_INDEX)
 		f->nv = i - start_o_face;
 	    else
@@ -177,21 +209,6 @@ FaceList::FaceList(const SbVec3f *v, SoIndexedFaceSet *fs, SbBool vrb)
 	    f->vidx = start_o_face;
 	    f->vn = NULL;
 	    f->orientation = Face::UNKNOWN;
-	    
-	    f->findNormal(verts);
-	    if (f->degenerate)
-	    {
-		++n_degenerate_faces;
-		f->orientation = Face::CCW;
-	    }
-	    else for (int j = 0; j < f->nv; j++)
-	    {
-		int i1 = (int)f->v[j];
-		int i2 = (int)f->v[(j+1)%f->nv];
-		if (i1 != i2)
-		    ed->Add(f, i1, i2);
-		else ++n_degenerate_edges;
-	    }
 
 	    start_o_face = i+1;
 
@@ -201,6 +218,23 @@ FaceList::FaceList(const SbVec3f *v, SoIndexedFaceSet *fs, SbBool vrb)
 	    ct++;	// "ct" counts the non-END entries, for use
 			// as the index into a per_vertex normal set
     }
+
+    findNormals();
+    for (i = 0; i < getLength(); i++)
+    {
+	Face *f = (*this)[i];
+	if (f->degenerate)
+	{
+	    ++n_degenerate_faces;
+	    f->orientation = Face::CCW;
+	}
+	else for (int j = 0; j < f->nv; j++)
+	{
+	    if (f->v[j] == f->v[(j+1)%f->nv])
+		++n_degenerate_edges;
+	}
+    }
+
     if (n_degenerate_faces != 0)
     {
 	if (verbose) fprintf(stderr, "Detected %d degenerate faces\n",
@@ -211,6 +245,10 @@ FaceList::FaceList(const SbVec3f *v, SoIndexedFaceSet *fs, SbBool vrb)
 	if (verbose) fprintf(stderr, "Detected %d degenerate edges\n",
 		n_degenerate_edges);
     }
+
+    // Build the adjacency of the faces
+    topo = new MeshTopology;
+    topo->Build(*this);
 }
 
 void
@@ -280,18 +318,13 @@ FaceList::~FaceList()
 {
     if (faceSet != NULL)
     {
-	delete ed;
+	delete topo;
 	faceSet->coordIndex.finishEditing();
 	faceSet->unref();
-	for (int i = 0; i < getLength(); i++)
-	{
-	    delete (*this)[i];
-	}
 	truncate(0);
+	delete [] faceArray;
+	delete [] vnArray;
     }
-
-    if (vd)
-	delete [] vd;
 }
 
 void
@@ -334,45 +367,160 @@ FaceList::findFacetNormals(SoNormal *n)
 {
     assert(n != NULL && faceSet != NULL);
 
+    findNormals();
     for (int i = 0; i < getLength(); i++)
     {
-	(*this)[i]->findNormal(verts);
 	n->vector.set1Value(i, (*this)[i]->normal);
     }
 }
 
+#ifdef FACES_USE_SSE
+//
+// A point for faces with no vertices, and masks selecting the lanes
+// whose bits are set in the index
+//
+static const float zero[3] = { 0.0, 0.0, 0.0 };
+static const uint32_t laneMasks[16][4] = {
+    { 0, 0, 0, 0 }, { ~0u, 0, 0, 0 }, { 0, ~0u, 0, 0 }, { ~0u, ~0u, 0, 0 },
+    { 0, 0, ~0u, 0 }, { ~0u, 0, ~0u, 0 }, { 0, ~0u, ~0u, 0 },
+    { ~0u, ~0u, ~0u, 0 }, { 0, 0, 0, ~0u }, { ~0u, 0, 0, ~0u },
+    { 0, ~0u, 0, ~0u }, { ~0u, ~0u, 0, ~0u }, { 0, 0, ~0u, ~0u },
+    { ~0u, 0, ~0u, ~0u }, { 0, ~0u, ~0u, ~0u }, { ~0u, ~0u, ~0u, ~0u }
+};
+#endif
+
+//
+// Find the normals of all the faces on the list.  The sums from
+// Newell's method are found four faces at a time with SSE, where
+// there is SSE, as x, y and z vectors, adding in the same order as
+// Face::findNormal() so that the normals are exactly the same.  Each
+// edge's end is loaded once and used again as the next edge's start.
+// A face with fewer edges than the others of its four, or with a
+// degenerate edge, has that edge's terms masked to 0; as the sums
+// start at +0 they can never be -0, so adding 0 leaves them as they
+// were.  Each four is finished while its faces are still in the
+// cache.
+//
+void
+FaceList::findNormals()
+{
+    int n = getLength();
+    int i = 0;
+
+#ifdef FACES_USE_SSE
+    for (; i + 4 <= n; i += 4)
+    {
+	Face *f[4];
+	const float *p[4];
+	int max_nv = 0;
+	int k;
+	for (k = 0; k < 4; k++)
+	{
+	    f[k] = (*this)[i+k];
+	    if (f[k]->nv > max_nv) max_nv = f[k]->nv;
+	    p[k] = (f[k]->nv > 0 ? verts[f[k]->v[0]].getValue() : zero);
+	}
+
+	__m128 x1 = _mm_setr_ps(p[0][0], p[1][0], p[2][0], p[3][0]);
+	__m128 y1 = _mm_setr_ps(p[0][1], p[1][1], p[2][1], p[3][1]);
+	__m128 z1 = _mm_setr_ps(p[0][2], p[1][2], p[2][2], p[3][2]);
+
+	__m128 nx = _mm_setzero_ps();
+	__m128 ny = _mm_setzero_ps();
+	__m128 nz = _mm_setzero_ps();
+	for (int j = 0; j < max_nv; j++)
+	{
+	    // The end of each face's edge j, which wraps around to its
+	    // first vertex; faces without edge j just use that too
+	    int active = 0;
+	    for (k = 0; k < 4; k++)
+	    {
+		const int32_t *v = f[k]->v;
+		int nv = f[k]->nv;
+		if (nv == 0) continue;
+
+		int32_t iv2 = (j+1 < nv ? v[j+1] : v[0]);
+		if (j < nv && v[j] != iv2)
+		    active |= 1 << k;
+		p[k] = verts[iv2].getValue();
+	    }
+
+	    __m128 x2 = _mm_setr_ps(p[0][0], p[1][0], p[2][0], p[3][0]);
+	    __m128 y2 = _mm_setr_ps(p[0][1], p[1][1], p[2][1], p[3][1]);
+	    __m128 z2 = _mm_setr_ps(p[0][2], p[1][2], p[2][2], p[3][2]);
+	    __m128 mask = _mm_loadu_ps((const float *)laneMasks[active]);
+
+	    nx = _mm_add_ps(nx, _mm_and_ps(mask,
+		    _mm_mul_ps(_mm_sub_ps(y1, y2), _mm_add_ps(z1, z2))));
+	    ny = _mm_add_ps(ny, _mm_and_ps(mask,
+		    _mm_mul_ps(_mm_sub_ps(z1, z2), _mm_add_ps(x1, x2))));
+	    nz = _mm_add_ps(nz, _mm_and_ps(mask,
+		    _mm_mul_ps(_mm_sub_ps(x1, x2), _mm_add_ps(y1, y2))));
+
+	    x1 = x2;
+	    y1 = y2;
+	    z1 = z2;
+	}
+
+	float sx[4], sy[4], sz[4];
+	_mm_storeu_ps(sx, nx);
+	_mm_storeu_ps(sy, ny);
+	_mm_storeu_ps(sz, nz);
+	for (k = 0; k < 4; k++)
+	{
+	    f[k]->normal.setValue(sx[k], sy[k], sz[k]);
+	    f[k]->finishNormal();
+	}
+    }
+#endif
+
+    for (; i < n; i++)
+	(*this)[i]->findNormal(verts);
+}
+
 //
 // Assuming that the correct orientation of a 'seed' face has been
 // discovered, this routine figures out the correct orientation for
-// all faces connected to that face.
+// all faces connected to that face.  The seed must be the only face
+// on this list; the faces are appended as they are oriented, and the
+// list doubles as the queue of faces whose neighbors are still to be
+// visited, so the faces are visited breadth-first without recursing.
 //
 void
-FaceList::recursivelyOrient(Face *seed)
+FaceList::orientFragment(Face *seed)
 {
     int i, j;
     FaceList others;
 
-    if (seed->degenerate) return;
+    assert(getLength() == 1 && (*this)[0] == seed);
 
-    for (i = 0; i < seed->nv; i++)
+    for (int head = 0; head < getLength(); head++)
     {
-	j = (i+1)%seed->nv;
+	Face *face = (*this)[head];
 
-	// Find other faces attached to this edge
-	ed->OtherFaces(seed, seed->v[i], seed->v[j], others);
+	if (face->degenerate) continue;
 
-	for (int f = 0; f < others.getLength(); f++)
+	for (i = 0; i < face->nv; i++)
 	{
-	    if (others[f]->orientation == Face::UNKNOWN)
+	    j = (i+1)%face->nv;
+
+	    // Find other faces attached to this edge
+	    topo->OtherFaces(face, face->v[i], face->v[j], others);
+
+	    for (int f = 0; f < others.getLength(); f++)
 	    {
-		if (seed->orientation == Face::CW)
-		    others[f]->orientFace((int)seed->v[i], (int)seed->v[j]);
-		else if (seed->orientation == Face::CCW)
-		    others[f]->orientFace((int)seed->v[j], (int)seed->v[i]);
-		else assert(0);	// Should never happen
-
-		append(others[f]);
-		recursivelyOrient(others[f]);
+		if (others[f]->orientation == Face::UNKNOWN)
+		{
+		    if (face->orientation == Face::CW)
+			others[f]->orientFace((int)face->v[i],
+					      (int)face->v[j]);
+		    else if (face->orientation == Face::CCW)
+			others[f]->orientFace((int)face->v[j],
+					      (int)face->v[i]);
+		    else assert(0);	// Should never happen
+
+		    append(others[f]);
+		}
 	    }
 	}
     }
@@ -385,7 +533,10 @@ FaceList::recursivelyOrient(Face *seed)
 void
 FaceList::orientOutward()
 {
-    // int num_fragments = 0;
+    int num_fragments = 0;
+    int num_flat = 0;
+    int num_reversed = 0;
+    SbTime start = SbTime::getTimeOfDay();
 
     //
     // Loop through all the faces; if we find one whose orientation
@@ -399,13 +550,13 @@ FaceList::orientOutward()
 	// First, take a wild guess...
 	f->orientation = Face::CCW;
 
-	// ++num_fragments;
+	++num_fragments;
 
-	FaceList fragment(verts, ed);
+	FaceList fragment(verts, topo);
 	fragment.append(f);
 
-	// Now recursively orient the faces connected to this face.
-	fragment.recursivelyOrient(f);
+	// Now orient the faces connected to this face.
+	fragment.orientFragment(f);
 
 	// Take a reasonable guess for whether or not that first face
 	// is oriented correctly:
@@ -414,12 +565,20 @@ FaceList::orientOutward()
 	if (v*v < 0.00001*0.00001)	// FLAT
 	{
 	    // Do something...
-	    // fprintf(stderr, "Flat fragment found\n");
+	    ++num_flat;
 	}
 	else if (v < 0.0)
+	{
 	    fragment.reverseOrientation();
+	    ++num_reversed;
+	}
     }
-    // fprintf(stderr, "There were %d fragments\n", num_fragments);
+
+    if (verbose)
+	fprintf(stderr, "Oriented %d faces in %d fragments (%d flat, "
+		"%d reversed) in %.3f seconds\n", getLength(),
+		num_fragments, num_flat, num_reversed,
+		(SbTime::getTimeOfDay() - start).getValue());
 }
 
 void
@@ -466,7 +625,7 @@ FaceList::findShapeInfo()
 	    int j = (i+1)%f->nv;
 
 	    // Find other faces attached to this edge
-	    ed->OtherFaces(f, f->v[i], f->v[j], others);
+	    topo->OtherFaces(f, f->v[i], f->v[j], others);
 
 	    if (others.getLength() == 0) {
 		solid = FALSE;
@@ -485,7 +644,7 @@ FaceList::findShapeInfo()
 int
 FaceList::findBodies()
 {
-    buildVertexDict();
+    SbTime start = SbTime::getTimeOfDay();
 
     // clear all faces
     int i;
@@ -493,6 +652,7 @@ FaceList::findBodies()
 	(*this)[i]->body = -1;
 
     int bodyN = 0;
+    FaceList queue;
     
     for (i=0; i<getLength(); i++) {
 	
@@ -502,36 +662,56 @@ FaceList::findBodies()
 	// it's on a previously-undiscovered body
 	if (f->body == -1) {
 	    f->body = bodyN++;
-	    recursivelyMarkBody(f);
+	    markBody(f, queue);
 	}
     }
 
+    if (verbose)
+	fprintf(stderr, "Found %d bodies in %d faces in %.3f seconds\n",
+		bodyN, getLength(),
+		(SbTime::getTimeOfDay() - start).getValue());
+
     return bodyN;
 }
 
+//
+// Marks all faces connected to the given marked face through shared
+// vertices as part of its body.  The faces are visited breadth-first,
+// using the given list as the queue.
+//
 void
-FaceList::recursivelyMarkBody(Face *f)
+FaceList::markBody(Face *seed, FaceList &queue)
 {
     int i;
 
-    assert(f->body != -1);	// only recurse on marked faces
+    assert(seed->body != -1);	// only start from marked faces
+
+    queue.truncate(0);
+    queue.append(seed);
 
-    for (i = 0; i < f->nv; i++)
+    for (int head = 0; head < queue.getLength(); head++)
     {
-	// get list of faces sharing this vertex
-	const FaceList &faces = vd[f->v[i]];
+	Face *f = queue[head];
 
-	for (int j=0; j<faces.getLength(); j++) {
-	    if (faces[j]->body == f->body) {
-		; // nothing to do if the other face is already part of this body
-	    }
-	    else if (faces[j]->body == -1) {
-		// the other face is still unmarked, so mark it and recurse
-		faces[j]->body = f->body;
-		recursivelyMarkBody(faces[j]);
-	    }
-	    else {
-		assert(0);	// vertex dictionary isn't commutative??
+	for (i = 0; i < f->nv; i++)
+	{
+	    // get list of faces sharing this vertex
+	    Face **faces;
+	    int nf = topo->VertexFaces(f->v[i], faces);
+
+	    for (int j=0; j<nf; j++) {
+		if (faces[j]->body == f->body) {
+		    ; // nothing to do if the other face is already part of this body
+		}
+		else if (faces[j]->body == -1) {
+		    // the other face is still unmarked, so mark it and
+		    // visit it later
+		    faces[j]->body = f->body;
+		    queue.append(faces[j]);
+		}
+		else {
+		    assert(0);	// vertex dictionary isn't commutative??
+		}
 	    }
 	}
     }
@@ -557,10 +737,11 @@ FaceList::extractBody(int b,
 
     // build the vertex maps
     int ni, i;
-    for (ni=0, i=0; i < vdSize; i++) {
-	const FaceList &faces = vd[i];
+    for (ni=0, i=0; i < topo->NumVertices(); i++) {
+	Face **faces;
+	int nf = topo->VertexFaces(i, faces);
 	SbBool isInBody = FALSE;
-	for (int j = 0; j < faces.getLength(); j++) if (faces[j]->body == b) {
+	for (int j = 0; j < nf; j++) if (faces[j]->body == b) {
 	    isInBody = TRUE;
 	    break;
 	}
@@ -578,60 +759,45 @@ FaceList::extractBody(int b,
 }
 
 
-void
-FaceList::buildVertexDict()
-{
-    // already built?
-    if (vd) return;
-
-    int biggest_index = 0;
-    int i;
-    for (i = 0; i < getLength(); i++) {
-	Face *f = (*this)[i];
-	for (int j = 0; j < f->nv; j++) {
-	    if (f->v[j] > biggest_index) biggest_index = f->v[j];
-	}
-    }
-
-    vd = new FaceList[biggest_index+1];
-    vdSize = biggest_index+1;
-
-    // Build list of faces around each vertex
-    for (i = 0; i < getLength(); i++)
-    {
-	Face *f = (*this)[i];
-
-	for (int j = 0; j < f->nv; j++)
-	{
-	    vd[f->v[j]].append(f);
-	}
-    }
-
-}
-
-
 void
 FaceList::findVertexNormals(SoNormal *norm, SoIndexedFaceSet *ifs,
 			    float creaseAngle)
 {
-    buildVertexDict();
-
-    // Initialize all faces
+    // Size the normal indices up front, rather than growing them one
+    // at a time.  There is at most one normal per face vertex.
+    int numIndices = 0;
     int i;
+    for (i = 0; i < getLength(); i++)
+	numIndices += (*this)[i]->nv + 1;
+
+    // Initialize all faces, giving each its part of one array of
+    // vertex normal indices
+    findNormals();
+    delete [] vnArray;
+    vnArray = new int32_t[numIndices - getLength()];
+    int32_t *vn = vnArray;
     for (i = 0; i < getLength(); i++)
     {
 	Face *f = (*this)[i];
 
-	f->findNormal(verts);
-	f->vn = new int32_t[f->nv];
+	f->vn = vn;
+	vn += f->nv;
 	for (int j = 0; j < f->nv; j++)
 	{
 	    f->vn[j] = -1;
 	}
     }
-    
+    if (ifs->normalIndex.getNum() < numIndices)
+	ifs->normalIndex.setNum(numIndices);
+    int32_t *normalIndices = ifs->normalIndex.startEditing();
+
     // Finally, create normals
     norm->vector.deleteValues(0);	// get rid of default value
+    NormalDict *nd = NULL;
+    if (! legacyNormals)
+	nd = new NormalDict(norm->vector, numIndices - getLength());
+    float cosCrease = (float)cos(creaseAngle);
+    Face **within = new Face *[topo->MaxVertexFaces()];
     int count = 0;
     for (i = 0; i < getLength(); i++)
     {
@@ -641,33 +807,40 @@ FaceList::findVertexNormals(SoNormal *norm, SoIndexedFaceSet *ifs,
 	{
 	    if (f->degenerate)
 	    {
-		f->vn[j] = getIdx(norm->vector, SbVec3f(0,0,0));
+		f->vn[j] = getIdx(norm->vector, nd, SbVec3f(0,0,0));
 	    }
 	    else if (f->vn[j] == -1)
 	    {
-		SbVec3f t;
-		vd[f->v[j]].averageNormals(norm->vector, f->normal,
-					      creaseAngle,
-					      f->v[j]);
+		Face **faces;
+		int nf = topo->VertexFaces(f->v[j], faces);
+		averageNormals(faces, nf, norm->vector, nd, f->normal,
+			       cosCrease, f->v[j], within);
 	    }
-	    ifs->normalIndex.set1Value(count, f->vn[j]);
+	    normalIndices[count] = f->vn[j];
 	    ++count;
 	}
-	ifs->normalIndex.set1Value(count, SO_END_FACE_INDEX);
+	normalIndices[count] = SO_END_FACE_INDEX;
 	++count;
     }
+    delete [] within;
+    delete nd;
+    ifs->normalIndex.finishEditing();
 }
 
 //
 // get the index of a vector in a SFVec3f;
-// adds the vector if needed.
+// adds the vector if needed.  Uses the normal dictionary
+// for the field if there is one.
 //
 // use: private
 //
 
 int
-FaceList::getIdx(SoMFVec3f &mf, const SbVec3f &p)
+FaceList::getIdx(SoMFVec3f &mf, NormalDict *nd, const SbVec3f &p)
 {
+    if (nd != NULL)
+	return nd->Enter(p);
+
     int n = mf.getNum();
     SbVec3f *v = mf.startEditing();
 
@@ -684,33 +857,34 @@ FaceList::getIdx(SoMFVec3f &mf, const SbVec3f &p)
 }
 
 //
-// Average the normals around a vertex to get a vertex normal.  Skip
-// faces that are too different (as defined by creaseAngle)
+// Average the normals of the faces around a vertex to get a vertex
+// normal.  Skip faces that are too different (those whose normals
+// are at less than cosCrease, the cosine of the crease angle, to the
+// reference).  The faces used are kept in within[], which must have
+// room for all of them, so the angles are found only once.
 //
 void
-FaceList::averageNormals(SoMFVec3f &norms, SbVec3f &reference,
-			 float creaseAngle, int whichV)
+FaceList::averageNormals(Face **faces, int max, SoMFVec3f &norms,
+			 NormalDict *nd, const SbVec3f &reference,
+			 float cosCrease, int whichV, Face **within)
 {
     SbVec3f average;
     average.setValue(0.0, 0.0, 0.0);
 
-    float ca = (float)cos(creaseAngle);
-
     int num = 0;
-    int max = getLength();
 
     // first, loop through and compute the average
     int i;
     for (i = 0; i < max; i++)
     {
-	Face *f = (*this)[i];
+	Face *f = faces[i];
 	if (f->degenerate) continue;
 
 	float dp = reference.dot(f->normal);
-	if (dp >= ca)
+	if (dp >= cosCrease)
 	{
-	    average += f->normal; ++num;
-
+	    average += f->normal;
+	    within[num++] = f;
 	}
     }
     assert(num != 0);
@@ -718,26 +892,16 @@ FaceList::averageNormals(SoMFVec3f &norms, SbVec3f &reference,
     average.normalize();
 
     // insert the average into the mfield
-    int index = getIdx(norms, average);
+    int index = getIdx(norms, nd, average);
 
-    // loop through again and insert the average's index
-    // into the face arrays
-    for (i = 0; i < max; i++)
+    // insert the average's index into the arrays of the faces used
+    for (i = 0; i < num; i++)
     {
-	Face *f = (*this)[i];
-	if (f->degenerate) continue;
-
-	float dp = reference.dot(f->normal);
-	if (dp >= ca)
+	Face *f = within[i];
+	for (int j = 0; j < f->nv; j++)
 	{
-	    for (int j = 0; j < f->nv; j++)
-	    {
-		if (f->v[j] == whichV)
-		    f->vn[j] = index;
-	    }
+	    if (f->v[j] == whichV)
+		f->vn[j] = index;
 	}
     }
-    assert(num != 0);
-    average /= (float)num;
-    average.normalize();
 }
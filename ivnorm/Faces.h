@@ -44,7 +44,8 @@
 #include <Inventor/misc/SoBasic.h>
 #include <Inventor/SbPList.h>
 
-class EdgeDict;
+class MeshTopology;
+class NormalDict;
 class SbVec3f;
 class SoNormal;
 class SoIndexedFaceSet;
@@ -71,6 +72,7 @@ class Face
     Orientation orientation;
 
     void findNormal(const SbVec3f *verts);
+    void finishNormal();
     void orientFace(int, int);
 
 };
@@ -89,6 +91,7 @@ class FaceList : public SbPList
 
     void findOrientation();
     void correctOrientation();
+    void findNormals();		// finds every face's normal
     void findFacetNormals(SoNormal *);
     void findVertexNormals(SoNormal *, SoIndexedFaceSet *, float);
 
@@ -105,28 +108,39 @@ class FaceList : public SbPList
     void setVerbose(SbBool v) { verbose = v; }
     SbBool isVerbose() const { return verbose; }
 
+    // Pass TRUE to find each vertex normal in the normals found so
+    // far by searching them, as ivnorm always used to, rather than
+    // by hashing.  The result is the same either way.
+    void setLegacyNormals(SbBool l) { legacyNormals = l; }
+    SbBool isLegacyNormals() const { return legacyNormals; }
+
+
+    // The adjacency of the faces, built when the list is made from a
+    // face set
+    const MeshTopology *getTopology() const { return topo; }
 
   private:
-    FaceList(const SbVec3f *, EdgeDict *);
+    FaceList(const SbVec3f *, MeshTopology *);
     float volume();
     void reverseOrientation();	// reverse orientation of all on list
-    void recursivelyOrient(Face *);
-    void recursivelyMarkBody(Face *);
+    void orientFragment(Face *);
+    void markBody(Face *, FaceList &);
     void orientOutward();
-    void averageNormals(SoMFVec3f &, SbVec3f &, float, int);
-    void buildVertexDict();
+    static void averageNormals(Face **, int, SoMFVec3f &, NormalDict *,
+			       const SbVec3f &, float, int, Face **);
 
     int convex;
     int solid;
     const SbVec3f *verts;
-    EdgeDict *ed;
-    FaceList	*vd;	// vertex dictionary
-    int		vdSize;
+    MeshTopology *topo;
+    Face	*faceArray;	// all faces, when made from a face set
+    int32_t	*vnArray;	// all faces' vertex normal indices
     SoIndexedFaceSet *faceSet;
 
     SbBool verbose;
+    SbBool legacyNormals;
 
-    static int getIdx(SoMFVec3f &mf, const SbVec3f &p);
+    static int getIdx(SoMFVec3f &mf, NormalDict *nd, const SbVec3f &p);
 };
 
 //
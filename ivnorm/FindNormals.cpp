@@ -41,6 +41,8 @@
 #include <assert.h>
 #include <math.h>
 
+#include <Inventor/SbDict.h>
+#include <Inventor/SbTime.h>
 #include <Inventor/SoDB.h>
 #include <Inventor/nodes/SoGroup.h>
 #include <Inventor/nodes/SoIndexedFaceSet.h>
@@ -49,15 +51,24 @@
 #include <Inventor/nodes/SoCoordinate3.h>
 #include <Inventor/nodes/SoShapeHints.h>
 #include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/threads/SbThread.h>
 
 #include "FindNormals.h"
-#include "Edges.h"
 
 FindNormals::FindNormals()
 {
     defaultOrientation = Face::UNKNOWN;
     creaseAngle = (float)M_PI/6;
+    legacyNormals = FALSE;
+    numThreads = 1;
     verbose = FALSE;
+
+    jobs = NULL;
+    numJobs = 0;
+    nextJob = 0;
+    jobVertexNormals = FALSE;
+    jobMutex = NULL;
 }
 
 FindNormals::~FindNormals()
@@ -85,6 +96,12 @@ FindNormals::apply(SoNode *root, int doVertexNormals)
     sa.apply(root);
     SoPathList &paths = sa.getPaths();
     if (verbose) fprintf(stderr, "FindNormals: searching finished.\n");
+
+    if (numThreads > 1 && paths.getLength() > 1) {
+	applyThreaded(paths, doVertexNormals);
+	return;
+    }
+
     for (int i=0; i < paths.getLength(); i++) {
 	if (verbose && !(i%50))
 	    fprintf(stderr, "FindNormals: faceSet %d of %d\n",
@@ -128,11 +145,29 @@ FindNormals::searchLastType(SoPath *p, SoType t)
 
 void
 FindNormals::doIndexedFaceSet(SoPath *p, int doVertexNormals)
+{
+    FaceSetJob job;
+
+    if (! prepareFaceSet(p, job))
+	return;
+
+    findFaceNormals(job, doVertexNormals);
+    finishFaceSet(job, doVertexNormals);
+}
+
+//
+// Checks whether the face set at the end of the path needs normals,
+// and if so inserts empty Normal and NormalBinding nodes in front of
+// it and fills in the job.  Later face sets under the same group see
+// these nodes, just as if this one had been finished already.
+//
+SbBool
+FindNormals::prepareFaceSet(SoPath *p, FaceSetJob &job)
 {
     // If there is already a normal node, bail
 
     if (searchLastType(p, SoNormal::getClassTypeId()) != NULL)
-	return;
+	return FALSE;
 
     //
     // First, find Coordinates in path:
@@ -144,21 +179,6 @@ FindNormals::doIndexedFaceSet(SoPath *p, int doVertexNormals)
 
     assert(coords != NULL);
 
-    FaceList faces(coords->point.getValues(0), ifs);
-
-    if (defaultOrientation == Face::UNKNOWN)
-    {
-	faces.findOrientation();
-    }
-    else
-    {
-	for (int i = 0; i < faces.getLength(); i++)
-	{
-	    faces[i]->orientation = defaultOrientation;
-	}
-	faces.correctOrientation();
-    }
-
     SoNormal *n = new SoNormal;
     SoNormalBinding *normb = new SoNormalBinding;
 
@@ -174,22 +194,189 @@ FindNormals::doIndexedFaceSet(SoPath *p, int doVertexNormals)
     g->insertChild(normb, index);
     g->insertChild(n, index);
 
+    job.ifs = ifs;
+    job.verts = coords->point.getValues(0);
+    job.group = g;
+    job.normal = n;
+    job.normalBinding = normb;
+    job.solid = FALSE;
+    job.next = NULL;
+
+    return TRUE;
+}
+
+//
+// Orients the faces of the face set in a job and finds their
+// normals.  This changes only the fields of the face set and of the
+// job's Normal node, so different face sets can be done at once.
+//
+void
+FindNormals::findFaceNormals(FaceSetJob &job, int doVertexNormals)
+{
+    FaceList faces(job.verts, job.ifs, verbose);
+    faces.setLegacyNormals(legacyNormals);
+
+    if (defaultOrientation == Face::UNKNOWN)
+    {
+	faces.findOrientation();
+    }
+    else
+    {
+	for (int i = 0; i < faces.getLength(); i++)
+	{
+	    faces[i]->orientation = defaultOrientation;
+	}
+	faces.correctOrientation();
+    }
+
     faces.findShapeInfo();
-    if (faces.isSolid()) {
+    if (verbose)
+	faces.findBodies();	// Just to report how many there are
+    job.solid = faces.isSolid();
+
+    if (doVertexNormals)
+	faces.findVertexNormals(job.normal, job.ifs, creaseAngle);
+    else
+	faces.findFacetNormals(job.normal);
+}
+
+//
+// Sets the normal binding of a job, and inserts ShapeHints in front
+// of its Normal node if the face set is solid.
+//
+void
+FindNormals::finishFaceSet(FaceSetJob &job, int doVertexNormals)
+{
+    if (job.solid) {
 	SoShapeHints *hints = new SoShapeHints;
 	hints->vertexOrdering = SoShapeHints::COUNTERCLOCKWISE;
 	hints->shapeType = SoShapeHints::SOLID;
-	g->insertChild(hints, index);
+	job.group->insertChild(hints, job.group->findChild(job.normal));
     }
 
     if (doVertexNormals)
-    {
-	faces.findVertexNormals(n, ifs, creaseAngle);
-	normb->value.setValue(SoNormalBinding::PER_VERTEX_INDEXED);
-    }
+	job.normalBinding->value.setValue(SoNormalBinding::PER_VERTEX_INDEXED);
     else
-    {
-	faces.findFacetNormals(n);
-	normb->value.setValue(SoNormalBinding::PER_FACE);
+	job.normalBinding->value.setValue(SoNormalBinding::PER_FACE);
+}
+
+//
+// Finds normals for the face sets at the ends of the paths with
+// several threads.  First the nodes are inserted into the graph for
+// each face set in order, as apply() would, then the normals are
+// found at once, and then the rest of the nodes are inserted in
+// order.  A face set used by more than one path is done by one
+// thread, in order, since each pass changes it.  Notification of the
+// fields changed by the threads is turned off while they run.
+//
+void
+FindNormals::applyThreaded(SoPathList &paths, int doVertexNormals)
+{
+    SbTime start = SbTime::getTimeOfDay();
+
+    int numPaths = paths.getLength();
+    FaceSetJob *allJobs = new FaceSetJob[numPaths];
+    SbBool *prepared = new SbBool[numPaths];
+    jobs = new FaceSetJob *[numPaths];
+    numJobs = 0;
+
+    // The last job for each face set so far
+    SbDict lastJobs;
+
+    int i;
+    for (i = 0; i < numPaths; i++) {
+	SoGroup *parent = (SoGroup*)paths[i]->getNodeFromTail(1);
+	SbBool pNot = parent->enableNotify(FALSE);
+	prepared[i] = prepareFaceSet(paths[i], allJobs[i]);
+	parent->enableNotify(pNot);
+	if (! prepared[i])
+	    continue;
+
+	FaceSetJob *job = &allJobs[i];
+	void *last;
+	if (lastJobs.find((SbDict::Key)job->ifs, last)) {
+	    ((FaceSetJob *)last)->next = job;
+	}
+	else {
+	    jobs[numJobs++] = job;
+	    job->ifs->coordIndex.enableNotify(FALSE);
+	    job->ifs->normalIndex.enableNotify(FALSE);
+	}
+	job->normal->vector.enableNotify(FALSE);
+	lastJobs.enter((SbDict::Key)job->ifs, job);
+    }
+
+    // Start the worker threads. This thread does its share of the
+    // work as well, so we need one less than the number requested.
+    int numWorkers = (numThreads < numJobs ? numThreads : numJobs) - 1;
+    if (numWorkers < 0)
+	numWorkers = 0;
+
+    if (verbose)
+	fprintf(stderr, "FindNormals: %d faceSets with %d threads\n",
+		numJobs, numWorkers + 1);
+
+    nextJob = 0;
+    jobVertexNormals = doVertexNormals;
+    jobMutex = new SbMutex;
+
+    SbThread **workers = new SbThread *[numWorkers];
+    for (i = 0; i < numWorkers; i++)
+	workers[i] = SbThread::create(jobThreadCB, this);
+
+    processJobs();
+
+    for (i = 0; i < numWorkers; i++) {
+	workers[i]->join();
+	SbThread::destroy(workers[i]);
+    }
+    delete [] workers;
+
+    delete jobMutex;
+    jobMutex = NULL;
+
+    // Insert the rest of the nodes in order
+    for (i = 0; i < numPaths; i++) {
+	if (! prepared[i])
+	    continue;
+
+	FaceSetJob &job = allJobs[i];
+	job.ifs->coordIndex.enableNotify(TRUE);
+	job.ifs->normalIndex.enableNotify(TRUE);
+	job.normal->vector.enableNotify(TRUE);
+
+	SbBool pNot = job.group->enableNotify(FALSE);
+	finishFaceSet(job, doVertexNormals);
+	job.group->enableNotify(pNot);
+    }
+
+    delete [] allJobs;
+    delete [] prepared;
+    delete [] jobs;
+    jobs = NULL;
+    numJobs = 0;
+
+    if (verbose)
+	fprintf(stderr, "FindNormals: finished in %.3f seconds\n",
+		(SbTime::getTimeOfDay() - start).getValue());
+}
+
+//
+// Takes face sets off the job list and finds their normals until there
+// are no more. This is run by each thread.
+//
+void
+FindNormals::processJobs()
+{
+    while (TRUE) {
+	jobMutex->lock();
+	int job = nextJob++;
+	jobMutex->unlock();
+
+	if (job >= numJobs)
+	    break;
+
+	for (FaceSetJob *j = jobs[job]; j != NULL; j = j->next)
+	    findFaceNormals(*j, jobVertexNormals);
     }
 }
@@ -41,10 +41,15 @@
 
 #include "Faces.h"
 
+class SoGroup;
+class SoIndexedFaceSet;
 class SoNode;
 class SoPath;
+class SoPathList;
 class SoMFVec3f;
 class SoNormal;
+class SoNormalBinding;
+class SbMutex;
 
 class FindNormals
 {
@@ -68,6 +73,20 @@ class FindNormals
     // beyond which a sharp edge should be formed.
     void setCreaseAngle(float c) { creaseAngle = c; }
 
+    //
+    // Sets the number of threads used to find the normals of
+    // different face sets at once (default is 1).  The nodes are
+    // still inserted into the scene graph by the calling thread, in
+    // the same order, so the result does not depend on the number
+    // of threads.
+    //
+    void setNumThreads(int n) { numThreads = n; }
+
+    // If finding vertex normals, pass TRUE to find shared normals by
+    // searching, as ivnorm used to, rather than by hashing.  This is
+    // much slower, but the result is the same.
+    void setLegacyNormals(SbBool l) { legacyNormals = l; }
+
     //
     // This finds normals in the given scene graph, and inserts
     // Normal and NormalBinding nodes into the scene graph.  It may
@@ -85,9 +104,44 @@ class FindNormals
   private:
     FaceOrientation defaultOrientation;
     float creaseAngle;
+    SbBool legacyNormals;
+    int numThreads;
+
+    //
+    // A face set to find normals for, and the nodes inserted for it
+    //
+    struct FaceSetJob
+    {
+	SoIndexedFaceSet *ifs;
+	const SbVec3f *verts;	// Coordinates used by the face set
+	SoGroup *group;		// Where the nodes are inserted
+	SoNormal *normal;
+	SoNormalBinding *normalBinding;
+	int solid;		// Set by findFaceNormals()
+	FaceSetJob *next;	// Next job for the same face set, if any
+    };
 
     SoNode *searchLastType(SoPath *, SoType);
     void doIndexedFaceSet(SoPath *, int);
 
+    SbBool prepareFaceSet(SoPath *, FaceSetJob &);
+    void findFaceNormals(FaceSetJob &, int);
+    void finishFaceSet(FaceSetJob &, int);
+
+    //
+    // Finding normals with several threads: the jobs are taken off
+    // the list in order by each thread
+    //
+    void applyThreaded(SoPathList &, int);
+    void processJobs();
+    static void *jobThreadCB(void *userData)
+	{ ((FindNormals *)userData)->processJobs(); return NULL; }
+
+    FaceSetJob **jobs;
+    int numJobs;
+    int nextJob;
+    int jobVertexNormals;
+    SbMutex *jobMutex;
+
     SbBool verbose;
 };
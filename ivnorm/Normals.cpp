@@ -0,0 +1,141 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+//
+// Code for the normal dictionary, that finds normals already added to
+// a field by hashing their values.
+//
+
+#include <assert.h>
+#include <string.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include "Normals.h"
+
+NormalDict::NormalDict(SoMFVec3f &f, int max)
+{
+    assert(max >= 0);
+
+    field = &f;
+    field->setNum(max);
+    normals = field->startEditing();
+    n_normals = 0;
+    max_normals = max;
+
+    n_hash = 1024;
+    hash_table = new int32_t[n_hash];
+    for (int i = 0; i < n_hash; i++)
+	hash_table[i] = (-1);
+}
+
+NormalDict::~NormalDict()
+{
+    field->finishEditing();
+    field->setNum(n_normals);
+    delete[] hash_table;
+}
+
+int
+NormalDict::Enter(const SbVec3f &n)
+{
+    //
+    // Look for the normal, stopping at the first empty spot
+    //
+    int hpos = HashFunc(n);
+    while (hash_table[hpos] != (-1))
+    {
+	if (normals[hash_table[hpos]] == n)
+	    return hash_table[hpos];
+	hpos = (hpos+1) & (n_hash-1);
+    }
+
+    //
+    // Not found; add it to the end of the field.  If the table would
+    // get too full, rehash first and find the empty spot again.
+    //
+    assert(n_normals < max_normals);
+    if ((n_normals+1)*2 >= n_hash)
+    {
+	ReHash(n_hash*2);
+	hpos = HashFunc(n);
+	while (hash_table[hpos] != (-1))
+	    hpos = (hpos+1) & (n_hash-1);
+    }
+
+    int index = n_normals++;
+    normals[index] = n;
+    hash_table[hpos] = index;
+
+    return index;
+}
+
+//
+// Hashes the bits of the coordinates.  Adding 0 turns -0 into 0, since
+// the two compare equal.  (NaNs never compare equal, so each one is
+// added anew, as when searching.)
+//
+int
+NormalDict::HashFunc(const SbVec3f &n)
+{
+    uint32_t h = 0;
+    for (int i = 0; i < 3; i++)
+    {
+	float c = n[i] + 0.0f;
+	uint32_t bits;
+	memcpy(&bits, &c, sizeof(bits));
+	h = (h ^ bits) * 16777619;
+    }
+    h ^= h >> 15;
+    return (int)(h & (uint32_t)(n_hash-1));
+}
+
+void
+NormalDict::ReHash(int newsize)
+{
+    delete[] hash_table;
+    hash_table = new int32_t[newsize];
+    int i;
+    for (i = 0; i < newsize; i++)
+	hash_table[i] = (-1);
+    n_hash = newsize;
+
+    for (i = 0; i < n_normals; i++)
+    {
+	int hpos = HashFunc(normals[i]);
+	while (hash_table[hpos] != (-1))
+	    hpos = (hpos+1) & (n_hash-1);
+	hash_table[hpos] = i;
+    }
+}
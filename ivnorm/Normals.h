@@ -0,0 +1,81 @@
+#ifndef _NORMALS_
+#define _NORMALS_
+
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+//
+// A dictionary of normal vectors, that finds the index of a normal
+// in an SoMFVec3f without searching the whole field.
+//
+
+#include <Inventor/misc/SoBasic.h>
+#include <Inventor/SbLinear.h>
+
+class SoMFVec3f;
+
+class NormalDict
+{
+  public:
+    //
+    // The field is emptied and grown to hold max_normals values, one
+    // for each call to Enter().  The destructor shrinks it to the
+    // normals actually entered.
+    //
+    NormalDict(SoMFVec3f &field, int max_normals);
+    ~NormalDict();
+
+    //
+    // Returns the index of the normal in the field, adding it to the
+    // end if it is not there.  Normals are equal if they compare
+    // equal with ==, so the result is the same as searching the
+    // field.
+    //
+    int Enter(const SbVec3f &n);
+
+  private:
+    int HashFunc(const SbVec3f &n);
+    void ReHash(int new_size);
+
+    SoMFVec3f *field;
+    SbVec3f *normals;	// Values of the field, being edited
+    int n_normals;	// # of normals entered
+    int max_normals;	// room in the field
+    int32_t *hash_table;	// indices of normals, or -1
+    int n_hash;	// length of hash table
+};
+
+#endif
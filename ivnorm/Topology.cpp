@@ -0,0 +1,189 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+//
+// Code for the mesh topology class, that supports fast querying of
+// the faces around a vertex or an edge.
+//
+
+#include <assert.h>
+#include "Faces.h"
+#include "Topology.h"
+
+MeshTopology::MeshTopology()
+{
+    n_vertices = 0;
+    n_corners = 0;
+    n_edge_entries = 0;
+    max_vertex_faces = 0;
+    vertex_start = NULL;
+    vertex_faces = NULL;
+    edge_start = NULL;
+    edge_other = NULL;
+    edge_faces = NULL;
+}
+
+MeshTopology::~MeshTopology()
+{
+    delete[] vertex_start;
+    delete[] vertex_faces;
+    delete[] edge_start;
+    delete[] edge_other;
+    delete[] edge_faces;
+}
+
+void
+MeshTopology::Build(const FaceList &faces)
+{
+    int i, j;
+    int n_faces = faces.getLength();
+
+    //
+    // First pass: find the number of vertices, and count the faces
+    // around each vertex and the edges stored with each vertex.
+    //
+    n_vertices = 0;
+    for (i = 0; i < n_faces; i++)
+    {
+	Face *f = faces[i];
+	for (j = 0; j < f->nv; j++)
+	{
+	    if (f->v[j] >= n_vertices) n_vertices = f->v[j]+1;
+	}
+    }
+
+    vertex_start = new int[n_vertices+1];
+    edge_start = new int[n_vertices+1];
+    for (i = 0; i <= n_vertices; i++)
+    {
+	vertex_start[i] = 0;
+	edge_start[i] = 0;
+    }
+
+    for (i = 0; i < n_faces; i++)
+    {
+	Face *f = faces[i];
+	for (j = 0; j < f->nv; j++)
+	{
+	    ++vertex_start[f->v[j]+1];
+
+	    if (f->degenerate) continue;
+	    int32_t v1 = f->v[j];
+	    int32_t v2 = f->v[(j+1)%f->nv];
+	    if (v1 != v2)
+		++edge_start[(v1 < v2 ? v1 : v2)+1];
+	}
+    }
+
+    //
+    // Turn the counts into offsets
+    //
+    for (i = 0; i < n_vertices; i++)
+    {
+	vertex_start[i+1] += vertex_start[i];
+	edge_start[i+1] += edge_start[i];
+    }
+    n_corners = vertex_start[n_vertices];
+    n_edge_entries = edge_start[n_vertices];
+    max_vertex_faces = 0;
+    for (i = 0; i < n_vertices; i++)
+    {
+	int n = vertex_start[i+1] - vertex_start[i];
+	if (n > max_vertex_faces) max_vertex_faces = n;
+    }
+
+    //
+    // Second pass: fill in the entries in order of the faces, moving
+    // each start along as its row is filled; afterwards each start
+    // is where the next row began, so shift them back.
+    //
+    vertex_faces = new Face *[n_corners];
+    edge_other = new int32_t[n_edge_entries];
+    edge_faces = new Face *[n_edge_entries];
+
+    for (i = 0; i < n_faces; i++)
+    {
+	Face *f = faces[i];
+	for (j = 0; j < f->nv; j++)
+	{
+	    vertex_faces[vertex_start[f->v[j]]++] = f;
+
+	    if (f->degenerate) continue;
+	    int32_t v1 = f->v[j];
+	    int32_t v2 = f->v[(j+1)%f->nv];
+	    if (v1 == v2) continue;
+	    if (v1 > v2) { int32_t t = v1; v1 = v2; v2 = t; }
+	    int pos = edge_start[v1]++;
+	    edge_other[pos] = v2;
+	    edge_faces[pos] = f;
+	}
+    }
+
+    for (i = n_vertices; i > 0; i--)
+    {
+	vertex_start[i] = vertex_start[i-1];
+	edge_start[i] = edge_start[i-1];
+    }
+    vertex_start[0] = 0;
+    edge_start[0] = 0;
+}
+
+void
+MeshTopology::OtherFaces(Face *f, int32_t v1, int32_t v2,
+			 FaceList &result) const
+{
+    assert(f != NULL);
+
+    result.truncate(0);	// Empty list
+
+    if (v1 == v2) return;	// Degenerate edge, no neighbors
+
+    if (v1 > v2) { int32_t t = v1; v1 = v2; v2 = t; }
+
+    for (int i = edge_start[v1]; i < edge_start[v1+1]; i++)
+    {
+	if (edge_other[i] == v2 && edge_faces[i] != f)
+	    result.append(edge_faces[i]);
+    }
+}
+
+size_t
+MeshTopology::NumBytes() const
+{
+    return (2 * (n_vertices+1) * sizeof(int) +
+	    n_corners * sizeof(Face *) +
+	    n_edge_entries * (sizeof(int32_t) + sizeof(Face *)));
+}
@@ -0,0 +1,107 @@
+#ifndef _TOPOLOGY_
+#define _TOPOLOGY_
+
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+//
+// Compact adjacency of the faces in a FaceList: the faces around each
+// vertex, and the faces on each edge.  Both are stored in compressed
+// sparse rows (an array of offsets, one per vertex, into one array
+// of entries), built with a few linear passes over the faces.
+//
+
+#include <Inventor/misc/SoBasic.h>
+
+class Face;
+class FaceList;
+
+class MeshTopology
+{
+  public:
+    MeshTopology();
+    ~MeshTopology();
+
+    //
+    // Builds the adjacency of the faces in the list.  As with
+    // EdgeDict, the edges of degenerate faces and degenerate edges
+    // are left out.
+    //
+    void Build(const FaceList &faces);
+
+    // One more than the largest vertex index used by a face
+    int NumVertices() const { return n_vertices; }
+
+    //
+    // Returns the faces around a vertex, in the order of the list.
+    // A face that uses the vertex more than once is listed that
+    // many times.
+    //
+    int VertexFaces(int32_t v, Face **&faces) const
+	{ faces = vertex_faces + vertex_start[v];
+	  return vertex_start[v+1] - vertex_start[v]; }
+
+    // The most faces around any one vertex
+    int MaxVertexFaces() const { return max_vertex_faces; }
+
+    //
+    // Finds the faces other than the given one that share the edge
+    // between v1 and v2, in the same order as EdgeDict::OtherFaces().
+    //
+    void OtherFaces(Face *, int32_t v1, int32_t v2, FaceList &result) const;
+
+    // Bytes used by the arrays
+    size_t NumBytes() const;
+
+  private:
+    int n_vertices;
+    int n_corners;	// # of entries around vertices
+    int n_edge_entries;	// # of entries on edges
+    int max_vertex_faces;	// longest row of vertex_faces
+
+    // Faces around vertex v are vertex_faces[vertex_start[v]] up to
+    // vertex_faces[vertex_start[v+1]]
+    int *vertex_start;
+    Face **vertex_faces;
+
+    // Each edge is stored with its lower vertex, along with its
+    // other vertex and the face it came from
+    int *edge_start;
+    int32_t *edge_other;
+    Face **edge_faces;
+};
+
+#endif
@@ -90,6 +90,8 @@
 Face::Orientation orientation = Face::UNKNOWN;
 float       creaseAngle = (float)M_PI/6.f;                // 30 degrees
 int         findVNorms  = 0;
+int         legacyNormals = 0;
+int         numThreads = 1;
 int         verbose = 0;
 
 
@@ -101,6 +103,8 @@ printUsage()
     (void)fprintf(stderr, "\t-C        Assume clockwise faces\n");
     (void)fprintf(stderr, "\t-v        Find vertex normals\n");
     (void)fprintf(stderr, "\t-a angle  Use angle (in degrees) as crease angle\n");
+    (void)fprintf(stderr, "\t-l        Find shared vertex normals by linear search\n");
+    (void)fprintf(stderr, "\t-j num    Find normals using num threads (default 1)\n");
     (void)fprintf(stderr, "\t-V        verbose trace\n");
     (void)fprintf(stderr, "\t-h        This message (help)\n");
     (void)fprintf(stderr, "If input or output file name is not specified,\n");
@@ -127,7 +131,7 @@ ParseCommandLine(int argc, char **argv, const char **inFileName, const char **ou
     *outFileName = NULL;
     err = 0;
 
-    while ((c = getopt(argc, argv, "cCva:bVh")) != -1)
+    while ((c = getopt(argc, argv, "cCva:blj:Vh")) != -1)
     {
         switch(c)
         {
@@ -145,6 +149,14 @@ ParseCommandLine(int argc, char **argv, const char **inFileName, const char **ou
             // convert from given arg (in degrees) to radians
             creaseAngle = (float)atof(optarg) * (float)M_PI / 180.f;
             break;
+          case 'l':
+            legacyNormals = TRUE;
+            break;
+          case 'j':
+            numThreads = atoi(optarg);
+            if (numThreads < 1)
+                err = 1;
+            break;
           case 'V':
             verbose = TRUE;
             break;
@@ -203,6 +215,8 @@ main(int argc, char **argv)
     FindNormals normalFinder;
     normalFinder.AssumeOrientation(orientation);
     normalFinder.setCreaseAngle(creaseAngle);
+    normalFinder.setLegacyNormals(legacyNormals);
+    normalFinder.setNumThreads(numThreads);
     normalFinder.setVerbose(verbose);
 
     const char *inputName = inFileName ? inFileName : "stdin";
@@ -0,0 +1,847 @@
+/*
+ *
+ *  Copyright (C) 2000 Silicon Graphics, Inc.  All Rights Reserved. 
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  Further, this software is distributed without any warranty that it is
+ *  free of the rightful claim of any third person regarding infringement
+ *  or the like.  Any license provided herein, whether implied or
+ *  otherwise, applies only to this software file.  Patent licenses, if
+ *  any, provided herein do not apply to combinations of this program with
+ *  other software, or any other product whatsoever.
+ * 
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact information: Silicon Graphics, Inc., 1600 Amphitheatre Pkwy,
+ *  Mountain View, CA  94043, or:
+ * 
+ *  http://www.sgi.com 
+ * 
+ *  For further information regarding this notice, see: 
+ * 
+ *  http://oss.sgi.com/projects/GenInfo/NoticeExplan/
+ *
+ */
+
+//
+// ivnormbench: compares the old and new adjacency structures of
+// ivnorm on a mesh.  The faces of the largest IndexedFaceSet in the
+// given scene (or of a generated grid) are put into an EdgeDict and a
+// per-vertex array of FaceLists, each face allocated by itself, the
+// way ivnorm used to, and into the compressed rows of MeshTopology.
+// The time and memory taken to build each, and the time to find the
+// faces across every edge of every face, are reported.  The faces
+// found by the two are checked to be identical.
+//
+// Then the face normals are found one face at a time, the way ivnorm
+// used to, and all at once by FaceList::findNormals(), and the vertex
+// normals are found with the old two passes over the faces around
+// each vertex and by FaceList::findVertexNormals().  The rates of
+// each are reported, and the normals are checked to be identical.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <new>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoInteraction.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+#include "Faces.h"
+#include "Edges.h"
+#include "Normals.h"
+#include "Topology.h"
+
+#include "../make/Common.h"
+
+//
+// Memory is measured by replacing the global operator new, keeping
+// the size of each block in front of it.
+//
+static size_t curBytes = 0;
+static size_t peakBytes = 0;
+static long numAllocs = 0;
+
+#define HEADER_SIZE 16
+
+void *
+operator new(size_t size)
+{
+    char *p = (char *)malloc(size + HEADER_SIZE);
+    if (p == NULL)
+	throw std::bad_alloc();
+    *(size_t *)p = size;
+    curBytes += size;
+    if (curBytes > peakBytes) peakBytes = curBytes;
+    ++numAllocs;
+    return p + HEADER_SIZE;
+}
+
+void
+operator delete(void *p) noexcept
+{
+    if (p == NULL) return;
+    char *h = (char *)p - HEADER_SIZE;
+    curBytes -= *(size_t *)h;
+    free(h);
+}
+
+void
+operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+//
+// The faces of the face set: where each one's vertex indices start,
+// and how many there are
+//
+struct FaceSpans
+{
+    int num;
+    int32_t **v;
+    int *nv;
+};
+
+//
+// The cost of building one structure
+//
+struct BenchResult
+{
+    double buildTime;	// Best time to build, in seconds
+    double queryTime;	// Best time to find the faces across all edges
+    long allocs;	// Allocations made while building
+    size_t bytes;	// Most bytes allocated while building
+};
+
+//
+// The cost of finding normals one way
+//
+struct NormalsResult
+{
+    double faceTime;	// Best time to find the face normals
+    double vertexTime;	// Best time to find the vertex normals
+};
+
+static void printUsage();
+static SoIndexedFaceSet *makeGrid(int n, SoCoordinate3 *coords);
+static void findFaces(SoIndexedFaceSet *ifs, FaceSpans &spans);
+static void initFace(Face *f, int32_t *v, int nv, const SbVec3f *verts);
+static void benchOld(const FaceSpans &, const SbVec3f *, int, BenchResult &);
+static void benchNew(const FaceSpans &, const SbVec3f *, int, BenchResult &);
+static SbBool compare(const FaceSpans &, const SbVec3f *);
+static SbBool benchNormals(SoIndexedFaceSet *, const SbVec3f *, float, int,
+			   NormalsResult &, NormalsResult &);
+
+
+int
+main(int argc, char **argv)
+{
+    updateProgName(argv[0]);
+
+    SoInteraction::init();
+
+    // Parse arguments
+    int numReps = 5;
+    int gridSize = 0;
+    float creaseAngle = (float)M_PI/6;
+    int err = 0;
+    int c;
+
+    while ((c = getopt(argc, argv, "a:g:hr:")) != -1)
+    {
+	switch(c)
+	{
+	  case 'a':
+	    creaseAngle = (float)atof(optarg) * (float)M_PI / 180.f;
+	    break;
+	  case 'g':
+	    gridSize = atoi(optarg);
+	    if (gridSize < 1) err = 1;
+	    break;
+	  case 'r':
+	    numReps = atoi(optarg);
+	    if (numReps < 1) err = 1;
+	    break;
+	  case 'h':	// Help
+	  default:
+	    err = 1;
+	    break;
+	}
+    }
+
+    const char *inFileName = (optind < argc) ? argv[optind++] : NULL;
+    if (optind < argc || (gridSize > 0 && inFileName != NULL) || err)
+	printUsage();
+
+    SoTexture2noLoad::override();
+    SoTexture3noLoad::override();
+    SoVRMLImageTextureNoLoad::override();
+
+    SoCoordinate3 *coords = NULL;
+    SoIndexedFaceSet *ifs = NULL;
+    SoSeparator *root = NULL;
+
+    if (gridSize > 0)
+    {
+	coords = new SoCoordinate3;
+	coords->ref();
+	ifs = makeGrid(gridSize, coords);
+	ifs->ref();
+    }
+    else
+    {
+	// Read the scene, and find the face set with the most indices
+	SoInput in;
+	OPEN_INPUT_FILE(&in, inFileName, FALSE, printUsage);
+	root = SoDB::readAll(&in);
+	if (root == NULL)
+	{
+	    FILE_READ_ERROR(inFileName, progname);
+	}
+	CLOSE_INPUT_FILE(&in, inFileName);
+	root->ref();
+
+	SoSearchAction sa;
+	sa.setType(SoIndexedFaceSet::getClassTypeId());
+	sa.setInterest(SoSearchAction::ALL);
+	sa.apply(root);
+	SoPathList &paths = sa.getPaths();
+	for (int i = 0; i < paths.getLength(); i++)
+	{
+	    SoIndexedFaceSet *f = (SoIndexedFaceSet *)paths[i]->getTail();
+	    if (ifs != NULL &&
+		f->coordIndex.getNum() <= ifs->coordIndex.getNum())
+		continue;
+
+	    SoSearchAction csa;
+	    csa.setType(SoCoordinate3::getClassTypeId());
+	    csa.setInterest(SoSearchAction::LAST);
+	    csa.apply(paths[i]);
+	    if (csa.getPath() == NULL) continue;
+
+	    ifs = f;
+	    coords = (SoCoordinate3 *)csa.getPath()->getTail();
+	}
+	if (ifs == NULL)
+	{
+	    fprintf(stderr, "%s: no IndexedFaceSet with coordinates found\n",
+		    progname);
+	    return 1;
+	}
+	ifs->ref();
+	coords->ref();
+    }
+
+    const SbVec3f *verts = coords->point.getValues(0);
+
+    FaceSpans spans;
+    findFaces(ifs, spans);
+    fprintf(stderr, "%s: %d faces, %d vertices, %d repetitions\n",
+	    progname, spans.num, coords->point.getNum(), numReps);
+
+    BenchResult oldResult, newResult;
+    benchOld(spans, verts, numReps, oldResult);
+    benchNew(spans, verts, numReps, newResult);
+    SbBool same = compare(spans, verts);
+
+    delete [] spans.v;
+    delete [] spans.nv;
+    ifs->coordIndex.finishEditing();
+
+    NormalsResult oldNormals, newNormals;
+    SbBool sameNormals = benchNormals(ifs, verts, creaseAngle, numReps,
+				      oldNormals, newNormals);
+
+    fprintf(stderr, "\n%-22s %12s %12s %12s %12s\n",
+	    "", "build ms", "query ms", "allocs", "peak KB");
+    fprintf(stderr, "%-22s %12.2f %12.2f %12ld %12lu\n",
+	    "EdgeDict + FaceLists", oldResult.buildTime * 1000.0,
+	    oldResult.queryTime * 1000.0, oldResult.allocs,
+	    (unsigned long)(oldResult.bytes / 1024));
+    fprintf(stderr, "%-22s %12.2f %12.2f %12ld %12lu\n",
+	    "MeshTopology", newResult.buildTime * 1000.0,
+	    newResult.queryTime * 1000.0, newResult.allocs,
+	    (unsigned long)(newResult.bytes / 1024));
+    if (newResult.buildTime > 0.0 && newResult.queryTime > 0.0 &&
+	newResult.bytes > 0)
+	fprintf(stderr, "%-22s %11.2fx %11.2fx %12s %11.2fx\n", "speedup",
+		oldResult.buildTime / newResult.buildTime,
+		oldResult.queryTime / newResult.queryTime, "",
+		(double)oldResult.bytes / newResult.bytes);
+
+    // Rates in millions of faces per second
+    double mf = spans.num / 1.0e6;
+    fprintf(stderr, "\n%-22s %12s %12s\n", "", "face Mf/s", "vertex Mf/s");
+    fprintf(stderr, "%-22s %12.2f %12.2f\n", "one at a time",
+	    mf / oldNormals.faceTime, mf / oldNormals.vertexTime);
+    fprintf(stderr, "%-22s %12.2f %12.2f\n", "FaceList",
+	    mf / newNormals.faceTime, mf / newNormals.vertexTime);
+    fprintf(stderr, "%-22s %11.2fx %11.2fx\n", "speedup",
+	    oldNormals.faceTime / newNormals.faceTime,
+	    oldNormals.vertexTime / newNormals.vertexTime);
+
+    ifs->unref();
+    coords->unref();
+    if (root != NULL)
+	root->unref();
+
+    if (! same)
+    {
+	fprintf(stderr, "%s: adjacency structures produced different "
+		"results\n", progname);
+	return 1;
+    }
+    if (! sameNormals)
+    {
+	fprintf(stderr, "%s: face lists produced different normals\n",
+		progname);
+	return 1;
+    }
+
+    return 0;
+}
+
+static void
+printUsage()
+{
+    fprintf(stderr, "Usage: %s [options] [infile]\n", progname);
+    fprintf(stderr,
+	"\t-a ang : Use 'ang' (in degrees) as the crease angle. Default is 30\n"
+	"\t-g num : Use a generated grid of 'num' by 'num' quads, each\n"
+	"\t         split into 2 triangles, instead of reading a file\n"
+	"\t-h     : Print this message (help)\n"
+	"\t-r num : Time each test 'num' times and report the best. Default is 5\n"
+	"If no input file name is specified, stdin is used.\n"
+	);
+
+    exit(99);
+}
+
+//
+// Makes a wavy grid of triangles, with every other row of faces
+// turned over, so that ivnorm has some orienting to do.
+//
+static SoIndexedFaceSet *
+makeGrid(int n, SoCoordinate3 *coords)
+{
+    int x, y;
+
+    coords->point.setNum((n+1)*(n+1));
+    SbVec3f *p = coords->point.startEditing();
+    for (y = 0; y <= n; y++)
+	for (x = 0; x <= n; x++)
+	    p[y*(n+1)+x].setValue((float)x, (float)y,
+				  0.25f*(float)(sin(x*0.3)*cos(y*0.2)));
+    coords->point.finishEditing();
+
+    SoIndexedFaceSet *ifs = new SoIndexedFaceSet;
+    ifs->coordIndex.setNum(n*n*8);
+    int32_t *i = ifs->coordIndex.startEditing();
+    for (y = 0; y < n; y++)
+    {
+	for (x = 0; x < n; x++)
+	{
+	    int32_t a = y*(n+1)+x, b = a+1, c = b+n+1, d = a+n+1;
+	    if (y & 1)
+	    {
+		int32_t t = b; b = d; d = t;
+	    }
+	    *i++ = a; *i++ = b; *i++ = c; *i++ = SO_END_FACE_INDEX;
+	    *i++ = a; *i++ = c; *i++ = d; *i++ = SO_END_FACE_INDEX;
+	}
+    }
+    ifs->coordIndex.finishEditing();
+
+    return ifs;
+}
+
+//
+// Finds the faces in the face set, the way FaceList does.  The
+// indices are left being edited, since faces may reorder them.
+//
+static void
+findFaces(SoIndexedFaceSet *ifs, FaceSpans &spans)
+{
+    int32_t *indices = ifs->coordIndex.startEditing();
+    int ni = ifs->coordIndex.getNum();
+    int i;
+
+    spans.num = 0;
+    for (i = 0; i < ni; i++)
+    {
+	if (indices[i] == SO_END_FACE_INDEX || i == ni-1)
+	    ++spans.num;
+    }
+
+    spans.v = new int32_t *[spans.num];
+    spans.nv = new int[spans.num];
+    int start = 0, n = 0;
+    for (i = 0; i < ni; i++)
+    {
+	if (indices[i] == SO_END_FACE_INDEX || i == ni-1)
+	{
+	    spans.v[n] = indices+start;
+	    spans.nv[n] = (indices[i] == SO_END_FACE_INDEX ?
+			   i - start : i - start + 1);
+	    ++n;
+	    start = i+1;
+	}
+    }
+}
+
+//
+// Sets up a face the way FaceList does
+//
+static void
+initFace(Face *f, int32_t *v, int nv, const SbVec3f *verts)
+{
+    f->nv = nv;
+    f->v = v;
+    f->vn = NULL;
+    f->orientation = Face::UNKNOWN;
+    f->findNormal(verts);
+    if (f->degenerate) f->orientation = Face::CCW;
+}
+
+//
+// Builds the old structures: a Face allocated for each face, an
+// EdgeDict of the faces around each edge, and a FaceList of the faces
+// around each vertex.
+//
+static void
+buildOld(const FaceSpans &spans, const SbVec3f *verts,
+	 FaceList &faces, EdgeDict *&ed, FaceList *&vd)
+{
+    ed = new EdgeDict(1000);
+    int biggest_index = 0;
+
+    for (int i = 0; i < spans.num; i++)
+    {
+	Face *f = new Face;
+	initFace(f, spans.v[i], spans.nv[i], verts);
+	if (! f->degenerate)
+	{
+	    for (int j = 0; j < f->nv; j++)
+	    {
+		int i1 = (int)f->v[j];
+		int i2 = (int)f->v[(j+1)%f->nv];
+		if (i1 != i2)
+		    ed->Add(f, i1, i2);
+	    }
+	}
+	for (int j = 0; j < f->nv; j++)
+	{
+	    if (f->v[j] > biggest_index) biggest_index = f->v[j];
+	}
+	faces.append(f);
+    }
+
+    vd = new FaceList[biggest_index+1];
+    for (int i = 0; i < faces.getLength(); i++)
+    {
+	Face *f = faces[i];
+	for (int j = 0; j < f->nv; j++)
+	    vd[f->v[j]].append(f);
+    }
+}
+
+static void
+freeOld(FaceList &faces, EdgeDict *ed, FaceList *vd)
+{
+    for (int i = 0; i < faces.getLength(); i++)
+	delete faces[i];
+    faces.truncate(0);
+    delete ed;
+    delete [] vd;
+}
+
+//
+// Builds the new structures: one array of faces, and a MeshTopology
+//
+static void
+buildNew(const FaceSpans &spans, const SbVec3f *verts,
+	 FaceList &faces, Face *&faceArray, MeshTopology *&topo)
+{
+    faceArray = new Face[spans.num];
+    for (int i = 0; i < spans.num; i++)
+    {
+	Face *f = faceArray + i;
+	initFace(f, spans.v[i], spans.nv[i], verts);
+	faces.append(f);
+    }
+
+    topo = new MeshTopology;
+    topo->Build(faces);
+}
+
+static void
+freeNew(FaceList &faces, Face *faceArray, MeshTopology *topo)
+{
+    faces.truncate(0);
+    delete [] faceArray;
+    delete topo;
+}
+
+//
+// Finds the faces across every edge of every face, the way
+// FaceList::findShapeInfo() does, and the faces around every vertex
+// of every face, the way FaceList::findBodies() does.  Returns a sum
+// so that the work cannot be skipped.
+//
+static long
+queryOld(FaceList &faces, EdgeDict *ed, FaceList *vd)
+{
+    FaceList others;
+    long sum = 0;
+    for (int i = 0; i < faces.getLength(); i++)
+    {
+	Face *f = faces[i];
+	if (f->degenerate) continue;
+	for (int j = 0; j < f->nv; j++)
+	{
+	    ed->OtherFaces(f, f->v[j], f->v[(j+1)%f->nv], others);
+	    sum += others.getLength();
+	    sum += vd[f->v[j]].getLength();
+	}
+    }
+    return sum;
+}
+
+static long
+queryNew(FaceList &faces, MeshTopology *topo)
+{
+    FaceList others;
+    long sum = 0;
+    for (int i = 0; i < faces.getLength(); i++)
+    {
+	Face *f = faces[i];
+	if (f->degenerate) continue;
+	for (int j = 0; j < f->nv; j++)
+	{
+	    Face **around;
+	    topo->OtherFaces(f, f->v[j], f->v[(j+1)%f->nv], others);
+	    sum += others.getLength();
+	    sum += topo->VertexFaces(f->v[j], around);
+	}
+    }
+    return sum;
+}
+
+static void
+benchOld(const FaceSpans &spans, const SbVec3f *verts, int numReps,
+	 BenchResult &result)
+{
+    for (int rep = 0; rep < numReps; rep++)
+    {
+	FaceList faces;
+	EdgeDict *ed;
+	FaceList *vd;
+
+	size_t startBytes = curBytes;
+	peakBytes = curBytes;
+	long startAllocs = numAllocs;
+	SbTime start = SbTime::getTimeOfDay();
+	buildOld(spans, verts, faces, ed, vd);
+	double t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < result.buildTime) result.buildTime = t;
+	result.allocs = numAllocs - startAllocs;
+	result.bytes = peakBytes - startBytes;
+
+	start = SbTime::getTimeOfDay();
+	queryOld(faces, ed, vd);
+	t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < result.queryTime) result.queryTime = t;
+
+	freeOld(faces, ed, vd);
+    }
+}
+
+static void
+benchNew(const FaceSpans &spans, const SbVec3f *verts, int numReps,
+	 BenchResult &result)
+{
+    for (int rep = 0; rep < numReps; rep++)
+    {
+	FaceList faces;
+	Face *faceArray;
+	MeshTopology *topo;
+
+	size_t startBytes = curBytes;
+	peakBytes = curBytes;
+	long startAllocs = numAllocs;
+	SbTime start = SbTime::getTimeOfDay();
+	buildNew(spans, verts, faces, faceArray, topo);
+	double t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < result.buildTime) result.buildTime = t;
+	result.allocs = numAllocs - startAllocs;
+	result.bytes = peakBytes - startBytes;
+
+	start = SbTime::getTimeOfDay();
+	queryNew(faces, topo);
+	t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < result.queryTime) result.queryTime = t;
+
+	freeNew(faces, faceArray, topo);
+    }
+}
+
+//
+// Checks that both structures find the same faces, in the same order,
+// across every edge and around every vertex
+//
+static SbBool
+compare(const FaceSpans &spans, const SbVec3f *verts)
+{
+    FaceList oldFaces, newFaces;
+    EdgeDict *ed;
+    FaceList *vd;
+    Face *faceArray;
+    MeshTopology *topo;
+    buildOld(spans, verts, oldFaces, ed, vd);
+    buildNew(spans, verts, newFaces, faceArray, topo);
+
+    // The faces are compared by their position in the lists
+    int numFaces = oldFaces.getLength();
+    SbBool same = (newFaces.getLength() == numFaces);
+    int i;
+    for (i = 0; same && i < numFaces; i++)
+    {
+	oldFaces[i]->body = i;
+	newFaces[i]->body = i;
+    }
+
+    FaceList oldOthers, newOthers;
+    for (i = 0; same && i < numFaces; i++)
+    {
+	Face *of = oldFaces[i];
+	Face *nf = newFaces[i];
+	for (int j = 0; same && j < of->nv; j++)
+	{
+	    int k;
+	    if (! of->degenerate)
+	    {
+		int32_t v1 = of->v[j], v2 = of->v[(j+1)%of->nv];
+		ed->OtherFaces(of, v1, v2, oldOthers);
+		topo->OtherFaces(nf, v1, v2, newOthers);
+		same = (oldOthers.getLength() == newOthers.getLength());
+		for (k = 0; same && k < oldOthers.getLength(); k++)
+		    same = (oldOthers[k]->body == newOthers[k]->body);
+	    }
+
+	    Face **around;
+	    int n = topo->VertexFaces(of->v[j], around);
+	    const FaceList &oldAround = vd[of->v[j]];
+	    same = same && (oldAround.getLength() == n);
+	    for (k = 0; same && k < n; k++)
+		same = (oldAround[k]->body == around[k]->body);
+	}
+    }
+
+    freeOld(oldFaces, ed, vd);
+    freeNew(newFaces, faceArray, topo);
+
+    return same;
+}
+
+//
+// Averages the normals of the faces around a vertex, the way ivnorm
+// used to: one pass to find the average, and another to find the
+// faces that were used again and give them its index.
+//
+static void
+oldAverageNormals(Face **faces, int max, NormalDict *nd,
+		  SbVec3f &reference, float creaseAngle, int whichV)
+{
+    SbVec3f average;
+    average.setValue(0.0, 0.0, 0.0);
+
+    float ca = (float)cos(creaseAngle);
+
+    int num = 0;
+    int i;
+    for (i = 0; i < max; i++)
+    {
+	Face *f = faces[i];
+	if (f->degenerate) continue;
+
+	float dp = reference.dot(f->normal);
+	if (dp >= ca)
+	{
+	    average += f->normal; ++num;
+	}
+    }
+    average /= (float)num;
+    average.normalize();
+
+    int index = nd->Enter(average);
+
+    for (i = 0; i < max; i++)
+    {
+	Face *f = faces[i];
+	if (f->degenerate) continue;
+
+	float dp = reference.dot(f->normal);
+	if (dp >= ca)
+	{
+	    for (int j = 0; j < f->nv; j++)
+	    {
+		if (f->v[j] == whichV)
+		    f->vn[j] = index;
+	    }
+	}
+    }
+}
+
+//
+// Finds the vertex normals the way ivnorm used to, putting their
+// indices into the given array
+//
+static void
+oldVertexNormals(FaceList &faces, const SbVec3f *verts, float creaseAngle,
+		 SoMFVec3f &norms, int32_t *normalIndices)
+{
+    int numIndices = 0;
+    int i;
+    for (i = 0; i < faces.getLength(); i++)
+	numIndices += faces[i]->nv + 1;
+
+    int32_t *vnArray = new int32_t[numIndices - faces.getLength()];
+    int32_t *vn = vnArray;
+    for (i = 0; i < faces.getLength(); i++)
+    {
+	Face *f = faces[i];
+	f->findNormal(verts);
+	f->vn = vn;
+	vn += f->nv;
+	for (int j = 0; j < f->nv; j++)
+	    f->vn[j] = -1;
+    }
+
+    norms.deleteValues(0);
+    NormalDict *nd = new NormalDict(norms, numIndices - faces.getLength());
+    const MeshTopology *topo = faces.getTopology();
+    int count = 0;
+    for (i = 0; i < faces.getLength(); i++)
+    {
+	Face *f = faces[i];
+	for (int j = 0; j < f->nv; j++)
+	{
+	    if (f->degenerate)
+	    {
+		f->vn[j] = nd->Enter(SbVec3f(0,0,0));
+	    }
+	    else if (f->vn[j] == -1)
+	    {
+		Face **around;
+		int nf = topo->VertexFaces(f->v[j], around);
+		oldAverageNormals(around, nf, nd, f->normal,
+				  creaseAngle, f->v[j]);
+	    }
+	    normalIndices[count++] = f->vn[j];
+	}
+	normalIndices[count++] = SO_END_FACE_INDEX;
+    }
+    delete nd;
+
+    for (i = 0; i < faces.getLength(); i++)
+	faces[i]->vn = NULL;
+    delete [] vnArray;
+}
+
+//
+// Times finding the face and vertex normals of the face set both
+// ways, and checks that they are the same
+//
+static SbBool
+benchNormals(SoIndexedFaceSet *ifs, const SbVec3f *verts, float creaseAngle,
+	     int numReps, NormalsResult &oldResult, NormalsResult &newResult)
+{
+    FaceList faces(verts, ifs);
+    int numFaces = faces.getLength();
+    int numIndices = 0;
+    int i;
+    for (i = 0; i < numFaces; i++)
+	numIndices += faces[i]->nv + 1;
+
+    SoNormal *oldNorm = new SoNormal;
+    SoNormal *newNorm = new SoNormal;
+    oldNorm->ref();
+    newNorm->ref();
+    int32_t *oldIndices = new int32_t[numIndices];
+    SbVec3f *oldFaceNormals = new SbVec3f[numFaces];
+
+    for (int rep = 0; rep < numReps; rep++)
+    {
+	SbTime start = SbTime::getTimeOfDay();
+	for (i = 0; i < numFaces; i++)
+	    faces[i]->findNormal(verts);
+	double t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < oldResult.faceTime) oldResult.faceTime = t;
+	for (i = 0; i < numFaces; i++)
+	    oldFaceNormals[i] = faces[i]->normal;
+
+	start = SbTime::getTimeOfDay();
+	faces.findNormals();
+	t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < newResult.faceTime) newResult.faceTime = t;
+
+	start = SbTime::getTimeOfDay();
+	oldVertexNormals(faces, verts, creaseAngle, oldNorm->vector,
+			 oldIndices);
+	t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < oldResult.vertexTime) oldResult.vertexTime = t;
+
+	start = SbTime::getTimeOfDay();
+	faces.findVertexNormals(newNorm, ifs, creaseAngle);
+	t = (SbTime::getTimeOfDay() - start).getValue();
+	if (rep == 0 || t < newResult.vertexTime) newResult.vertexTime = t;
+    }
+
+    // The normals must be bit for bit the same
+    SbBool same = TRUE;
+    for (i = 0; same && i < numFaces; i++)
+	same = (memcmp(oldFaceNormals[i].getValue(),
+		       faces[i]->normal.getValue(), 3 * sizeof(float)) == 0);
+
+    int n = oldNorm->vector.getNum();
+    same = same && (newNorm->vector.getNum() == n);
+    const SbVec3f *oldN = oldNorm->vector.getValues(0);
+    const SbVec3f *newN = newNorm->vector.getValues(0);
+    for (i = 0; same && i < n; i++)
+	same = (memcmp(oldN[i].getValue(), newN[i].getValue(),
+		       3 * sizeof(float)) == 0);
+
+    const int32_t *newIndices = ifs->normalIndex.getValues(0);
+    same = same && (ifs->normalIndex.getNum() >= numIndices);
+    for (i = 0; same && i < numIndices; i++)
+	same = (oldIndices[i] == newIndices[i]);
+
+    delete [] oldIndices;
+    delete [] oldFaceNormals;
+    oldNorm->unref();
+    newNorm->unref();
+
+    return same;
+}
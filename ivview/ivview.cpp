@@ -1247,6 +1247,9 @@ main(int argc, char **argv)
     viewer = new SoQtExaminerViewer(window);
 #endif
 
+    // Allow reading files packed by ivfix -q
+    SoPackedVertexProperty::initClass();
+
     viewer->show();
 
     // Create and lay out the viewer
@@ -9,6 +9,7 @@
 //  - SoStdFile class - handling of stdin and stdout on Windows,
 //  - updateProgName() - proper detecting of program name on Windows
 //  - override classes for disabling texture image loading (some speed up)
+//  - SoPackedVertexProperty - vertex properties at reduced precision
 //
 //
 //  Autor: PCJohn (peciva _at fit.vutbr.cz)
@@ -32,6 +33,7 @@
 //
 
 #include <stdio.h>
+#include <math.h>
 #include <Inventor/SoInput.h>
 #include <Inventor/SoOutput.h>
 #include <Inventor/SoOutput.h>
@@ -507,6 +509,184 @@ READINSTANCE_OVERRIDE(SoTexture3noLoad, SoTexture3, filenames);
 READINSTANCE_OVERRIDE(SoVRMLImageTextureNoLoad, SoVRMLImageTexture, url);
 
 
+//
+//  SoPackedVertexProperty
+//
+
+SO_NODE_SOURCE(SoPackedVertexProperty);
+
+
+void SoPackedVertexProperty::initClass()
+{
+  if (getClassTypeId() == SoType::badType())
+    SO_NODE_INIT_CLASS(SoPackedVertexProperty, SoVertexProperty, "VertexProperty");
+}
+
+
+SoPackedVertexProperty::SoPackedVertexProperty()
+{
+  SO_NODE_CONSTRUCTOR(SoPackedVertexProperty);
+
+  SO_NODE_ADD_FIELD(packedNormal, (0));
+  SO_NODE_ADD_FIELD(packedTexCoord, (0));
+  SO_NODE_ADD_FIELD(texCoordOrigin, (0.0f, 0.0f));
+  SO_NODE_ADD_FIELD(texCoordSize, (1.0f, 1.0f));
+
+  packedNormal.setNum(0);
+  packedNormal.setDefault(TRUE);
+  packedTexCoord.setNum(0);
+  packedTexCoord.setDefault(TRUE);
+}
+
+
+SoPackedVertexProperty::~SoPackedVertexProperty()
+{
+}
+
+
+SbBool SoPackedVertexProperty::readInstance(SoInput *in, unsigned short flags)
+{
+  SbBool ok = SoVertexProperty::readInstance(in, flags);
+  if (ok)
+    unpack();
+  return ok;
+}
+
+
+uint32_t SoPackedVertexProperty::packNormal(const SbVec3f &normal)
+{
+  // Project onto the octahedron |x|+|y|+|z| = 1, and fold the lower half
+  // over the upper one
+  float sum = float(fabs(normal[0]) + fabs(normal[1]) + fabs(normal[2]));
+  if (sum == 0.f)
+    return 0;
+  float x = normal[0] / sum;
+  float y = normal[1] / sum;
+  if (normal[2] < 0.f) {
+    float fx = (1.f - float(fabs(y))) * (x >= 0.f ? 1.f : -1.f);
+    float fy = (1.f - float(fabs(x))) * (y >= 0.f ? 1.f : -1.f);
+    x = fx;
+    y = fy;
+  }
+
+  int16_t px = int16_t(floor(x * 32767.f + 0.5f));
+  int16_t py = int16_t(floor(y * 32767.f + 0.5f));
+  return uint32_t(uint16_t(px)) | (uint32_t(uint16_t(py)) << 16);
+}
+
+
+SbVec3f SoPackedVertexProperty::unpackNormal(uint32_t packed)
+{
+  float x = int16_t(packed & 0xffff) / 32767.f;
+  float y = int16_t(packed >> 16) / 32767.f;
+  if (x < -1.f)  x = -1.f;
+  if (y < -1.f)  y = -1.f;
+
+  float z = 1.f - float(fabs(x)) - float(fabs(y));
+  if (z < 0.f) {
+    float ux = (1.f - float(fabs(y))) * (x >= 0.f ? 1.f : -1.f);
+    float uy = (1.f - float(fabs(x))) * (y >= 0.f ? 1.f : -1.f);
+    x = ux;
+    y = uy;
+  }
+
+  SbVec3f n(x, y, z);
+  n /= n.length();
+  return n;
+}
+
+
+void SoPackedVertexProperty::pack(float &maxNormalError, float &maxTexCoordError)
+{
+  int i, num;
+
+  maxNormalError = 0.f;
+  num = normal.getNum();
+  if (num > 0) {
+    const SbVec3f *n = normal.getValues(0);
+    packedNormal.setNum(num);
+    uint32_t *p = packedNormal.startEditing();
+    for (i=0; i<num; i++) {
+      p[i] = packNormal(n[i]);
+      float length = n[i].length();
+      if (length == 0.f)
+        continue;
+      float d = unpackNormal(p[i]).dot(n[i] / length);
+      float error = float(acos(d > 1.f ? 1.f : d));
+      if (error > maxNormalError)
+        maxNormalError = error;
+    }
+    packedNormal.finishEditing();
+    normal.setNum(0);
+    normal.setDefault(TRUE);
+  }
+
+  maxTexCoordError = 0.f;
+  num = texCoord.getNum();
+  if (num > 0) {
+    const SbVec2f *t = texCoord.getValues(0);
+    SbVec2f min = t[0], max = t[0];
+    for (i=1; i<num; i++) {
+      if (t[i][0] < min[0])  min[0] = t[i][0];
+      if (t[i][1] < min[1])  min[1] = t[i][1];
+      if (t[i][0] > max[0])  max[0] = t[i][0];
+      if (t[i][1] > max[1])  max[1] = t[i][1];
+    }
+    SbVec2f size = max - min;
+    texCoordOrigin = min;
+    texCoordSize = size;
+
+    packedTexCoord.setNum(num);
+    uint32_t *p = packedTexCoord.startEditing();
+    for (i=0; i<num; i++) {
+      uint32_t q[2];
+      for (int j=0; j<2; j++) {
+        float f = (size[j] > 0.f ? (t[i][j] - min[j]) / size[j] : 0.f);
+        q[j] = uint32_t(floor(f * 65535.f + 0.5f));
+        float error = float(fabs(min[j] + q[j] / 65535.f * size[j] - t[i][j]));
+        if (error > maxTexCoordError)
+          maxTexCoordError = error;
+      }
+      p[i] = q[0] | (q[1] << 16);
+    }
+    packedTexCoord.finishEditing();
+    texCoord.setNum(0);
+    texCoord.setDefault(TRUE);
+  }
+}
+
+
+void SoPackedVertexProperty::unpack()
+{
+  int i, num;
+
+  num = packedNormal.getNum();
+  if (num > 0) {
+    const uint32_t *p = packedNormal.getValues(0);
+    normal.setNum(num);
+    SbVec3f *n = normal.startEditing();
+    for (i=0; i<num; i++)
+      n[i] = unpackNormal(p[i]);
+    normal.finishEditing();
+    normal.setDefault(TRUE);
+  }
+
+  num = packedTexCoord.getNum();
+  if (num > 0) {
+    const uint32_t *p = packedTexCoord.getValues(0);
+    SbVec2f origin = texCoordOrigin.getValue();
+    SbVec2f size = texCoordSize.getValue();
+    texCoord.setNum(num);
+    SbVec2f *t = texCoord.startEditing();
+    for (i=0; i<num; i++)
+      t[i].setValue(origin[0] + (p[i] & 0xffff) / 65535.f * size[0],
+                    origin[1] + (p[i] >> 16) / 65535.f * size[1]);
+    texCoord.finishEditing();
+    texCoord.setDefault(TRUE);
+  }
+}
+
+
 //
 //  Scene graph printing capabilities
 //
@@ -178,6 +178,56 @@ protected:
 };
 
 
+//
+//  SoPackedVertexProperty stores normals and texture coordinates of
+//  SoVertexProperty at reduced precision, making files smaller.
+//
+//  Normals are octahedral-encoded into two 16-bit signed values each
+//  (packedNormal), and texture coordinates are stored as two 16-bit
+//  fractions of the range from texCoordOrigin to
+//  texCoordOrigin+texCoordSize (packedTexCoord). pack() moves normal
+//  and texCoord values into the packed fields, and the node unpacks
+//  them into normal and texCoord when read, so it renders as an ordinary
+//  SoVertexProperty. The unpacked values are not written out again.
+//
+//  Applications must call initClass() to read files containing
+//  this node. Other readers see it as an unknown node.
+//
+
+#include <Inventor/nodes/SoSubNode.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/fields/SoMFUInt32.h>
+#include <Inventor/fields/SoSFVec2f.h>
+
+
+class SoPackedVertexProperty : public SoVertexProperty {
+  SO_NODE_HEADER(SoPackedVertexProperty);
+public:
+  SoMFUInt32 packedNormal;
+  SoMFUInt32 packedTexCoord;
+  SoSFVec2f  texCoordOrigin;
+  SoSFVec2f  texCoordSize;
+
+  static void initClass();
+  SoPackedVertexProperty();
+
+  // Packs the normals and texture coordinates, emptying normal and texCoord.
+  // Returns the largest angle between a normal and its packed value
+  // (in radians) and the largest error of a texture coordinate.
+  void pack(float &maxNormalError, float &maxTexCoordError);
+
+  // Unpacks the packed values into normal and texCoord.
+  void unpack();
+
+  static uint32_t packNormal(const SbVec3f &normal);
+  static SbVec3f unpackNormal(uint32_t packed);
+
+protected:
+  virtual ~SoPackedVertexProperty();
+  virtual SbBool readInstance(SoInput *in, unsigned short flags);
+};
+
+
 //
 // Scene graph printing capability.
 //